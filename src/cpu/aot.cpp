@@ -0,0 +1,82 @@
+#include "aot.hpp"
+
+#include <algorithm>
+
+namespace gbaemu
+{
+    AOT::AOT(CPU *cpu) : cpu(cpu), program(nullptr)
+    {
+    }
+
+    std::vector<const AOT::Program *> &AOT::programs()
+    {
+        // constructed on first use, the generated sources register their programs during static initialization
+        static std::vector<const Program *> registered;
+        return registered;
+    }
+
+    bool AOT::registerProgram(const Program &program)
+    {
+        programs().push_back(&program);
+        return true;
+    }
+
+    uint32_t AOT::checksum(const uint8_t *data, size_t size)
+    {
+        uint32_t hash = 0x811C9DC5;
+        for (size_t i = 0; i < size; ++i) {
+            hash = (hash ^ data[i]) * 0x01000193;
+        }
+        return hash;
+    }
+
+    bool AOT::load(const uint8_t *rom, size_t romSize)
+    {
+        unload();
+
+        // avoid hashing the ROM if no program could match
+        if (std::none_of(programs().begin(), programs().end(), [romSize](const Program *p) { return p->romSize == romSize; }))
+            return false;
+
+        const uint32_t romChecksum = checksum(rom, romSize);
+        for (const Program *p : programs()) {
+            if (p->romSize == romSize && p->romChecksum == romChecksum) {
+                program = p;
+                break;
+            }
+        }
+
+        if (!program)
+            return false;
+
+        for (bool thumb : {false, true}) {
+            pages[thumb].resize((romSize >> PAGE_SHIFT) + 1);
+        }
+
+        for (uint32_t i = 0; i < program->entryCount; ++i) {
+            const Entry &entry = program->entries[i];
+            const bool thumb = entry.key & 1;
+            const uint32_t offset = entry.key & ~static_cast<uint32_t>(1);
+            const uint32_t page = offset >> PAGE_SHIFT;
+
+            if (page >= pages[thumb].size())
+                continue;
+
+            if (!pages[thumb][page]) {
+                const uint32_t slots = (static_cast<uint32_t>(1) << PAGE_SHIFT) >> (thumb ? 1 : 2);
+                pages[thumb][page].reset(new const Entry *[slots]());
+            }
+            pages[thumb][page][(offset & ((1 << PAGE_SHIFT) - 1)) >> (thumb ? 1 : 2)] = &entry;
+        }
+
+        return true;
+    }
+
+    void AOT::unload()
+    {
+        program = nullptr;
+        for (auto &modePages : pages) {
+            modePages.clear();
+        }
+    }
+} // namespace gbaemu
@@ -0,0 +1,124 @@
+#ifndef AOT_HPP
+#define AOT_HPP
+
+#include "io/memory_defs.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace gbaemu
+{
+    class CPU;
+
+    /*
+        Runs ROM code that was compiled ahead of time by gbarecomp (see tools/gbarecomp.cpp).
+
+        gbarecomp walks the reachable code of a ROM and emits C++ functions for its straight-line runs of instructions
+        (see AOTBlock): data processing, single loads & stores and direct branches are translated into C++, all other
+        instructions call their handlers. The generated sources are placed in src/recompiled and register their
+        program at startup. When a ROM with a registered program is loaded, execStep enters the compiled code
+        whenever the PC lands on a known instruction, everything else is left to the interpreter. No code is
+        generated at runtime.
+     */
+    class AOT
+    {
+      public:
+        // Executes the instructions of a block starting with the one at index, pc is the address of that one
+        typedef void (*BlockFunction)(CPU &cpu, uint32_t index, uint32_t pc);
+
+        struct Entry {
+            // ROM offset of the instruction, bit 0 is set for THUMB code
+            uint32_t key;
+            uint32_t index;
+            // the instruction word, has to match the one in the pipeline
+            uint32_t inst;
+            BlockFunction block;
+        };
+
+        struct Program {
+            // name of the ROM file the program was generated from
+            const char *name;
+            uint32_t romSize;
+            uint32_t romChecksum;
+            const Entry *entries;
+            uint32_t entryCount;
+        };
+
+        static constexpr uint32_t PAGE_SHIFT = 14;
+        // ROM offsets within a wait state region
+        static constexpr uint32_t ROM_MASK = 0x01FFFFFF;
+
+      private:
+        CPU *cpu;
+
+        const Program *program;
+
+        // Entries per ROM page & instruction set, indexed by the instruction offset within the page
+        std::vector<std::unique_ptr<const Entry *[]>> pages[2];
+
+        static std::vector<const Program *> &programs();
+
+        template <bool thumb>
+        const Entry *find(uint32_t pc) const
+        {
+            // the compiled code uses the addresses of the first wait state region, its mirrors are interpreted
+            const uint32_t region = pc >> 24;
+            if (region != memory::EXT_ROM1 && region != memory::EXT_ROM1_)
+                return nullptr;
+
+            const uint32_t offset = pc & ROM_MASK;
+            const uint32_t page = offset >> PAGE_SHIFT;
+            if (page >= pages[thumb].size() || !pages[thumb][page])
+                return nullptr;
+
+            return pages[thumb][page][(offset & ((1 << PAGE_SHIFT) - 1)) >> (thumb ? 1 : 2)];
+        }
+
+      public:
+        AOT(CPU *cpu);
+
+        AOT(const AOT &) = delete;
+        AOT &operator=(const AOT &) = delete;
+
+        // Called by the generated sources during static initialization
+        static bool registerProgram(const Program &program);
+
+        // FNV-1a hash of the ROM image, identifies the ROM a program was generated from
+        static uint32_t checksum(const uint8_t *data, size_t size);
+
+        // Selects the program generated for the given ROM image, returns false if there is none
+        bool load(const uint8_t *rom, size_t romSize);
+
+        void unload();
+
+        bool isEnabled() const
+        {
+            return program != nullptr;
+        }
+
+        const Program *getProgram() const
+        {
+            return program;
+        }
+
+        /*
+            Executes the compiled code of the instruction at pc, inst is the instruction in the pipeline.
+            Returns false if the interpreter has to execute the next instruction.
+         */
+        template <bool thumb>
+        bool execute(uint32_t pc, uint32_t inst)
+        {
+            const Entry *entry = find<thumb>(pc);
+
+            if (!entry || entry->inst != inst)
+                return false;
+
+            entry->block(*cpu, entry->index, pc);
+            return true;
+        }
+    };
+} // namespace gbaemu
+
+#endif /* AOT_HPP */
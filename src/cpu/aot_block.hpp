@@ -0,0 +1,291 @@
+#ifndef AOT_BLOCK_HPP
+#define AOT_BLOCK_HPP
+
+#include "cpu.hpp"
+#include "decode/inst.hpp"
+#include "native_decode.hpp"
+#include "regs.hpp"
+#include "util.hpp"
+
+#include <cstdint>
+
+namespace gbaemu
+{
+    /*
+        Used by the code generated by gbarecomp: a block function creates one for the pc it was entered at. Every
+        instruction starts with begin & ends with end, in between the generated code either executes its semantics
+        with the helpers below (instructions decoded by native::decodeARM / decodeThumb, all fields are constants)
+        or calls the handler with step. The helpers behave exactly like the handlers of the interpreter.
+
+        The bookkeeping is the same as for translated code (see JIT): the pipeline is forwarded, the PC updated &
+        the fetch cycles of the current wait states are added, after every instruction cyclesLeft is updated exactly
+        like in CPU::execStep. ROM can not be written, so the fetched words need no checks.
+     */
+    template <bool thumb>
+    class AOTBlock
+    {
+      private:
+        static constexpr uint32_t instSize = thumb ? 2 : 4;
+
+        CPU &cpu;
+        uint32_t *const rx;
+        uint32_t pc;
+        const uint8_t execState;
+        const memory::MemoryRegion memReg;
+        const uint8_t fetchCycles;
+
+      public:
+        AOTBlock(CPU &cpu, uint32_t pc)
+            : cpu(cpu), rx(cpu.state.getCurrentRegs()), pc(pc), execState(cpu.state.execState), memReg(Memory::extractMemoryRegion(pc)),
+              fetchCycles(thumb ? cpu.state.memory.memCycles16(memReg, true) : cpu.state.memory.memCycles32(memReg, true))
+        {
+        }
+
+        // Forwards the pipeline, already increments PC & fetches
+        void begin(uint32_t prefetch)
+        {
+            CPUState &state = cpu.state;
+
+            pc += instSize;
+
+            state.pipeline[1] = state.pipeline[0];
+            rx[regs::PC_OFFSET] = pc;
+            state.pipeline[0] = prefetch;
+            state.cpuInfo.cycleCount = fetchCycles;
+            state.cpuInfo.memReg = memReg;
+        }
+
+        // Returns false if execution does not continue with the next instruction
+        bool end()
+        {
+            CPUState &state = cpu.state;
+
+            cpu.cyclesLeft -= static_cast<int32_t>(state.cpuInfo.cycleCount);
+            state.cpuInfo.cycleCount = 0;
+
+            // branches, state changes & events leave the block
+            return cpu.cyclesLeft > 0 && state.execState == execState && rx[regs::PC_OFFSET] == pc;
+        }
+
+        // Executes the instruction at the current pc with its handler
+        template <bool conditional>
+        bool step(uint32_t inst, uint32_t prefetch, uint16_t hash)
+        {
+            begin(prefetch);
+
+            if (!conditional || condition(static_cast<ConditionOPCode>(inst >> 28))) {
+                (cpu.*(thumb ? CPU::thumbHandler(hash) : CPU::armHandler(hash)))(inst);
+            }
+
+            return end();
+        }
+
+        bool condition(ConditionOPCode cond) const
+        {
+            return conditionSatisfied(cond, cpu.state);
+        }
+
+        uint32_t reg(uint8_t r) const
+        {
+            return rx[r];
+        }
+
+        // Operand shifted by an immediate like shifts::shift<true>, the carry out is bit 32
+        template <shifts::ShiftType type, uint8_t amount>
+        uint64_t shift(uint32_t value) const
+        {
+            const uint64_t extended = value;
+
+            if constexpr (type == shifts::LSL) {
+                return extended << amount;
+            } else if constexpr (amount == 0) {
+                // LSR #32, ASR #32 & RRX
+                if (type == shifts::LSR)
+                    return (extended >> 31) << 32;
+                if (type == shifts::ASR)
+                    return static_cast<uint64_t>(static_cast<uint32_t>(static_cast<int32_t>(value) >> 31)) | ((extended >> 31) << 32);
+                return (extended >> 1) | (static_cast<uint64_t>(cpu.state.getFlag<cpsr_flags::C_FLAG>()) << 31) | ((extended & 1) << 32);
+            } else {
+                const uint64_t carry = ((extended >> (amount - 1)) & 1) << 32;
+                if (type == shifts::LSR)
+                    return (extended >> amount) | carry;
+                if (type == shifts::ASR)
+                    return static_cast<uint64_t>(static_cast<uint32_t>(static_cast<int32_t>(value) >> amount)) | carry;
+                return static_cast<uint64_t>(static_cast<uint32_t>((value >> amount) | (value << (32 - amount)))) | carry;
+            }
+        }
+
+        /*
+            Data processing like CPU::execDataProc, shifterOperand contains the shifter carry in bit 32 which is only
+            written to C if shifterCarry is set. rd is never the PC.
+         */
+        template <native::DataProcOp op, bool s, uint8_t rd, bool write, bool shifterCarry>
+        void dataProc(uint64_t rnValue, uint64_t shifterOperand)
+        {
+            using namespace native;
+
+            constexpr bool logical = op == DP_AND || op == DP_EOR || op == DP_TST || op == DP_TEQ || op == DP_ORR || op == DP_MOV || op == DP_BIC || op == DP_MVN;
+            constexpr bool invertCarry = op == DP_SUB || op == DP_SBC || op == DP_CMP || op == DP_RSB || op == DP_RSC || op == DP_NEG;
+
+            CPUState &state = cpu.state;
+
+            const bool shifterOperandCarry = shifterOperand & (static_cast<uint64_t>(1) << 32);
+            shifterOperand &= 0xFFFFFFFF;
+
+            uint64_t resultValue;
+            switch (op) {
+                case DP_AND:
+                case DP_TST:
+                    resultValue = rnValue & shifterOperand;
+                    break;
+                case DP_EOR:
+                case DP_TEQ:
+                    resultValue = rnValue ^ shifterOperand;
+                    break;
+                case DP_ORR:
+                    resultValue = rnValue | shifterOperand;
+                    break;
+                case DP_BIC:
+                    resultValue = rnValue & ~shifterOperand;
+                    break;
+                case DP_MOV:
+                    resultValue = shifterOperand;
+                    // MOV never sets V, see CPU::execDataProc
+                    rnValue = 0;
+                    break;
+                case DP_MVN:
+                    resultValue = ~shifterOperand;
+                    break;
+                case DP_ADD:
+                case DP_CMN:
+                    resultValue = rnValue + shifterOperand;
+                    break;
+                case DP_ADC:
+                    resultValue = rnValue + shifterOperand + (state.getFlag<cpsr_flags::C_FLAG>() ? 1 : 0);
+                    break;
+                case DP_SUB:
+                case DP_CMP:
+                    resultValue = static_cast<int64_t>(rnValue) - static_cast<int64_t>(shifterOperand);
+                    shifterOperand = (shifterOperand >> 31) & 1 ? 0 : static_cast<uint32_t>(1) << 31;
+                    break;
+                case DP_SBC:
+                    resultValue = static_cast<int64_t>(rnValue) - static_cast<int64_t>(shifterOperand) - (state.getFlag<cpsr_flags::C_FLAG>() ? 0 : 1);
+                    shifterOperand = (shifterOperand >> 31) & 1 ? 0 : static_cast<uint32_t>(1) << 31;
+                    break;
+                case DP_RSB:
+                    resultValue = static_cast<int64_t>(shifterOperand) - static_cast<int64_t>(rnValue);
+                    rnValue = (rnValue >> 31) & 1 ? 0 : static_cast<uint32_t>(1) << 31;
+                    break;
+                case DP_RSC:
+                    resultValue = static_cast<int64_t>(shifterOperand) - static_cast<int64_t>(rnValue) - (state.getFlag<cpsr_flags::C_FLAG>() ? 0 : 1);
+                    rnValue = (rnValue >> 31) & 1 ? 0 : static_cast<uint32_t>(1) << 31;
+                    break;
+                case DP_NEG:
+                    // THUMB NEG only uses rs, the sign of rd is used as second operand
+                    resultValue = -static_cast<int64_t>(shifterOperand);
+                    shifterOperand = (rnValue >> 31) & 1 ? 0 : static_cast<uint32_t>(1) << 31;
+                    rnValue = 0;
+                    break;
+            }
+
+            if (s) {
+                state.setALUFlags<true, true, !logical || op == DP_MOV, !logical, invertCarry>(resultValue, (rnValue >> 31) & 1, (shifterOperand >> 31) & 1);
+
+                if (shifterCarry)
+                    state.setFlag<cpsr_flags::C_FLAG>(shifterOperandCarry);
+            }
+
+            if (write)
+                rx[rd] = static_cast<uint32_t>(resultValue);
+        }
+
+        // THUMB move shifted register like CPU::handleThumbMoveShiftedReg
+        template <uint8_t rd>
+        void thumbShift(uint64_t shifted)
+        {
+            rx[rd] = static_cast<uint32_t>(shifted);
+            cpu.state.setALUFlags<true, true, false, true, false>(shifted, false, false);
+        }
+
+        /*
+            Single loads & stores like CPU::execLoadStoreRegUByte & CPU::execHalfwordDataTransferImmRegSignedTransfer.
+            rd is never the PC, a written back base never the PC.
+         */
+        template <native::MemOp op, uint8_t rd, uint8_t rn, bool pre, bool up, bool writeback>
+        void memory(uint32_t rnValue, uint32_t offset)
+        {
+            using namespace native;
+
+            constexpr bool load = op <= MEM_LDRSH;
+
+            CPUState &state = cpu.state;
+
+            // Execution Time: For normal LDR: 1S+1N+1I. For STR: 2N.
+            if (load)
+                state.cpuInfo.cycleCount += 1;
+            else
+                cpu.patchFetchToNCycle();
+
+            offset = up ? offset : -offset;
+            uint32_t memoryAddress = pre ? rnValue + offset : rnValue;
+
+            switch (op) {
+                case MEM_LDR:
+                    // unaligned words are rotated
+                    rx[rd] = shifts::rorShiftValueUnalignedAddr(state.memory.read32(memoryAddress, state.cpuInfo, false), (memoryAddress & 0x03) * 8);
+                    break;
+                case MEM_LDRB:
+                    rx[rd] = state.memory.read8(memoryAddress, state.cpuInfo, false);
+                    break;
+                case MEM_LDRH:
+                    rx[rd] = shifts::rorShiftValueUnalignedAddr(state.memory.read16(memoryAddress, state.cpuInfo, false), (memoryAddress & 0x01) * 8);
+                    break;
+                case MEM_LDRSB:
+                    rx[rd] = signExt<int32_t, uint32_t, 8>(state.memory.read8(memoryAddress, state.cpuInfo, false));
+                    break;
+                case MEM_LDRSH:
+                    // odd addresses load a sign extended byte
+                    if (memoryAddress & 1)
+                        rx[rd] = signExt<int32_t, uint32_t, 8>(state.memory.read8(memoryAddress, state.cpuInfo, false));
+                    else
+                        rx[rd] = signExt<int32_t, uint32_t, 16>(state.memory.read16(memoryAddress, state.cpuInfo, false));
+                    break;
+                case MEM_STR:
+                    state.memory.write32(memoryAddress, rx[rd], state.cpuInfo);
+                    break;
+                case MEM_STRB:
+                    state.memory.write8(memoryAddress, static_cast<uint8_t>(rx[rd]), state.cpuInfo);
+                    break;
+                case MEM_STRH:
+                    state.memory.write16(memoryAddress, static_cast<uint16_t>(rx[rd]), state.cpuInfo);
+                    break;
+            }
+
+            if (writeback && (!load || rn != rd)) {
+                if (!pre)
+                    memoryAddress += offset;
+
+                rx[rn] = memoryAddress;
+            }
+        }
+
+        // B & ARM BL like CPU::handleBranch & the THUMB branch handlers
+        template <bool link>
+        void branch(uint32_t target)
+        {
+            if (link) {
+                // Note that pc is already incremented by 4
+                rx[regs::LR_OFFSET] = rx[regs::PC_OFFSET];
+            }
+
+            rx[regs::PC_OFFSET] = target;
+
+            if (link && cpu.profiler.isEnabled())
+                cpu.profiler.onCall(target, rx[regs::LR_OFFSET]);
+
+            cpu.refillPipelineAfterBranch<thumb>();
+        }
+    };
+} // namespace gbaemu
+
+#endif /* AOT_BLOCK_HPP */
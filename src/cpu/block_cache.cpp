@@ -0,0 +1,185 @@
+#include "block_cache.hpp"
+
+#include "decode/inst.hpp"
+#include "io/memory.hpp"
+
+#include <algorithm>
+#include <cstddef>
+
+namespace gbaemu
+{
+    // Instructions after which execution never continues sequentially
+    template <bool thumb>
+    static bool endsBlock(uint32_t inst)
+    {
+        if (thumb) {
+            return (inst & 0xF800) == 0xE000 || // B
+                   (inst & 0xF800) == 0xF800 || // BL second half
+                   (inst & 0xFF80) == 0x4700 || // BX
+                   (inst & 0xFF00) == 0xDF00 || // SWI
+                   (inst & 0xFF00) == 0xBD00;   // POP {..., PC}
+        } else {
+            return (inst >> 28) == AL &&
+                   ((inst & 0x0E000000) == 0x0A000000 ||     // B, BL
+                    (inst & 0x0FFFFFF0) == 0x012FFF10 ||     // BX
+                    (inst & 0x0F000000) == 0x0F000000 ||     // SWI
+                    (inst & 0x0E108000) == 0x08108000 ||     // LDM {..., PC}
+                    (inst & 0x0C10F000) == 0x0410F000);      // LDR PC, ...
+        }
+    }
+
+    BlockCache::BlockCache() : blocks(new Block[BLOCK_COUNT]), invalidations(0)
+    {
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Winvalid-offsetof"
+        static_assert(offsetof(BlockCache, cursorKey) + sizeof(cursorKey) <= CURSOR_SIZE, "execution cursor has to be at the start");
+#pragma GCC diagnostic pop
+
+        // set by the CPU
+        fusedPairs[0] = fusedPairs[1] = nullptr;
+        fusedPairCount[0] = fusedPairCount[1] = 0;
+#ifdef THREADED_DISPATCH
+        threadedLUTs[0] = threadedLUTs[1] = nullptr;
+#endif
+        flush();
+        flushNative();
+    }
+
+    BlockCache::~BlockCache()
+    {
+        delete[] blocks;
+        blocks = nullptr;
+    }
+
+    void BlockCache::flush()
+    {
+        for (uint32_t i = 0; i < BLOCK_COUNT; ++i) {
+            blocks[i].key = INVALID_KEY;
+        }
+        for (auto &blockList : pageBlocks) {
+            blockList.clear();
+        }
+        std::fill_n(codePages, WRAM_PAGES + IWRAM_PAGES, false);
+
+        current = nullptr;
+        cursor = nullptr;
+        cursorKey = INVALID_KEY;
+        ++invalidations;
+    }
+
+    void BlockCache::flushNative()
+    {
+        for (uint32_t i = 0; i < BLOCK_COUNT; ++i) {
+            blocks[i].hits = 0;
+            blocks[i].native = nullptr;
+        }
+    }
+
+    void BlockCache::invalidatePage(uint32_t page)
+    {
+        for (uint16_t index : pageBlocks[page]) {
+            blocks[index].key = INVALID_KEY;
+        }
+        pageBlocks[page].clear();
+        codePages[page] = false;
+        ++invalidations;
+    }
+
+    template <bool thumb>
+    const BlockCache::Block *BlockCache::build(uint32_t pc, Memory &memory, const InstExecutor *lut)
+    {
+        const memory::MemoryRegion memReg = Memory::extractMemoryRegion(pc);
+
+        if (!isCacheable(memReg))
+            return nullptr;
+
+        const uint32_t key = pc | static_cast<uint32_t>(thumb);
+        const uint16_t index = static_cast<uint16_t>(blockIndex(key));
+        Block &block = blocks[index];
+
+        if (block.key == key)
+            return &block;
+
+        constexpr uint32_t instSize = thumb ? 2 : 4;
+        // All fetched words including the prefetched ones have to be within the same memory region.
+        const uint32_t regionLimit = pc | 0x00FFFFFF;
+        const uint8_t fetchCycles = thumb ? memory.memCycles16(memReg, true) : memory.memCycles32(memReg, true);
+        InstructionExecutionInfo info{0, memReg};
+
+        uint32_t length = 0;
+        for (uint32_t addr = pc; length < MAX_BLOCK_LENGTH && addr + 3 * instSize - 1 <= regionLimit; addr += instSize) {
+            DecodedInst &decoded = block.insts[length++];
+
+            if (thumb) {
+                decoded.inst = memory.readInst16(addr, info);
+                decoded.prefetch = memory.readInst16(addr + 2 * instSize, info);
+                decoded.handler = lut[hashThumb(decoded.inst)];
+#ifdef THREADED_DISPATCH
+                decoded.threaded = threadedLUTs[1][hashThumb(decoded.inst)];
+#endif
+                decoded.conditional = false;
+            } else {
+                decoded.inst = memory.readInst32(addr, info);
+                decoded.prefetch = memory.readInst32(addr + 2 * instSize, info);
+                decoded.handler = lut[hashArm(decoded.inst)];
+#ifdef THREADED_DISPATCH
+                decoded.threaded = threadedLUTs[0][hashArm(decoded.inst)];
+#endif
+                decoded.conditional = (decoded.inst >> 28) != AL;
+            }
+            decoded.fetchCycles = fetchCycles;
+            decoded.memReg = memReg;
+
+            if (endsBlock<thumb>(decoded.inst))
+                break;
+        }
+
+        if (length == 0)
+            return nullptr;
+
+        // Select superinstructions for known pairs, the JIT keeps using the single handlers
+        for (uint32_t i = 0; i < length; ++i) {
+            DecodedInst &decoded = block.insts[i];
+            decoded.dispatch = decoded.handler;
+
+            if (i + 1 == length)
+                break;
+
+            for (uint32_t p = 0; p < fusedPairCount[thumb]; ++p) {
+                const FusedPair &pair = fusedPairs[thumb][p];
+                if (decoded.handler == pair.first && block.insts[i + 1].handler == pair.second) {
+                    decoded.dispatch = pair.fused;
+                    break;
+                }
+            }
+        }
+
+        // Remember all RAM pages this block was decoded from, so that writes can invalidate it
+        if (memReg == memory::WRAM || memReg == memory::IWRAM) {
+            for (uint32_t i = 0; i < length + 2; ++i) {
+                std::vector<uint16_t> &blockList = pageBlocks[pageIndex(pc + i * instSize)];
+
+                if (blockList.empty() || blockList.back() != index) {
+                    blockList.push_back(index);
+
+                    // Evicted blocks are never removed, keep the list from growing endlessly
+                    if (blockList.size() > 64) {
+                        std::sort(blockList.begin(), blockList.end());
+                        blockList.erase(std::unique(blockList.begin(), blockList.end()), blockList.end());
+                    }
+                }
+                codePages[pageIndex(pc + i * instSize)] = true;
+            }
+        }
+
+        block.key = key;
+        block.length = length;
+        block.hits = 0;
+        block.native = nullptr;
+
+        return &block;
+    }
+
+    template const BlockCache::Block *BlockCache::build<true>(uint32_t, Memory &, const InstExecutor *);
+    template const BlockCache::Block *BlockCache::build<false>(uint32_t, Memory &, const InstExecutor *);
+} // namespace gbaemu
@@ -0,0 +1,238 @@
+#ifndef BLOCK_CACHE_HPP
+#define BLOCK_CACHE_HPP
+
+#include "io/memory_defs.hpp"
+#include "logging.hpp"
+
+#include <cstdint>
+#include <vector>
+
+/*
+    Threaded dispatch chains the handlers of a block with tail calls, which only musttail guarantees (also without
+    optimizations). Compilers without it (i.e. GCC before 15) return to a dispatch loop after every instruction instead
+    of growing the stack with every instruction.
+ */
+#if defined(THREADED_DISPATCH) && defined(__has_cpp_attribute)
+#if __has_cpp_attribute(clang::musttail)
+#define THREADED_TAIL_CALL [[clang::musttail]]
+#elif __has_cpp_attribute(gnu::musttail)
+#define THREADED_TAIL_CALL [[gnu::musttail]]
+#endif
+#endif
+
+namespace gbaemu
+{
+    class CPU;
+    class Memory;
+    class JIT;
+
+    /*
+        Caches straight-line runs of already decoded instructions (basic blocks).
+        A block stores for every instruction the resolved LUT handler, the raw instruction word
+        (the handlers extract their operand fields from it) and the word that gets prefetched into
+        the pipeline while the instruction executes. Together with the precomputed fetch cycles this
+        allows execStep to skip the memory fetch, the hashing and the LUT lookup.
+
+        Blocks are keyed by PC and the instruction set (bit 0 of the key is set in THUMB mode).
+        Code in WRAM & IWRAM may be overwritten: every page containing cached code is flagged and
+        writes into a flagged page invalidate all blocks overlapping it.
+     */
+    class BlockCache
+    {
+        // translated code checks codePages itself
+        friend class JIT;
+
+      public:
+        typedef void (CPU::*InstExecutor)(uint32_t);
+
+        static constexpr uint32_t MAX_BLOCK_LENGTH = 32;
+        static constexpr uint32_t BLOCK_COUNT = 2048;
+
+        static constexpr uint32_t PAGE_SHIFT = 7;
+        static constexpr uint32_t WRAM_PAGES = (memory::WRAM_LIMIT - memory::WRAM_OFFSET + 1) >> PAGE_SHIFT;
+        static constexpr uint32_t IWRAM_PAGES = (memory::IWRAM_LIMIT - memory::IWRAM_OFFSET + 1) >> PAGE_SHIFT;
+
+        static constexpr uint32_t INVALID_KEY = 0xFFFFFFFF;
+
+        // Bytes at the start of the object used by the execution cursor
+        static constexpr uint32_t CURSOR_SIZE = 24;
+
+#ifdef THREADED_DISPATCH
+        struct DecodedInst;
+        /*
+            Executes the instruction & the sequentially following ones of its block, returns the address of the last executed one.
+            Without THREADED_TAIL_CALL only the instruction itself is executed, the next one is left in CPU::threadedNext.
+         */
+        typedef uint32_t (*ThreadedExecutor)(CPU &, const DecodedInst *);
+#endif
+
+        // A superinstruction: fused executes an instruction with handler first followed by one with handler second
+        struct FusedPair {
+            InstExecutor first;
+            InstExecutor second;
+            InstExecutor fused;
+        };
+
+        struct DecodedInst {
+            // executes exactly this instruction
+            InstExecutor handler;
+            // called by execStep: either handler or a superinstruction that may also execute the next instruction
+            InstExecutor dispatch;
+#ifdef THREADED_DISPATCH
+            ThreadedExecutor threaded;
+#endif
+            uint32_t inst;
+            // the instruction that will be fetched into the pipeline while executing this one
+            uint32_t prefetch;
+            uint8_t fetchCycles;
+            memory::MemoryRegion memReg;
+            // ARM only: instruction has to check its condition code
+            bool conditional;
+        };
+
+        struct Block {
+            uint32_t key;
+            uint32_t length;
+            // how often the block was entered after a branch, used to find hot blocks for the JIT
+            uint32_t hits;
+            // translated host code, nullptr if not translated (yet)
+            const uint8_t *native;
+            DecodedInst insts[MAX_BLOCK_LENGTH];
+        };
+
+      private:
+        // Execution cursor within the current block, used for every instruction & therefore first (see CPU)
+        const Block *current;
+        const DecodedInst *cursor;
+        uint32_t cursorKey;
+
+        Block *blocks;
+
+        // Blocks overlapping a WRAM / IWRAM page, first WRAM then IWRAM pages
+        std::vector<uint16_t> pageBlocks[WRAM_PAGES + IWRAM_PAGES];
+        bool codePages[WRAM_PAGES + IWRAM_PAGES];
+
+        // [ARM, THUMB]
+        const FusedPair *fusedPairs[2];
+        uint32_t fusedPairCount[2];
+
+#ifdef THREADED_DISPATCH
+        // [ARM, THUMB]
+        const ThreadedExecutor *threadedLUTs[2];
+#endif
+
+        static uint32_t blockIndex(uint32_t key)
+        {
+            return ((key >> 1) ^ (key >> 12)) & (BLOCK_COUNT - 1);
+        }
+
+        static bool isCacheable(memory::MemoryRegion memReg)
+        {
+            return memReg == memory::WRAM || memReg == memory::IWRAM ||
+                   (memReg >= memory::EXT_ROM1 && memReg <= memory::EXT_ROM3);
+        }
+
+        static uint32_t pageIndex(uint32_t addr)
+        {
+            if (((addr >> 24) & 0xF) == memory::WRAM)
+                return ((addr & memory::WRAM_LIMIT) - memory::WRAM_OFFSET) >> PAGE_SHIFT;
+            else
+                return WRAM_PAGES + (((addr & memory::IWRAM_LIMIT) - memory::IWRAM_OFFSET) >> PAGE_SHIFT);
+        }
+
+        void invalidatePage(uint32_t page);
+
+        template <bool thumb>
+        const Block *build(uint32_t pc, Memory &memory, const InstExecutor *lut);
+
+      public:
+        // Incremented on every invalidation, lets translated code notice that it overwrote itself
+        uint32_t invalidations;
+
+        BlockCache();
+        ~BlockCache();
+
+        BlockCache(const BlockCache &) = delete;
+        BlockCache &operator=(const BlockCache &) = delete;
+
+        void flush();
+
+        template <bool thumb>
+        void setFusedPairs(const FusedPair *pairs, uint32_t count)
+        {
+            fusedPairs[thumb] = pairs;
+            fusedPairCount[thumb] = count;
+        }
+
+#ifdef THREADED_DISPATCH
+        void setThreadedLUTs(const ThreadedExecutor *armLUT, const ThreadedExecutor *thumbLUT)
+        {
+            threadedLUTs[0] = armLUT;
+            threadedLUTs[1] = thumbLUT;
+        }
+#endif
+
+        // Drops all translated host code, the decoded blocks stay valid.
+        void flushNative();
+
+        // true if execution continues sequentially within the current block
+        template <bool thumb>
+        bool continuesBlock(uint32_t pc) const
+        {
+            return current && (pc | static_cast<uint32_t>(thumb)) == cursorKey && current->key != INVALID_KEY;
+        }
+
+        // Returns the already decoded block starting at pc, does not decode anything
+        template <bool thumb>
+        Block *find(uint32_t pc)
+        {
+            const uint32_t key = pc | static_cast<uint32_t>(thumb);
+            Block &block = blocks[blockIndex(key)];
+            return block.key == key ? &block : nullptr;
+        }
+
+        /*
+            Returns the decoded instruction at pc or nullptr if it has to be executed by the interpreter.
+            inst is the instruction word currently in the pipeline: if it differs from the cached one
+            (e.g. because it was fetched before its memory got overwritten) the interpreter is used.
+         */
+        template <bool thumb>
+        const DecodedInst *next(uint32_t pc, uint32_t inst, Memory &memory, const InstExecutor *lut)
+        {
+            const uint32_t key = pc | static_cast<uint32_t>(thumb);
+
+            if (!current || key != cursorKey || current->key == INVALID_KEY) {
+                current = build<thumb>(pc, memory, lut);
+                if (!current)
+                    return nullptr;
+                cursor = current->insts;
+                cursorKey = key;
+            }
+
+            const DecodedInst *decoded = cursor;
+
+            if (decoded->inst != inst) {
+                current = nullptr;
+                return nullptr;
+            }
+
+            if (++cursor == current->insts + current->length) {
+                current = nullptr;
+            } else {
+                cursorKey += thumb ? 2 : 4;
+            }
+
+            return decoded;
+        }
+
+        // addr has to be inside of WRAM or IWRAM
+        void invalidate(uint32_t addr)
+        {
+            uint32_t page = pageIndex(addr);
+            if (codePages[page])
+                invalidatePage(page);
+        }
+    };
+} // namespace gbaemu
+
+#endif /* BLOCK_CACHE_HPP */
@@ -8,13 +8,38 @@
 #include "swi.hpp"
 
 #include <algorithm>
+#include <cstddef>
 #include <sstream>
 
 namespace gbaemu
 {
+#ifdef PROFILE_HANDLERS
+    // every instruction has to be counted by execStep, so compiled, translated & fused code is not used
+    static constexpr bool profileHandlers = true;
+#else
+    static constexpr bool profileHandlers = false;
+#endif
 
-    CPU::CPU() : dmaGroup(this), timerGroup(this), irqHandler(this), keypad(this)
+    CPU::CPU() : cyclesLeft(0), jit(this, blockCache), aot(this), idleLoops(this), profiler(this), scheduler(cyclesLeft), irqHandler(this), dmaGroup(this), timerGroup(this), keypad(this), stepTarget(0), debugHook(nullptr), debugBreak(false)
     {
+        // CPU is not standard layout, offsetof is still supported by GCC & Clang
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Winvalid-offsetof"
+        static_assert(offsetof(CPU, state) == 0, "the hot part of the CPU state has to start the object");
+        static_assert(offsetof(CPU, blockCache) + BlockCache::CURSOR_SIZE <= offsetof(CPU, cyclesLeft) + 64, "cyclesLeft & the block cache cursor have to share a cache line");
+#pragma GCC diagnostic pop
+
+        scheduler.setHandler(Scheduler::STEP_END, [this](uint64_t) {
+            scheduler.requestStop();
+        });
+
+        blockCache.setFusedPairs<false>(armFusedPairs, armFusedPairCount);
+        blockCache.setFusedPairs<true>(thumbFusedPairs, thumbFusedPairCount);
+
+#ifdef THREADED_DISPATCH
+        blockCache.setThreadedLUTs(armThreadedLUT, thumbThreadedLUT);
+#endif
+
         reset();
     }
 
@@ -27,7 +52,7 @@ namespace gbaemu
     void CPU::handleInvalid(uint32_t inst)
     {
         (void)inst;
-        state.executionInfo.message << "ERROR: trying to execute invalid instruction!" << std::endl;
+        state.executionInfo->message << "ERROR: trying to execute invalid instruction!" << std::endl;
         state.execState = CPUState::EXEC_ERROR;
     }
 
@@ -50,7 +75,7 @@ namespace gbaemu
                 }
                 swi::biosCallHandler[index](this);
             } else {
-                state.executionInfo.message << "ERROR: trying to call invalid bios call handler: " << std::hex << index << " at PC: 0x" << std::hex << (state.getCurrentPC() - 4) << std::endl;
+                state.executionInfo->message << "ERROR: trying to call invalid bios call handler: " << std::hex << index << " at PC: 0x" << std::hex << (state.getCurrentPC() - 4) << std::endl;
                 state.execState = CPUState::EXEC_ERROR;
             }
         }
@@ -59,33 +84,58 @@ namespace gbaemu
 // Trust me, you dont want to look at it :D
 #include "rep_case_constexpr_makros.h"
 
-    CPUExecutionInfoType CPU::step(uint32_t cycles)
+    CPUExecutionInfoType CPU::run()
+    {
+        return debugHook ? runLoop<true>() : runLoop<false>();
+    }
+
+    template <bool debug>
+    CPUExecutionInfoType CPU::runLoop()
     {
-        cyclesLeft += cycles;
-
-        uint32_t prevPC;
-
-        while (cyclesLeft > 0) {
-
-            switch (state.execState) {
-                // We have 5 state bits that may interleave -> 2^5 cases = 32
-                REP_CASE_CONSTEXPR(32, uint8_t, 0, execStep<offset>(prevPC));
-                default:
-                    state.executionInfo.message << "ERROR unhandled CPU state: 0x" << std::hex << static_cast<uint32_t>(state.execState) << std::endl;
-                    // Fall through
-                case CPUState::EXEC_ERROR:
-                    state.executionInfo.message << "ERROR: Instruction at: 0x" << std::hex << prevPC << " has caused an exception\n";
-                    state.executionInfo.infoType = CPUExecutionInfoType::EXCEPTION;
-                    return CPUExecutionInfoType::EXCEPTION;
-                    break;
+        uint32_t prevPC = state.getCurrentPC();
+
+        do {
+            // Hardware events may have changed the memory polled by a busy waiting loop
+            idleLoops.disarm();
+
+            // cyclesLeft counts down to the next scheduled event
+            while (cyclesLeft > 0) {
+
+                switch (state.execState) {
+                    // We have 4 state bits that may interleave -> 2^4 cases = 16
+                    REP_CASE_CONSTEXPR(16, uint8_t, 0, execStep<offset, debug>(prevPC));
+                    default:
+                        state.executionInfo->message << "ERROR unhandled CPU state: 0x" << std::hex << static_cast<uint32_t>(state.execState) << std::endl;
+                        // Fall through
+                    case CPUState::EXEC_ERROR:
+                        state.executionInfo->message << "ERROR: Instruction at: 0x" << std::hex << prevPC << " has caused an exception\n";
+                        state.executionInfo->infoType = CPUExecutionInfoType::EXCEPTION;
+                        return CPUExecutionInfoType::EXCEPTION;
+                        break;
+                }
+
+                if (debug && debugBreak) {
+                    debugBreak = false;
+                    return CPUExecutionInfoType::NORMAL;
+                }
             }
-        }
+
+            scheduler.processEvents();
+        } while (!scheduler.consumeStop());
 
         return CPUExecutionInfoType::NORMAL;
     }
 
+    CPUExecutionInfoType CPU::step(uint32_t cycles)
+    {
+        stepTarget += cycles;
+        scheduler.schedule(Scheduler::STEP_END, stepTarget);
+
+        return run();
+    }
+
     // Use a template so that most ifs are constexpr -> better loop performance
-    template <uint8_t execState>
+    template <uint8_t execState, bool debug>
     void CPU::execStep(uint32_t &prevPC)
     {
         uint32_t currentPC = state.getCurrentPC();
@@ -96,11 +146,23 @@ namespace gbaemu
 
             // If dma executes cpu is stalled!
             if (execState & CPUState::EXEC_DMA) {
-                dmaGroup.step(state.cpuInfo, cyclesLeft);
+                PerfStats::Scope scope(&perfStats, PerfStats::DMA);
+
+                // DMAs run at the nominal clock, even if the CPU is overclocked. Rounding up guarantees progress.
+                dmaGroup.step(state.cpuInfo, static_cast<uint32_t>(scheduler.toNominalCycles(cyclesLeft, true)));
+                if (perfStats.isEnabled())
+                    perfStats.addCycles(PerfStats::CYCLES_DMA, state.cpuInfo.cycleCount);
+                state.cpuInfo.cycleCount = static_cast<uint32_t>(scheduler.toCPUCycles(state.cpuInfo.cycleCount, true));
             } else {
                 if (execState & CPUState::EXEC_HALT) {
                     irqHandler.checkForHaltCondition(state.haltCondition);
-                    state.cpuInfo.cycleCount = 1;
+
+                    // Interrupts are only requested by scheduled events (LCD, timers), by DMAs (which leave the
+                    // halt state) or by the keypad between frames. Until the next event the condition can not
+                    // change, so skip directly to it instead of checking every single cycle.
+                    state.cpuInfo.cycleCount = (state.execState & CPUState::EXEC_HALT) && cyclesLeft > 1 ? cyclesLeft : 1;
+                    if (perfStats.isEnabled())
+                        perfStats.addCycles(PerfStats::CYCLES_HALT, static_cast<uint64_t>(scheduler.toNominalCycles(state.cpuInfo.cycleCount)));
                 } else {
                     // We can only execute the interrupt if not disabled by CPSR register and if so we need a state change because we need to change into arm mode!
                     if (execState & CPUState::EXEC_IRQ && !state.getFlag<cpsr_flags::IRQ_DISABLE>()) {
@@ -108,35 +170,90 @@ namespace gbaemu
                         irqHandler.callIRQHandler();
                         // we jump to bios, so there must be a currentPC update even if the state does not change!
                         currentPC = state.getCurrentPC();
+                    } else if (!debug && !profileHandlers && !(execState & (CPUState::EXEC_DMA | CPUState::EXEC_IRQ)) && (aot.isEnabled() || jit.isEnabled()) &&
+                               !blockCache.continuesBlock<(execState & CPUState::EXEC_THUMB) != 0>(currentPC) &&
+                               (aot.execute<(execState & CPUState::EXEC_THUMB) != 0>(currentPC, state.pipeline[1]) ||
+                                (jit.isEnabled() && jit.execute<(execState & CPUState::EXEC_THUMB) != 0>(currentPC, state.pipeline[1], prevPC)))) {
+                        // compiled or translated code did the bookkeeping, cycles still in cycleCount are accounted below
+                        currentPC = state.getCurrentPC();
+
+                        // short backward branches might be busy waiting loops
+                        if (currentPC <= prevPC && prevPC - currentPC <= IdleLoopDetector::MAX_LOOP_SIZE) {
+                            idleLoops.onBackwardBranch<(execState & CPUState::EXEC_THUMB) != 0>(currentPC);
+                        }
                     } else {
                         // forward the pipeline
                         uint32_t inst = state.pipeline[1];
                         state.pipeline[1] = state.pipeline[0];
 
                         if (execState & CPUState::EXEC_THUMB) {
-                            // fetch new instruction to fill the pipeline
                             // already increment PC
                             state.getPC() = currentPC + 2;
-                            state.pipeline[0] = state.memory.readInst16(currentPC + 4, state.cpuInfo);
-                            (this->*thumbExeLUT[hashThumb(inst)])(inst);
+
+                            const BlockCache::DecodedInst *decoded = blockCache.next<true>(currentPC, inst, state.memory, thumbExeLUT);
+#ifdef THREADED_DISPATCH
+                            if (decoded && !debug && !profileHandlers) {
+                                prevPC = execThreaded(decoded);
+                            } else if (decoded) {
+#else
+                            if (decoded) {
+#endif
+                                // the fetch was already done when the block was decoded
+                                state.pipeline[0] = decoded->prefetch;
+                                state.cpuInfo.cycleCount += decoded->fetchCycles;
+                                state.cpuInfo.memReg = decoded->memReg;
+                                // superinstructions would hide the second instruction from the debugger & the profile
+                                (this->*(debug || profileHandlers ? decoded->handler : decoded->dispatch))(inst);
+                            } else {
+                                // fetch new instruction to fill the pipeline
+                                state.pipeline[0] = state.fetchInst<true>(currentPC + 4);
+                                (this->*thumbExeLUT[hashThumb(inst)])(inst);
+                            }
                         } else {
-                            // fetch new instruction to fill the pipeline
                             // already increment PC
                             state.getPC() = currentPC + 4;
-                            state.pipeline[0] = state.memory.readInst32(currentPC + 8, state.cpuInfo);
-                            if (conditionSatisfied(static_cast<ConditionOPCode>(inst >> 28), state)) {
-                                (this->*armExeLUT[hashArm(inst)])(inst);
+
+                            const BlockCache::DecodedInst *decoded = blockCache.next<false>(currentPC, inst, state.memory, armExeLUT);
+#ifdef THREADED_DISPATCH
+                            if (decoded && !debug && !profileHandlers) {
+                                prevPC = execThreaded(decoded);
+                            } else if (decoded) {
+#else
+                            if (decoded) {
+#endif
+                                // the fetch was already done when the block was decoded
+                                state.pipeline[0] = decoded->prefetch;
+                                state.cpuInfo.cycleCount += decoded->fetchCycles;
+                                state.cpuInfo.memReg = decoded->memReg;
+                                if (!decoded->conditional || conditionSatisfied(static_cast<ConditionOPCode>(inst >> 28), state)) {
+                                    // superinstructions would hide the second instruction from the debugger & the profile
+                                    (this->*(debug || profileHandlers ? decoded->handler : decoded->dispatch))(inst);
+                                }
+                            } else {
+                                // fetch new instruction to fill the pipeline
+                                state.pipeline[0] = state.fetchInst<false>(currentPC + 8);
+                                if (conditionSatisfied(static_cast<ConditionOPCode>(inst >> 28), state)) {
+                                    (this->*armExeLUT[hashArm(inst)])(inst);
+                                }
                             }
                         }
+#ifdef PROFILE_HANDLERS
+                        handlerProfile.record<(execState & CPUState::EXEC_THUMB) != 0>(inst, state.cpuInfo.cycleCount);
+#endif
                         currentPC = state.getCurrentPC();
 
+                        // short backward branches might be busy waiting loops
+                        if (currentPC <= prevPC && prevPC - currentPC <= IdleLoopDetector::MAX_LOOP_SIZE) {
+                            idleLoops.onBackwardBranch<(execState & CPUState::EXEC_THUMB) != 0>(currentPC);
+                        }
+
 #if false
                         // PC sanity checks
                         if (state.memory.extractMemoryRegion(currentPC) == memory::BIOS && currentPC >= state.memory.getBiosSize()) {
-                            state.executionInfo.message << "CRITIAL ERROR: PC(0x" << std::hex << currentPC << ") points to bios address outside of our code! Aborting!" << std::endl;
+                            state.executionInfo->message << "CRITIAL ERROR: PC(0x" << std::hex << currentPC << ") points to bios address outside of our code! Aborting!" << std::endl;
                             state.execState = CPUState::EXEC_ERROR;
                         } else if (state.memory.extractMemoryRegion(currentPC) >= memory::EXT_ROM1 && currentPC >= memory::EXT_ROM_OFFSET + state.memory.getRomSize()) {
-                            state.executionInfo.message << "CRITIAL ERROR: PC(0x" << std::hex << currentPC << ") points out to address out of its ROM bounds! Aborting!" << std::endl;
+                            state.executionInfo->message << "CRITIAL ERROR: PC(0x" << std::hex << currentPC << ") points out to address out of its ROM bounds! Aborting!" << std::endl;
                             state.execState = CPUState::EXEC_ERROR;
                         }
 #endif
@@ -144,12 +261,12 @@ namespace gbaemu
                 }
             }
 
-            // always execute the timer with the given time that lapsed
-            if (execState & CPUState::EXEC_TIMER) {
-                timerGroup.step(state.cpuInfo.cycleCount);
-            }
-
             cyclesLeft -= state.cpuInfo.cycleCount;
+
+            if (debug && debugHook->afterStep(prevPC, state.getCurrentPC())) {
+                debugBreak = true;
+                return;
+            }
         } while (cyclesLeft > 0 && execState == state.execState);
     }
 
@@ -179,15 +296,19 @@ namespace gbaemu
 
         // We need to fill the pipeline to the state where the instruction at PC is ready for execution -> fetched + decoded!
         uint32_t pc = state.normalizePC<thumbMode>();
+        if (profiler.isEnabled())
+            profiler.onBranch(pc);
         state.memory.setExecInsideBios(false);
+        // the fetch window of the new location is set up by the first fetch
+        state.invalidateFetchWindow();
         if (thumbMode) {
-            state.pipeline[1] = state.memory.readInst16(pc, state.cpuInfo);
-            state.pipeline[0] = state.memory.readInst16(pc + 2, state.cpuInfo);
+            state.pipeline[1] = state.fetchInst<true>(pc);
+            state.pipeline[0] = state.fetchInst<true>(pc + 2);
             state.seqCycles = state.memory.memCycles16(state.cpuInfo.memReg, true);
             state.nonSeqCycles = state.memory.memCycles16(state.cpuInfo.memReg, false);
         } else {
-            state.pipeline[1] = state.memory.readInst32(pc, state.cpuInfo);
-            state.pipeline[0] = state.memory.readInst32(pc + 4, state.cpuInfo);
+            state.pipeline[1] = state.fetchInst<false>(pc);
+            state.pipeline[0] = state.fetchInst<false>(pc + 4);
             state.seqCycles = state.memory.memCycles32(state.cpuInfo.memReg, true);
             state.nonSeqCycles = state.memory.memCycles32(state.cpuInfo.memReg, false);
         }
@@ -206,8 +327,18 @@ namespace gbaemu
         keypad.reset();
 
         state.memory.ioHandler.cpu = this;
+        state.memory.blockCache = &blockCache;
+        blockCache.flush();
+        jit.flush();
+        idleLoops.reset();
+        profiler.resetCalls();
+#ifdef PROFILE_HANDLERS
+        handlerProfile.reset();
+#endif
 
-        cyclesLeft = 0;
+        // The scheduler keeps running, hardware events like the LCD ones stay pending
+        scheduler.cancel(Scheduler::STEP_END);
+        stepTarget = scheduler.now();
     }
 
     template void CPU::refillPipelineAfterBranch<true>();
@@ -1,13 +1,21 @@
 #ifndef CPU_HPP
 #define CPU_HPP
 
+#include "aot.hpp"
+#include "block_cache.hpp"
 #include "cpu_state.hpp"
 #include "decode/inst.hpp"
+#include "guest_profiler.hpp"
+#include "handler_profile.hpp"
+#include "idle_loop.hpp"
 #include "io/dma.hpp"
 #include "io/interrupts.hpp"
 #include "io/keypad.hpp"
 #include "io/timer.hpp"
+#include "jit.hpp"
+#include "perf_stats.hpp"
 #include "regs.hpp"
+#include "scheduler.hpp"
 
 #include <cstdint>
 
@@ -28,6 +36,21 @@ namespace gbaemu
         class LCDController;
     }
 
+    /*
+        Interface of a debugger that can be attached to the CPU at runtime. While one is attached CPU::run uses
+        separate instantiations of the execution loop that call it after every step and execute every instruction
+        on its own (no AOT or JIT code, threaded dispatch or superinstructions). The instantiations used otherwise do
+        not contain any checks.
+     */
+    class DebugHook
+    {
+      public:
+        virtual ~DebugHook() = default;
+
+        // Called after an instruction, DMA or halt step, returns true to stop CPU::run before the next one
+        virtual bool afterStep(uint32_t prevPC, uint32_t pc) = 0;
+    };
+
     class CPU
     {
 
@@ -39,26 +62,105 @@ namespace gbaemu
         static const InstExecutor thumbExeLUT[1024];
         static const InstExecutor armExeLUT[4096];
 
+        // Superinstructions for frequent instruction pairs, see superinstructions.tpp
+        static const BlockCache::FusedPair thumbFusedPairs[];
+        static const uint32_t thumbFusedPairCount;
+        static const BlockCache::FusedPair armFusedPairs[];
+        static const uint32_t armFusedPairCount;
+
+        template <bool thumb, InstExecutor first, InstExecutor second>
+        void execFusedPair(uint32_t inst);
+
+#ifdef THREADED_DISPATCH
+        static const BlockCache::ThreadedExecutor thumbThreadedLUT[1024];
+        static const BlockCache::ThreadedExecutor armThreadedLUT[4096];
+
+        template <bool thumb, InstExecutor handler>
+        static uint32_t threadedStep(CPU &cpu, const BlockCache::DecodedInst *decoded);
+
+        // Executes decoded & the following instructions of its block, returns the address of the last executed one
+        uint32_t execThreaded(const BlockCache::DecodedInst *decoded)
+        {
+#ifdef THREADED_TAIL_CALL
+            // the handlers continue with the following instructions of the block themselves
+            return decoded->threaded(*this, decoded);
+#else
+            uint32_t pc;
+            do {
+                pc = decoded->threaded(*this, decoded);
+                decoded = threadedNext;
+            } while (decoded);
+            return pc;
+#endif
+        }
+#endif
+
       public:
+        // Starts with the state used by every instruction, see CPUState
         CPUState state;
 
+        // Cycles until the next scheduled event, see Scheduler. Shares its cache line with the block cache cursor.
+        alignas(64) int32_t cyclesLeft;
+#if defined(THREADED_DISPATCH) && !defined(THREADED_TAIL_CALL)
+        // instruction to continue with after threadedStep returned, nullptr if execStep has to take over
+        const BlockCache::DecodedInst *threadedNext;
+#endif
+        BlockCache blockCache;
+        JIT jit;
+        AOT aot;
+        IdleLoopDetector idleLoops;
+        GuestProfiler profiler;
+        PerfStats perfStats;
+#ifdef PROFILE_HANDLERS
+        HandlerProfile handlerProfile;
+#endif
+
+        // Only used when events are due or by IO accesses
+        Scheduler scheduler;
+
+        InterruptHandler irqHandler;
+
         DMAGroup dmaGroup;
 
         TimerGroup timerGroup;
 
-        InterruptHandler irqHandler;
         Keypad keypad;
 
-        int32_t cyclesLeft;
+      private:
+        // Timestamp the cycle budgets given to step add up to
+        uint64_t stepTarget;
+
+        DebugHook *debugHook;
+        // set if the debug hook requested a stop
+        bool debugBreak;
 
+      public:
         CPU();
 
         void setLCDController(lcd::LCDController *lcdController);
 
         void reset();
 
+        // Runs the CPU & handles all events until an event handler requests a stop (e.g. at the end of a frame)
+        CPUExecutionInfoType run();
+
+        // Runs for the given amount of cycles, surplus cycles of the last instruction are subtracted from the next call
         CPUExecutionInfoType step(uint32_t cycles);
 
+        /*
+            Attaches a debugger or detaches it with nullptr. Takes effect with the next call of run / step, run returns
+            early (with NORMAL) if the debugger requests a stop.
+         */
+        void setDebugHook(DebugHook *hook)
+        {
+            debugHook = hook;
+        }
+
+        bool isDebuggerAttached() const
+        {
+            return debugHook != nullptr;
+        }
+
         void patchFetchToNCycle();
         template <bool thumbMode>
         void refillPipelineAfterBranch();
@@ -66,7 +168,10 @@ namespace gbaemu
         void refillPipeline();
 
       private:
-        template <uint8_t execState>
+        template <bool debug>
+        CPUExecutionInfoType runLoop();
+
+        template <uint8_t execState, bool debug>
         void execStep(uint32_t &prevPC);
 
       public:
@@ -84,26 +189,8 @@ namespace gbaemu
             of bit 31 of the result (indicating a negative result if the operands are considered to be
             2’s complement signed).
             */
-            bool negative = (resultValue) & (static_cast<uint64_t>(1) << 31);
-            bool zero = (resultValue & 0x0FFFFFFFF) == 0;
-            bool overflow = msbOp1 == msbOp2 && (negative != msbOp1);
-            bool carry = resultValue & (static_cast<uint64_t>(1) << 32);
-
-            if (nFlag) {
-                state.setFlag<cpsr_flags::N_FLAG>(negative);
-            }
-
-            if (zFlag) {
-                state.setFlag<cpsr_flags::Z_FLAG>(zero);
-            }
-
-            if (vFlag) {
-                state.setFlag<cpsr_flags::V_FLAG>(overflow);
-            }
-
-            if (cFlag) {
-                state.setFlag<cpsr_flags::C_FLAG>(carry != invertCarry);
-            }
+            // The flags are only evaluated when needed
+            state.setALUFlags<nFlag, zFlag, vFlag, cFlag, invertCarry>(resultValue, msbOp1, msbOp2);
         }
 
         // ARM instructions execution helpers
@@ -148,6 +235,16 @@ namespace gbaemu
         template <InstructionID id>
         void handleThumbBranchXCHG(uint32_t inst);
 
+        // Handlers of the LUTs, used by ahead of time compiled code (see aot_block.hpp)
+        static InstExecutor thumbHandler(uint16_t hash)
+        {
+            return thumbExeLUT[hash];
+        }
+        static InstExecutor armHandler(uint16_t hash)
+        {
+            return armExeLUT[hash];
+        }
+
         template <uint16_t hash>
         static constexpr InstExecutor resolveThumbHashHandler();
 
@@ -59,7 +59,7 @@ namespace gbaemu
         uint8_t rs = thumb ? ((instruction >> 3) & 0x7) : ((instruction >> 8) & 0x0F);
         uint8_t rm = thumb ? (rd) : (instruction & 0x0F);
 
-#ifdef DEBUG_CLI
+#ifdef DEBUG_CPU
         // Check given restrictions
         if (rd == regs::PC_OFFSET || rn == regs::PC_OFFSET || rs == regs::PC_OFFSET || rm == regs::PC_OFFSET) {
             std::cout << "ERROR: MUL/MLA PC register may not be involved in calculations!" << std::endl;
@@ -67,9 +67,9 @@ namespace gbaemu
 #endif
 
         auto currentRegs = state.getCurrentRegs();
-        const uint32_t rmVal = *currentRegs[rm];
-        const uint32_t rsVal = *currentRegs[rs];
-        const uint32_t rnVal = *currentRegs[rn];
+        const uint32_t rmVal = currentRegs[rm];
+        const uint32_t rsVal = currentRegs[rs];
+        const uint32_t rnVal = currentRegs[rn];
 
         uint32_t mulRes = rmVal * rsVal;
 
@@ -77,7 +77,7 @@ namespace gbaemu
             mulRes += rnVal;
         }
 
-        *currentRegs[rd] = static_cast<uint32_t>(mulRes & 0x0FFFFFFFF);
+        currentRegs[rd] = static_cast<uint32_t>(mulRes & 0x0FFFFFFFF);
 
         if (s) {
             // update zero flag & signed flags
@@ -119,7 +119,7 @@ namespace gbaemu
         uint8_t rs = (instruction >> 8) & 0x0F;
         uint8_t rm = instruction & 0x0F;
 
-#ifdef DEBUG_CLI
+#ifdef DEBUG_CPU
         if (rd_lsw == rd_msw || rd_lsw == rm || rd_msw == rm) {
             std::cout << "ERROR: SMULL/SMLAL/UMULL/UMLAL lo, high & rm registers may not be the same!" << std::endl;
         }
@@ -130,12 +130,12 @@ namespace gbaemu
 
         auto currentRegs = state.getCurrentRegs();
 
-        const uint64_t rdVal = (static_cast<uint64_t>(*currentRegs[rd_msw]) << 32) | *currentRegs[rd_lsw];
+        const uint64_t rdVal = (static_cast<uint64_t>(currentRegs[rd_msw]) << 32) | currentRegs[rd_lsw];
 
         uint64_t mulRes;
 
-        const uint32_t unExtRmVal = *currentRegs[rm];
-        const uint32_t unExtRsVal = *currentRegs[rs];
+        const uint32_t unExtRmVal = currentRegs[rm];
+        const uint32_t unExtRsVal = currentRegs[rs];
 
         if (!signMul) {
             uint64_t rmVal = static_cast<uint64_t>(unExtRmVal);
@@ -160,8 +160,8 @@ namespace gbaemu
             mulRes = static_cast<uint64_t>(signedMulRes);
         }
 
-        *currentRegs[rd_msw] = static_cast<uint32_t>((mulRes >> 32) & 0x0FFFFFFFF);
-        *currentRegs[rd_lsw] = static_cast<uint32_t>(mulRes & 0x0FFFFFFFF);
+        currentRegs[rd_msw] = static_cast<uint32_t>((mulRes >> 32) & 0x0FFFFFFFF);
+        currentRegs[rd_lsw] = static_cast<uint32_t>(mulRes & 0x0FFFFFFFF);
 
         if (s) {
             // update zero flag & signed flags
@@ -204,15 +204,15 @@ namespace gbaemu
         uint8_t rd = (instruction >> 12) & 0x0F;
         uint8_t rm = instruction & 0x0F;
 
-#ifdef DEBUG_CLI
+#ifdef DEBUG_CPU
         if (rd == regs::PC_OFFSET || rn == regs::PC_OFFSET || rm == regs::PC_OFFSET) {
             std::cout << "ERROR: SWP/SWPB PC register may not be involved in calculations!" << std::endl;
         }
 #endif
 
         auto currentRegs = state.getCurrentRegs();
-        uint32_t newMemVal = *currentRegs[rm];
-        uint32_t memAddr = *currentRegs[rn];
+        uint32_t newMemVal = currentRegs[rm];
+        uint32_t memAddr = currentRegs[rn];
 
         // Execution Time: 1S+2N+1I. That is, 2N data cycles (added through Memory class), 1S code cycle, plus 1I(initial value)
 
@@ -221,12 +221,12 @@ namespace gbaemu
         if (b) {
             uint8_t memVal = state.memory.read8(memAddr, state.cpuInfo, false);
             state.memory.write8(memAddr, static_cast<uint8_t>(newMemVal & 0x0FF), state.cpuInfo);
-            *currentRegs[rd] = static_cast<uint32_t>(memVal);
+            currentRegs[rd] = static_cast<uint32_t>(memVal);
         } else {
             // LDR part
             uint32_t alignedWord = state.memory.read32(memAddr, state.cpuInfo, false);
             alignedWord = shifts::rorShiftValueUnalignedAddr(alignedWord, (memAddr & 0x03) * 8);
-            *currentRegs[rd] = alignedWord;
+            currentRegs[rd] = alignedWord;
 
             // STR part
             state.memory.write32(memAddr, newMemVal, state.cpuInfo);
@@ -246,14 +246,17 @@ namespace gbaemu
         if (link) {
             // Note that pc is already incremented by 4
             // Next instruction should be at: PC + 4
-            *currentRegs[regs::LR_OFFSET] = *currentRegs[regs::PC_OFFSET];
+            currentRegs[regs::LR_OFFSET] = currentRegs[regs::PC_OFFSET];
         }
 
         // Offset is given in units of 4. Thus we need to shift it first by two
         offset <<= 2;
 
         // Note that pc is already incremented by 4
-        *currentRegs[regs::PC_OFFSET] += static_cast<uint32_t>(4 + offset);
+        currentRegs[regs::PC_OFFSET] += static_cast<uint32_t>(4 + offset);
+
+        if (link && profiler.isEnabled())
+            profiler.onCall(currentRegs[regs::PC_OFFSET], currentRegs[regs::LR_OFFSET]);
 
         // Execution Time: 2S + 1N
         // This is a branch instruction so we need to refill the pipeline!
@@ -267,12 +270,12 @@ namespace gbaemu
         auto currentRegs = state.getCurrentRegs();
 
         // Load the content of register given by rm
-        uint32_t rnValue = *currentRegs[rn];
+        uint32_t rnValue = currentRegs[rn];
         // If the first bit of rn is set
         bool changeToThumb = rnValue & 0x00000001;
 
         // Change the PC to the address given by rm. Note that we have to mask out the thumb switch bit.
-        *currentRegs[regs::PC_OFFSET] = rnValue & 0xFFFFFFFE;
+        currentRegs[regs::PC_OFFSET] = rnValue & 0xFFFFFFFE;
 
         // Execution Time: 2S + 1N
         // This is a branch instruction so we need to refill the pipeline!
@@ -374,12 +377,12 @@ namespace gbaemu
 
             if (shiftAmountFromReg) {
                 uint8_t rs = (operand2 >> 8) & 0x0F;
-                shiftAmount = *currentRegs[rs];
+                shiftAmount = currentRegs[rs];
             } else {
                 shiftAmount = (operand2 >> 7) & 0b11111;
             }
 
-            uint32_t rmValue = *currentRegs[rm];
+            uint32_t rmValue = currentRegs[rm];
 
             if (rm == regs::PC_OFFSET) {
                 // Note that pc is already incremented by 2/4
@@ -399,7 +402,7 @@ namespace gbaemu
         bool shifterOperandCarry = shifterOperand & (static_cast<uint64_t>(1) << 32);
         shifterOperand &= 0xFFFFFFFF;
 
-        uint64_t rnValue = *currentRegs[rn];
+        uint64_t rnValue = currentRegs[rn];
         if (rn == regs::PC_OFFSET) {
             // Note that pc is already incremented by 2 / 4
             // When using R15 as operand (Rm or Rn), the returned value depends on the instruction:
@@ -453,7 +456,7 @@ namespace gbaemu
                 constexpr bool r = id == MRS_SPSR;
 
                 if (r)
-                    resultValue = *currentRegs[regs::SPSR_OFFSET];
+                    resultValue = state.getCurrentSPSR();
                 else
                     resultValue = state.getCurrentCPSR();
                 break;
@@ -480,8 +483,8 @@ namespace gbaemu
                 if (r) {
                     rd = regs::SPSR_OFFSET;
                     // clear fields that should be written to
-                    resultValue |= *currentRegs[regs::SPSR_OFFSET] & ~bitMask;
-                    *currentRegs[regs::SPSR_OFFSET] = resultValue;
+                    resultValue |= state.accessSPSR() & ~bitMask;
+                    state.accessSPSR() = resultValue;
                 } else {
                     rd = 16 /*regs::CPSR_OFFSET*/;
                     // clear fields that should be written to
@@ -526,7 +529,7 @@ namespace gbaemu
                 break;
 
             default:
-                state.executionInfo.message << "ERROR: execDataProc can not handle instruction: " << instructionIDToString(id) << std::endl;
+                state.executionInfo->message << "ERROR: execDataProc can not handle instruction: " << instructionIDToString(id) << std::endl;
                 state.execState = CPUState::EXEC_ERROR;
                 break;
         }
@@ -535,7 +538,7 @@ namespace gbaemu
 
         // Special case 9000
         if (movSPSR && s && destPC) {
-            state.updateCPSR(*currentRegs[regs::SPSR_OFFSET]);
+            state.updateCPSR(state.getCurrentSPSR());
         } else if (s) {
             setFlags<updateNegative,
                      updateZero,
@@ -553,7 +556,7 @@ namespace gbaemu
         }
 
         if (!dontUpdateRD)
-            *currentRegs[rd] = static_cast<uint32_t>(resultValue);
+            currentRegs[rd] = static_cast<uint32_t>(resultValue);
 
         if (destPC) {
             refillPipeline();
@@ -592,11 +595,13 @@ namespace gbaemu
           register related to the current mode, such like R14_svc etc.)
           Base write-back should not be used for User bank transfer.
         */
-        if (forceUserRegisters && (!load || (rList & (1 << regs::PC_OFFSET)) == 0)) {
-            currentRegs = state.getModeRegs(CPUState::UserMode);
+        const bool userBankTransfer = forceUserRegisters && (!load || (rList & (1 << regs::PC_OFFSET)) == 0);
+        if (userBankTransfer) {
+            // swap the user registers in, the registers of the current mode are restored after the transfer
+            state.switchRegisterBank(CPUState::UserMode);
         }
 
-        uint32_t address = *currentRegs[rn];
+        uint32_t address = currentRegs[rn];
 
         // Execution Time:
         // For normal LDM, nS+1N+1I. For LDM PC, (n+1)S+2N+1I.
@@ -621,9 +626,9 @@ namespace gbaemu
 
             // Empty Rlist: R15 loaded/stored (ARMv4 only), and Rb=Rb+/-40h (ARMv4-v5).
             if (up)
-                *currentRegs[rn] += 0x40;
+                currentRegs[rn] += 0x40;
             else
-                *currentRegs[rn] -= 0x40;
+                currentRegs[rn] -= 0x40;
 
             /*
             empty rlist edge cases:
@@ -645,14 +650,17 @@ namespace gbaemu
             }
 
             if (load) {
-                *currentRegs[regs::PC_OFFSET] = state.memory.read32(address, state.cpuInfo, true);
+                currentRegs[regs::PC_OFFSET] = state.memory.read32(address, state.cpuInfo, true);
                 refillPipelineAfterBranch<thumb>();
             } else {
                 // Note that pc is already incremented by 2/4
                 // Edge case of storing PC -> PC + 12 will be stored
-                state.memory.write32(address, *currentRegs[regs::PC_OFFSET] + (thumb ? 4 : 8), state.cpuInfo, true);
+                state.memory.write32(address, currentRegs[regs::PC_OFFSET] + (thumb ? 4 : 8), state.cpuInfo, true);
             }
 
+            if (userBankTransfer)
+                state.switchRegisterBank(state.cpsr.mode);
+
             // fully handled edge case
             return;
         }
@@ -676,10 +684,10 @@ namespace gbaemu
         // Also do the write back to the register!
         if (!up && writeback) {
             // If decrementing we already have the correct address!
-            *currentRegs[rn] = address;
+            currentRegs[rn] = address;
         } else if (up && writeback) {
             // If incrementing we have to calculate the final address first
-            *currentRegs[rn] += (static_cast<uint32_t>(bitsSet) << 2);
+            currentRegs[rn] += (static_cast<uint32_t>(bitsSet) << 2);
         }
 
         // Edge case: writeback enabled & rn is inside rlist
@@ -699,6 +707,26 @@ namespace gbaemu
 
         bool loadedPC = load && (patchRList || (rList & (1 << regs::PC_OFFSET)));
 
+        // Fast path for plain memory (mostly stack accesses in IWRAM): the region is resolved once for the whole burst
+        // and the words are copied directly, rList is cleared so the per word accesses below are skipped
+        if (rList != 0) {
+            const uint32_t firstAddr = up == pre ? address + 4 : address;
+
+            if (load) {
+                if (const uint32_t *src = state.memory.readBurst32(firstAddr, popcnt(rList), state.cpuInfo)) {
+                    for (; rList != 0; rList &= rList - 1)
+                        currentRegs[ctz(rList)] = le(*src++);
+                }
+            } else {
+                if (uint32_t *dst = state.memory.writeBurst32(firstAddr, popcnt(rList), state.cpuInfo)) {
+                    for (; rList != 0; rList &= rList - 1) {
+                        uint8_t currentIdx = ctz(rList);
+                        *dst++ = le(currentRegs[currentIdx] + (currentIdx == regs::PC_OFFSET ? (thumb ? 4 : 8) : 0));
+                    }
+                }
+            }
+        }
+
         // shout-outs to https://smolka.dev/eggvance/progress-5/
         for (; rList != 0; rList &= rList - 1) {
             uint8_t currentIdx = ctz(rList);
@@ -709,11 +737,11 @@ namespace gbaemu
             }
 
             if (load) {
-                *currentRegs[currentIdx] = state.memory.read32(address, state.cpuInfo, true);
+                currentRegs[currentIdx] = state.memory.read32(address, state.cpuInfo, true);
             } else {
                 // Note that pc is already incremented by 2/4
                 // Edge case of storing PC -> PC + 12 will be stored
-                state.memory.write32(address, *currentRegs[currentIdx] + (currentIdx == regs::PC_OFFSET ? (thumb ? 4 : 8) : 0), state.cpuInfo, true);
+                state.memory.write32(address, currentRegs[currentIdx] + (currentIdx == regs::PC_OFFSET ? (thumb ? 4 : 8) : 0), state.cpuInfo, true);
             }
 
             if (up != pre) {
@@ -721,6 +749,9 @@ namespace gbaemu
             }
         }
 
+        if (userBankTransfer)
+            state.switchRegisterBank(state.cpsr.mode);
+
         if (loadedPC) {
             // More special cases
             /*
@@ -730,7 +761,7 @@ namespace gbaemu
             */
             // Special case for pipeline refill
             if (forceUserRegisters) {
-                state.updateCPSR(state.accessReg(regs::SPSR_OFFSET));
+                state.updateCPSR(state.getCurrentSPSR());
             }
 
             refillPipeline();
@@ -823,13 +854,8 @@ namespace gbaemu
 
         auto currentRegs = state.getCurrentRegs();
 
-        if (!pre) {
-            constexpr bool forceNonPrivAccess = writeback;
-            // I assume that we access user regs... because user mode is the only non-priviledged mode
-            if (forceNonPrivAccess) {
-                currentRegs = state.getModeRegs(CPUState::UserMode);
-            }
-        }
+        // Post indexed with writeback (LDRT/STRT) forces a non privileged memory access, this makes no difference
+        // on the GBA as there is no memory protection. The registers of the current mode are used anyway.
 
         /* these are computed in the next step */
         uint32_t memoryAddress;
@@ -853,11 +879,11 @@ namespace gbaemu
             auto shiftType = static_cast<shifts::ShiftType>((addrMode >> 5) & 0b11);
             uint8_t rm = addrMode & 0xF;
 
-            offset = shifts::shift<true>(*currentRegs[rm], shiftType, shiftAmount, state.getFlag<cpsr_flags::C_FLAG>()) & 0xFFFFFFFF;
+            offset = shifts::shift<true>(currentRegs[rm], shiftType, shiftAmount, state.getFlag<cpsr_flags::C_FLAG>()) & 0xFFFFFFFF;
         }
 
-        uint32_t rnValue = *currentRegs[rn];
-        uint32_t rdValue = *currentRegs[rd];
+        uint32_t rnValue = currentRegs[rn];
+        uint32_t rdValue = currentRegs[rd];
 
         bool isRnPC = rn == regs::PC_OFFSET;
         bool isRdPC = rd == regs::PC_OFFSET;
@@ -889,7 +915,7 @@ namespace gbaemu
         /* transfer */
         if (load) {
             if (byte) {
-                *currentRegs[rd] = state.memory.read8(memoryAddress, state.cpuInfo, false);
+                currentRegs[rd] = state.memory.read8(memoryAddress, state.cpuInfo, false);
             } else {
                 // More edge case:
                 /*
@@ -901,7 +927,7 @@ namespace gbaemu
                 */
                 uint32_t alignedWord = state.memory.read32(memoryAddress, state.cpuInfo, false);
                 alignedWord = shifts::rorShiftValueUnalignedAddr(alignedWord, (memoryAddress & 0x03) * 8);
-                *currentRegs[rd] = alignedWord;
+                currentRegs[rd] = alignedWord;
             }
         } else {
             if (byte) {
@@ -917,7 +943,7 @@ namespace gbaemu
                 memoryAddress += offset;
             }
 
-            *currentRegs[rn] = memoryAddress;
+            currentRegs[rn] = memoryAddress;
 
             if (isRnPC) {
                 //TODO this is a very odd edge case!
@@ -1048,8 +1074,8 @@ namespace gbaemu
             patchFetchToNCycle();
         }
 
-        uint32_t rnValue = *currentRegs[rn];
-        uint32_t rdValue = *currentRegs[rd];
+        uint32_t rnValue = currentRegs[rn];
+        uint32_t rdValue = currentRegs[rd];
 
         bool isRnPC = rn == regs::PC_OFFSET;
         bool isRdPC = rd == regs::PC_OFFSET;
@@ -1097,7 +1123,7 @@ namespace gbaemu
                 }
             }
 
-            *currentRegs[rd] = readData;
+            currentRegs[rd] = readData;
         } else {
             if (transferSize == 16) {
                 state.memory.write16(memoryAddress, rdValue, state.cpuInfo);
@@ -1111,7 +1137,7 @@ namespace gbaemu
                 memoryAddress += offset;
             }
 
-            *currentRegs[rn] = memoryAddress;
+            currentRegs[rn] = memoryAddress;
 
             if (isRnPC) {
                 //TODO this is a very odd edge case!
@@ -1129,4 +1155,6 @@ namespace gbaemu
 
 #include "create_arm_lut.tpp"
 
-#include "cpu_thumb.tpp"
\ No newline at end of file
+#include "cpu_thumb.tpp"
+
+#include "superinstructions.tpp"
@@ -5,6 +5,7 @@
 #include "util.hpp"
 
 #include <algorithm>
+#include <cstddef>
 #include <functional>
 #include <iomanip>
 #include <iostream>
@@ -13,8 +14,15 @@
 namespace gbaemu
 {
 
-    CPUState::CPUState() : memory(std::bind(&CPUState::handleReadUnused, this))
+    CPUState::CPUState() : executionInfo(new CPUExecutionInfo()), memory(std::bind(&CPUState::handleReadUnused, this))
     {
+        // CPUState is not standard layout (private members), offsetof is still supported by GCC & Clang
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Winvalid-offsetof"
+        static_assert(offsetof(CPUState, cpsr) + sizeof(cpsr) <= 64, "state used by the dispatch loop has to fit into the first cache line");
+        static_assert(offsetof(CPUState, regs) == 64, "registers of the current mode have to be in the second cache line");
+#pragma GCC diagnostic pop
+
         reset();
     }
 
@@ -23,9 +31,11 @@ namespace gbaemu
         std::fill_n(reinterpret_cast<char *>(&regs), sizeof(regs), 0);
         std::fill_n(reinterpret_cast<char *>(&pipeline), sizeof(pipeline), 0);
         std::fill_n(reinterpret_cast<char *>(&cpsr), sizeof(cpsr), 0);
+        std::fill_n(reinterpret_cast<char *>(&lazyFlags), sizeof(lazyFlags), 0);
         std::fill_n(reinterpret_cast<char *>(&cpuInfo), sizeof(cpuInfo), 0);
         execState = 0;
         haltCondition = 0;
+        regBank = UserMode;
 
         // Ensure that system mode is also set in CPSR register!
         updateCPSR(0b11111);
@@ -48,18 +58,19 @@ namespace gbaemu
           SP_usr=03007F00h
         The user may redefine these addresses and move stacks into other locations, however, the addresses for system data at 7FE0h-7FFFh are fixed.
         */
-        // Set default SP values
-        *getModeRegs(CPUState::CPUMode::UserMode)[regs::SP_OFFSET] = 0x03007F00;
-        *getModeRegs(CPUState::CPUMode::FIQ)[regs::SP_OFFSET] = 0x03007F00;
-        *getModeRegs(CPUState::CPUMode::AbortMode)[regs::SP_OFFSET] = 0x03007F00;
-        *getModeRegs(CPUState::CPUMode::UndefinedMode)[regs::SP_OFFSET] = 0x03007F00;
-        *getModeRegs(CPUState::CPUMode::SupervisorMode)[regs::SP_OFFSET] = 0x03007FE0;
-        *getModeRegs(CPUState::CPUMode::IRQ)[regs::SP_OFFSET] = 0x3007FA0;
+        // Set default SP values, we are in system mode so only the user SP is in rx
+        accessReg(regs::SP_OFFSET) = 0x03007F00;
+        regs.r13_14[CPUState::CPUMode::FIQ][0] = 0x03007F00;
+        regs.r13_14[CPUState::CPUMode::AbortMode][0] = 0x03007F00;
+        regs.r13_14[CPUState::CPUMode::UndefinedMode][0] = 0x03007F00;
+        regs.r13_14[CPUState::CPUMode::SupervisorMode][0] = 0x03007FE0;
+        regs.r13_14[CPUState::CPUMode::IRQ][0] = 0x3007FA0;
 
         accessReg(gbaemu::regs::PC_OFFSET) = memory::EXT_ROM_OFFSET;
         cpuInfo.memReg = memory::EXT_ROM1;
         seqCycles = memory.memCycles32(cpuInfo.memReg, true);
         nonSeqCycles = memory.memCycles32(cpuInfo.memReg, false);
+        invalidateFetchWindow();
     }
 
     uint32_t CPUState::handleReadUnused()
@@ -110,6 +121,19 @@ namespace gbaemu
         return regs.rx[regs::PC_OFFSET] &= (thumbMode ? 0xFFFFFFFE : 0xFFFFFFFC);
     }
 
+    template <bool thumbMode>
+    uint32_t CPUState::fetchInstSlow(uint32_t addr)
+    {
+        uint32_t inst = thumbMode ? memory.readInst16(addr, cpuInfo) : memory.readInst32(addr, cpuInfo);
+
+        // BIOS, IO & open bus have no window, they keep using the slow path
+        fetchWindow.base = memory.getHostPage(addr, fetchWindow.start, fetchWindow.size);
+        fetchWindow.memReg = cpuInfo.memReg;
+        fetchWindow.cycles = thumbMode ? memory.memCycles16(cpuInfo.memReg, true) : memory.memCycles32(cpuInfo.memReg, true);
+
+        return inst;
+    }
+
     const char *CPUState::cpuModeToString() const
     {
         switch (cpsr.mode) {
@@ -136,24 +160,34 @@ namespace gbaemu
         return regs.rx[regs::PC_OFFSET];
     }
 
-    uint32_t *const *const CPUState::getModeRegs(CPUMode cpuMode)
+    uint32_t &CPUState::accessSPSR()
     {
-        return regsHacks[cpuMode];
-    }
+        if (cpsr.mode == UserMode || cpsr.mode == SystemMode)
+            return regs.CPSR;
 
-    const uint32_t *const *const CPUState::getModeRegs(CPUMode cpuMode) const
-    {
-        return regsHacks[cpuMode];
+        return regs.SPSR[cpsr.mode];
     }
 
-    uint32_t &CPUState::accessReg(uint8_t offset)
+    void CPUState::switchRegisterBank(CPUMode mode)
     {
-        return *(getCurrentRegs()[offset]);
-    }
+        if (mode == SystemMode)
+            mode = UserMode;
 
-    uint32_t CPUState::accessReg(uint8_t offset) const
-    {
-        return *(getCurrentRegs()[offset]);
+        if (mode == regBank)
+            return;
+
+        // r8-r12 are only banked in FIQ mode
+        if (regBank == FIQ || mode == FIQ) {
+            std::copy_n(regs.rx + 8, 5, regBank == FIQ ? regs.r8_12_fiq : regs.r8_12_usr);
+            std::copy_n(mode == FIQ ? regs.r8_12_fiq : regs.r8_12_usr, 5, regs.rx + 8);
+        }
+
+        regs.r13_14[regBank][0] = regs.rx[regs::SP_OFFSET];
+        regs.r13_14[regBank][1] = regs.rx[regs::LR_OFFSET];
+        regs.rx[regs::SP_OFFSET] = regs.r13_14[mode][0];
+        regs.rx[regs::LR_OFFSET] = regs.r13_14[mode][1];
+
+        regBank = mode;
     }
 
     void CPUState::updateCPUMode(uint8_t modeBits)
@@ -198,12 +232,12 @@ namespace gbaemu
                 break;
 
             default:
-                executionInfo.message << "ERROR: invalid mode bits: 0x" << std::hex << static_cast<uint32_t>(modeBits) << std::endl;
+                executionInfo->message << "ERROR: invalid mode bits: 0x" << std::hex << static_cast<uint32_t>(modeBits) << std::endl;
                 execState = CPUState::EXEC_ERROR;
                 break;
         }
 
-        currentRegs = regsHacks[cpsr.mode];
+        switchRegisterBank(cpsr.mode);
     }
 
     void CPUState::updateCPUMode()
@@ -218,9 +252,46 @@ namespace gbaemu
         updateCPUMode(modeBits & cpsr_flags::MODE_BIT_MASK & 0xF);
     }
 
+    void CPUState::resolveLazyFlags(uint8_t mask)
+    {
+        if (mask & lazyFlagBit<cpsr_flags::N_FLAG>())
+            setFlag<cpsr_flags::N_FLAG>(evalLazyFlag<cpsr_flags::N_FLAG>());
+        if (mask & lazyFlagBit<cpsr_flags::Z_FLAG>())
+            setFlag<cpsr_flags::Z_FLAG>(evalLazyFlag<cpsr_flags::Z_FLAG>());
+        if (mask & lazyFlagBit<cpsr_flags::C_FLAG>())
+            setFlag<cpsr_flags::C_FLAG>(evalLazyFlag<cpsr_flags::C_FLAG>());
+        if (mask & lazyFlagBit<cpsr_flags::V_FLAG>())
+            setFlag<cpsr_flags::V_FLAG>(evalLazyFlag<cpsr_flags::V_FLAG>());
+    }
+
+    uint32_t CPUState::getCurrentCPSR() const
+    {
+        uint32_t value = regs.CPSR;
+
+        if (lazyFlags.pending) {
+            value &= ~((static_cast<uint32_t>(1) << cpsr_flags::N_FLAG) | (static_cast<uint32_t>(1) << cpsr_flags::Z_FLAG) |
+                       (static_cast<uint32_t>(1) << cpsr_flags::C_FLAG) | (static_cast<uint32_t>(1) << cpsr_flags::V_FLAG));
+            value |= (static_cast<uint32_t>(getFlag<cpsr_flags::N_FLAG>()) << cpsr_flags::N_FLAG) |
+                     (static_cast<uint32_t>(getFlag<cpsr_flags::Z_FLAG>()) << cpsr_flags::Z_FLAG) |
+                     (static_cast<uint32_t>(getFlag<cpsr_flags::C_FLAG>()) << cpsr_flags::C_FLAG) |
+                     (static_cast<uint32_t>(getFlag<cpsr_flags::V_FLAG>()) << cpsr_flags::V_FLAG);
+        }
+
+        return value;
+    }
+
+    uint32_t CPUState::getCurrentSPSR() const
+    {
+        if (cpsr.mode == UserMode || cpsr.mode == SystemMode)
+            return getCurrentCPSR();
+
+        return regs.SPSR[cpsr.mode];
+    }
+
     void CPUState::updateCPSR(uint32_t value)
     {
         regs.CPSR = value;
+        lazyFlags.pending = 0;
 
         cpsr.negative = isBitSet<uint32_t, cpsr_flags::N_FLAG>(value);
         cpsr.zero = isBitSet<uint32_t, cpsr_flags::Z_FLAG>(value);
@@ -236,6 +307,7 @@ namespace gbaemu
     {
         // Only keep the current mode!
         regs.CPSR &= cpsr_flags::MODE_BIT_MASK;
+        lazyFlags.pending = 0;
         cpsr.negative = false;
         cpsr.zero = false;
         cpsr.carry = false;
@@ -269,7 +341,7 @@ namespace gbaemu
             ss << "    ";
 
             /* value */
-            uint32_t value = accessReg(i);
+            uint32_t value = i == 16 ? getCurrentCPSR() : (i == regs::SPSR_OFFSET ? getCurrentSPSR() : accessReg(i));
             /* TODO: show fixed point */
             ss << std::dec << value << " = 0x" << std::hex << value << '\n';
         }
@@ -373,5 +445,7 @@ namespace gbaemu
 
     template uint32_t CPUState::normalizePC<true>();
     template uint32_t CPUState::normalizePC<false>();
+    template uint32_t CPUState::fetchInstSlow<true>(uint32_t);
+    template uint32_t CPUState::fetchInstSlow<false>(uint32_t);
 
 } // namespace gbaemu
@@ -5,6 +5,7 @@
 #include "io/memory.hpp"
 #include "regs.hpp"
 #include <cstdint>
+#include <memory>
 #include <sstream>
 #include <string>
 
@@ -22,7 +23,12 @@ namespace gbaemu
         std::stringstream message;
     };
 
-    struct CPUState {
+    class JIT;
+
+    struct alignas(64) CPUState {
+        // translated code works directly on the registers
+        friend class JIT;
+
       public:
         enum CPUMode : uint8_t {
             UserMode,
@@ -37,66 +43,53 @@ namespace gbaemu
         enum ExecutionState : uint8_t {
             EXEC_THUMB = 1 << 0,
             EXEC_DMA = 1 << 1,
-            EXEC_TIMER = 1 << 2,
-            EXEC_IRQ = 1 << 3,
-            EXEC_HALT = 1 << 4,
+            EXEC_IRQ = 1 << 2,
+            EXEC_HALT = 1 << 3,
             // Indicate that an exception occurred -> abort
-            EXEC_ERROR = 1 << 5,
+            EXEC_ERROR = 1 << 4,
         };
 
-        uint8_t execState;
-
-        /* If an error has occured more information can be found here. */
-        CPUExecutionInfo executionInfo;
-
-      private:
-        struct Regs {
-            uint32_t rx[16];
-            uint32_t r8_14_fiq[7];
-            uint32_t r13_14_svc[2];
-            uint32_t r13_14_abt[2];
-            uint32_t r13_14_irq[2];
-            uint32_t r13_14_und[2];
-            uint32_t CPSR;
-            uint32_t SPSR_fiq;
-            uint32_t SPSR_svc;
-            uint32_t SPSR_abt;
-            uint32_t SPSR_irq;
-            uint32_t SPSR_und;
-        } regs;
-
-        // Complain to: tammo.muermann@stud.tu-darmstadt.de
-        uint32_t *const regsHacks[7][18] = {
-            // System / User mode regs
-            {regs.rx, regs.rx + 1, regs.rx + 2, regs.rx + 3, regs.rx + 4, regs.rx + 5, regs.rx + 6, regs.rx + 7, regs.rx + 8, regs.rx + 9, regs.rx + 10, regs.rx + 11, regs.rx + 12, regs.rx + 13, regs.rx + 14, regs.rx + 15, &regs.CPSR, &regs.CPSR},
-            // FIQ mode
-            {regs.rx, regs.rx + 1, regs.rx + 2, regs.rx + 3, regs.rx + 4, regs.rx + 5, regs.rx + 6, regs.rx + 7, regs.r8_14_fiq, regs.r8_14_fiq + 1, regs.r8_14_fiq + 2, regs.r8_14_fiq + 3, regs.r8_14_fiq + 4, regs.r8_14_fiq + 5, regs.r8_14_fiq + 6, regs.rx + 15, &regs.CPSR, &regs.SPSR_fiq},
-            // IRQ mode
-            {regs.rx, regs.rx + 1, regs.rx + 2, regs.rx + 3, regs.rx + 4, regs.rx + 5, regs.rx + 6, regs.rx + 7, regs.rx + 8, regs.rx + 9, regs.rx + 10, regs.rx + 11, regs.rx + 12, regs.r13_14_irq, regs.r13_14_irq + 1, regs.rx + 15, &regs.CPSR, &regs.SPSR_irq},
-            // Supervisor Mode
-            {regs.rx, regs.rx + 1, regs.rx + 2, regs.rx + 3, regs.rx + 4, regs.rx + 5, regs.rx + 6, regs.rx + 7, regs.rx + 8, regs.rx + 9, regs.rx + 10, regs.rx + 11, regs.rx + 12, regs.r13_14_svc, regs.r13_14_svc + 1, regs.rx + 15, &regs.CPSR, &regs.SPSR_svc},
-            // Abort mode
-            {regs.rx, regs.rx + 1, regs.rx + 2, regs.rx + 3, regs.rx + 4, regs.rx + 5, regs.rx + 6, regs.rx + 7, regs.rx + 8, regs.rx + 9, regs.rx + 10, regs.rx + 11, regs.rx + 12, regs.r13_14_abt, regs.r13_14_abt + 1, regs.rx + 15, &regs.CPSR, &regs.SPSR_abt},
-            // Undefined Mode
-            {regs.rx, regs.rx + 1, regs.rx + 2, regs.rx + 3, regs.rx + 4, regs.rx + 5, regs.rx + 6, regs.rx + 7, regs.rx + 8, regs.rx + 9, regs.rx + 10, regs.rx + 11, regs.rx + 12, regs.r13_14_und, regs.r13_14_und + 1, regs.rx + 15, &regs.CPSR, &regs.SPSR_und},
-            // System / User mode regs
-            {regs.rx, regs.rx + 1, regs.rx + 2, regs.rx + 3, regs.rx + 4, regs.rx + 5, regs.rx + 6, regs.rx + 7, regs.rx + 8, regs.rx + 9, regs.rx + 10, regs.rx + 11, regs.rx + 12, regs.rx + 13, regs.rx + 14, regs.rx + 15, &regs.CPSR, &regs.CPSR}};
-
-        uint32_t *const *currentRegs;
+        /*
+            Memory layout: the state the dispatch loop & the handlers touch for every instruction comes first and
+            fits into two cache lines (CPUState is cache line aligned): pipeline, cpuInfo, lazyFlags, fetchWindow,
+            execState & cpsr in the first one, the registers of the current mode in the second one. The rarely used
+            state follows, the error message is behind a pointer. Memory comes last, its page table & wait cycles
+            are at its start. The layout is checked in the constructor.
+         */
 
-      public:
         /* pipeline */
         uint32_t pipeline[2];
 
-        Memory memory;
-
         InstructionExecutionInfo cpuInfo;
 
-        // CPU halting
-        uint32_t haltCondition;
+        /*
+            Lazily evaluated condition flags: flag setting ALU operations only store their result & the signs of
+            their operands. The flags marked as pending are derived from them once they are actually needed
+            (conditionSatisfied, MRS, exception entry, getFlag).
+         */
+        struct LazyFlags {
+            uint64_t result;
+            bool msbOp1;
+            bool msbOp2;
+            bool invertCarry;
+            uint8_t pending;
+        } lazyFlags;
+
+        /*
+            Host memory instructions are currently fetched from: sequential fetches inside of
+            [start, start + size) are plain loads. The window is refreshed after branches (see
+            CPU::refillPipelineAfterBranch) and when PC leaves it, size 0 forces the next fetch through Memory.
+         */
+        struct FetchWindow {
+            const uint8_t *base;
+            uint32_t start;
+            uint32_t size;
+            // cycles of a sequential fetch (16 bit in THUMB, 32 bit in ARM state)
+            uint8_t cycles;
+            memory::MemoryRegion memReg;
+        } fetchWindow;
 
-        uint8_t seqCycles;
-        uint8_t nonSeqCycles;
+        uint8_t execState;
 
         struct CPSR_Flags {
             bool thumbMode;
@@ -109,9 +102,45 @@ namespace gbaemu
             CPUMode mode;
         } cpsr;
 
+      private:
+        /*
+            The registers of the current mode live in rx, handlers index it directly. The banked registers of all
+            other modes are kept in the bank arrays and swapped in & out on mode changes (see switchRegisterBank).
+            User & system mode share their registers.
+         */
+        struct Regs {
+            uint32_t rx[16];
+            uint32_t CPSR;
+            // r8-r12 of the mode that is not active: FIQ has its own, all other modes share the user ones
+            uint32_t r8_12_usr[5];
+            uint32_t r8_12_fiq[5];
+            // r13 & r14 per mode, system mode uses the UserMode entry
+            uint32_t r13_14[7][2];
+            // SPSR per mode, the UserMode & SystemMode entries are unused
+            uint32_t SPSR[7];
+        } regs;
+
+        // Mode whose registers are currently in regs.rx, never SystemMode
+        CPUMode regBank;
+
+      public:
+        uint8_t seqCycles;
+        uint8_t nonSeqCycles;
+
+        // CPU halting
+        uint32_t haltCondition;
+
+        /* If an error has occured more information can be found here. */
+        std::unique_ptr<CPUExecutionInfo> executionInfo;
+
+        Memory memory;
+
       private:
         uint32_t handleReadUnused();
 
+        template <bool thumbMode>
+        uint32_t fetchInstSlow(uint32_t addr);
+
       public:
         CPUState();
 
@@ -122,26 +151,110 @@ namespace gbaemu
 
         const char *cpuModeToString() const;
 
+        // Sequential instruction fetch, adds the fetch cycles like Memory::readInst16 / readInst32
+        template <bool thumbMode>
+        uint32_t fetchInst(uint32_t addr)
+        {
+            const uint32_t offset = (addr - fetchWindow.start) & (thumbMode ? ~1 : ~3);
+
+            if (offset < fetchWindow.size) {
+                cpuInfo.cycleCount += fetchWindow.cycles;
+                cpuInfo.memReg = fetchWindow.memReg;
+
+                if (thumbMode)
+                    return le(*reinterpret_cast<const uint16_t *>(fetchWindow.base + offset));
+                else
+                    return le(*reinterpret_cast<const uint32_t *>(fetchWindow.base + offset));
+            }
+
+            return fetchInstSlow<thumbMode>(addr);
+        }
+
+        // Forces the next fetch through Memory, needed if the wait states change
+        void invalidateFetchWindow()
+        {
+            fetchWindow.size = 0;
+        }
+
         uint32_t getCurrentPC() const;
         uint32_t &getPC();
 
-        uint32_t *const *const getCurrentRegs() { return currentRegs; }
+        uint32_t *getCurrentRegs() { return regs.rx; }
 
-        const uint32_t *const *const getCurrentRegs() const { return currentRegs; }
+        const uint32_t *getCurrentRegs() const { return regs.rx; }
 
-        uint32_t *const *const getModeRegs(CPUMode cpuMode);
+        uint32_t &accessReg(uint8_t offset) { return regs.rx[offset]; }
 
-        const uint32_t *const *const getModeRegs(CPUMode cpuMode) const;
+        uint32_t accessReg(uint8_t offset) const { return regs.rx[offset]; }
 
-        uint32_t &accessReg(uint8_t offset);
+        // User & system mode have no SPSR, it aliases CPSR instead
+        uint32_t &accessSPSR();
 
-        uint32_t accessReg(uint8_t offset) const;
+        /*
+            Swaps the registers of the given mode into regs.rx without changing CPSR. Used for user bank transfers,
+            the bank of the current mode has to be restored with switchRegisterBank(cpsr.mode) afterwards.
+         */
+        void switchRegisterBank(CPUMode mode);
+
+      private:
+        template <cpsr_flags::CPSR_FLAGS flag>
+        static constexpr uint8_t lazyFlagBit()
+        {
+            return flag == cpsr_flags::N_FLAG ? 1 : (flag == cpsr_flags::Z_FLAG ? 2 : (flag == cpsr_flags::C_FLAG ? 4 : (flag == cpsr_flags::V_FLAG ? 8 : 0)));
+        }
+
+        template <cpsr_flags::CPSR_FLAGS flag>
+        inline bool evalLazyFlag() const
+        {
+            const bool negative = lazyFlags.result & (static_cast<uint64_t>(1) << 31);
+
+            switch (flag) {
+                case cpsr_flags::N_FLAG:
+                    return negative;
+                case cpsr_flags::Z_FLAG:
+                    return (lazyFlags.result & 0x0FFFFFFFF) == 0;
+                case cpsr_flags::C_FLAG:
+                    return static_cast<bool>(lazyFlags.result & (static_cast<uint64_t>(1) << 32)) != lazyFlags.invertCarry;
+                case cpsr_flags::V_FLAG:
+                default:
+                    return lazyFlags.msbOp1 == lazyFlags.msbOp2 && (negative != lazyFlags.msbOp1);
+            }
+        }
+
+        // Writes the given pending flags into CPSR
+        void resolveLazyFlags(uint8_t mask);
+
+      public:
+        /*
+            Stores the result of a flag setting ALU operation, the flags itself are evaluated lazily.
+            For the meaning of the parameters see CPU::setFlags.
+         */
+        template <bool nFlag, bool zFlag, bool vFlag, bool cFlag, bool invertCarry>
+        inline void setALUFlags(uint64_t resultValue, bool msbOp1, bool msbOp2)
+        {
+            constexpr uint8_t mask = (nFlag ? lazyFlagBit<cpsr_flags::N_FLAG>() : 0) |
+                                     (zFlag ? lazyFlagBit<cpsr_flags::Z_FLAG>() : 0) |
+                                     (cFlag ? lazyFlagBit<cpsr_flags::C_FLAG>() : 0) |
+                                     (vFlag ? lazyFlagBit<cpsr_flags::V_FLAG>() : 0);
+
+            // flags of the previous operation that are not overwritten have to be kept
+            if (lazyFlags.pending & ~mask)
+                resolveLazyFlags(lazyFlags.pending & ~mask);
+
+            lazyFlags.result = resultValue;
+            lazyFlags.msbOp1 = msbOp1;
+            lazyFlags.msbOp2 = msbOp2;
+            lazyFlags.invertCarry = invertCarry;
+            lazyFlags.pending = mask;
+        }
 
         template <cpsr_flags::CPSR_FLAGS flag>
         inline void setFlag(bool value = true)
         {
             static_assert(flag != cpsr_flags::FIQ_DISABLE);
 
+            lazyFlags.pending &= ~lazyFlagBit<flag>();
+
             constexpr uint32_t mask = static_cast<uint32_t>(1) << flag;
             if (value) {
                 regs.CPSR |= mask;
@@ -161,16 +274,18 @@ namespace gbaemu
         {
             static_assert(flag != cpsr_flags::FIQ_DISABLE);
 
+            if (lazyFlagBit<flag>() && (lazyFlags.pending & lazyFlagBit<flag>()))
+                return evalLazyFlag<flag>();
+
             return (flag == cpsr_flags::N_FLAG ? cpsr.negative : (flag == cpsr_flags::Z_FLAG ? cpsr.zero : (flag == cpsr_flags::C_FLAG ? cpsr.carry : (flag == cpsr_flags::V_FLAG ? cpsr.overflow : (flag == cpsr_flags::IRQ_DISABLE ? cpsr.irqDisable : cpsr.thumbMode)))));
         }
 
         void clearFlags();
 
         void updateCPSR(uint32_t value);
-        uint32_t getCurrentCPSR()
-        {
-            return regs.CPSR;
-        }
+        uint32_t getCurrentCPSR() const;
+        // User & system mode have no SPSR, it aliases CPSR and needs the lazy flags as well
+        uint32_t getCurrentSPSR() const;
 
         CPUMode getCPUMode() const { return cpsr.mode; }
         void updateCPUMode();
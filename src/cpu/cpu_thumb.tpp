@@ -20,10 +20,13 @@ namespace gbaemu
         if (h) {
             // Second instruction
             extendedAddr <<= 1;
-            uint32_t pcVal = *currentRegs[regs::PC_OFFSET];
-            *currentRegs[regs::PC_OFFSET] = *currentRegs[regs::LR_OFFSET] + extendedAddr;
+            uint32_t pcVal = currentRegs[regs::PC_OFFSET];
+            currentRegs[regs::PC_OFFSET] = currentRegs[regs::LR_OFFSET] + extendedAddr;
             // Note that pc is already incremented by 2
-            *currentRegs[regs::LR_OFFSET] = pcVal | 1;
+            currentRegs[regs::LR_OFFSET] = pcVal | 1;
+
+            if (profiler.isEnabled())
+                profiler.onCall(currentRegs[regs::PC_OFFSET], pcVal);
 
             // pipeline flush -> additional cycles needed
             // This is a branch instruction so we need to consider self branches!
@@ -35,7 +38,7 @@ namespace gbaemu
             // The destination address range is (PC+4)-400000h..+3FFFFEh -> sign extension is needed
             // Apply sign extension!
             extendedAddr = signExt<int32_t, uint32_t, 23>(extendedAddr);
-            *currentRegs[regs::LR_OFFSET] = *currentRegs[regs::PC_OFFSET] + 2 + extendedAddr;
+            currentRegs[regs::LR_OFFSET] = currentRegs[regs::PC_OFFSET] + 2 + extendedAddr;
         }
     }
 
@@ -99,7 +102,7 @@ namespace gbaemu
         //          1: ADD  Rd,SP,#nn    ;Rd = SP + nn
         // nn step 4
         // Note that pc is already incremented by 2
-        *currentRegs[rd] = (sp ? *currentRegs[regs::SP_OFFSET] : ((*currentRegs[regs::PC_OFFSET] + 2) & ~2)) + (static_cast<uint32_t>(offset) << 2);
+        currentRegs[rd] = (sp ? currentRegs[regs::SP_OFFSET] : ((currentRegs[regs::PC_OFFSET] + 2) & ~2)) + (static_cast<uint32_t>(offset) << 2);
 
         // Execution Time: 1S
     }
@@ -145,12 +148,12 @@ namespace gbaemu
         auto currentRegs = state.getCurrentRegs();
 
         // Note that pc is already incremented by 2
-        uint32_t rsValue = *currentRegs[rs] + (rs == regs::PC_OFFSET ? 2 : 0);
-        uint32_t rdValue = *currentRegs[rd] + (rd == regs::PC_OFFSET ? 2 : 0);
+        uint32_t rsValue = currentRegs[rs] + (rs == regs::PC_OFFSET ? 2 : 0);
+        uint32_t rdValue = currentRegs[rd] + (rd == regs::PC_OFFSET ? 2 : 0);
 
         switch (id) {
             case ADD:
-                *currentRegs[rd] = rdValue + rsValue;
+                currentRegs[rd] = rdValue + rsValue;
                 break;
 
             case CMP: {
@@ -168,7 +171,7 @@ namespace gbaemu
             }
 
             case MOV:
-                *currentRegs[rd] = rsValue;
+                currentRegs[rd] = rsValue;
                 break;
 
             case BX: {
@@ -187,7 +190,7 @@ namespace gbaemu
                 //}
 
                 // Change the PC to the address given by rs. Note that we have to mask out the thumb switch bit.
-                *currentRegs[regs::PC_OFFSET] = rsValue & ~1;
+                currentRegs[regs::PC_OFFSET] = rsValue & ~1;
 
                 // This is a branch instruction so we need to refill the pipeline!
                 if (!stayInThumbMode) {
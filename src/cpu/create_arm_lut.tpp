@@ -1,6 +1,8 @@
 #ifndef CREATE_ARM_LUT_TPP
 #define CREATE_ARM_LUT_TPP
 
+#include "threaded_dispatch.tpp"
+
 namespace gbaemu
 {
 
@@ -268,6 +270,13 @@ namespace gbaemu
 
     const CPU::InstExecutor CPU::armExeLUT[4096] = {DECODE_LUT_ENTRY_4096(0)};
 
+#ifdef THREADED_DISPATCH
+#undef DECODE_LUT_ENTRY
+#define DECODE_LUT_ENTRY(hash) &CPU::threadedStep<false, CPU::resolveArmHashHandler<hash>()>
+
+    const BlockCache::ThreadedExecutor CPU::armThreadedLUT[4096] = {DECODE_LUT_ENTRY_4096(0)};
+#endif
+
 #undef DECODE_LUT_ENTRY
 #undef DECODE_LUT_ENTRY_4
 #undef DECODE_LUT_ENTRY_16
@@ -1,6 +1,8 @@
 #ifndef CREATE_THUMB_LUT_TPP
 #define CREATE_THUMB_LUT_TPP
 
+#include "threaded_dispatch.tpp"
+
 namespace gbaemu
 {
 
@@ -360,6 +362,13 @@ namespace gbaemu
 
     const CPU::InstExecutor CPU::thumbExeLUT[1024] = {DECODE_LUT_ENTRY_1024(0)};
 
+#ifdef THREADED_DISPATCH
+#undef DECODE_LUT_ENTRY
+#define DECODE_LUT_ENTRY(hash) &CPU::threadedStep<true, CPU::resolveThumbHashHandler<hash>()>
+
+    const BlockCache::ThreadedExecutor CPU::thumbThreadedLUT[1024] = {DECODE_LUT_ENTRY_1024(0)};
+#endif
+
 #undef DECODE_LUT_ENTRY
 #undef DECODE_LUT_ENTRY_4
 #undef DECODE_LUT_ENTRY_16
@@ -0,0 +1,202 @@
+#include "guest_profiler.hpp"
+
+#include "cpu.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <unordered_map>
+
+namespace gbaemu
+{
+    GuestProfiler::GuestProfiler(CPU *cpu)
+        : cpu(cpu), enabled(false), interval(DEFAULT_INTERVAL), depth(0), droppedCalls(0), sampleCount(0), droppedPCs(0)
+    {
+    }
+
+    void GuestProfiler::start(uint32_t sampleInterval)
+    {
+        interval = std::max(sampleInterval, static_cast<uint32_t>(1));
+        enabled = true;
+        depth = 0;
+
+        if (pcs.empty())
+            pcs.assign(PC_SLOTS, PCSlot{0, 0});
+
+        cpu->scheduler.setHandler(Scheduler::PROFILER_SAMPLE, [this](uint64_t timestamp) {
+            sample(timestamp);
+        });
+        cpu->scheduler.schedule(Scheduler::PROFILER_SAMPLE, cpu->scheduler.now() + interval);
+    }
+
+    void GuestProfiler::stop()
+    {
+        enabled = false;
+        cpu->scheduler.cancel(Scheduler::PROFILER_SAMPLE);
+    }
+
+    void GuestProfiler::sample(uint64_t timestamp)
+    {
+        const CPUState &state = cpu->state;
+
+        ++sampleCount;
+        countPC(state.getCurrentPC());
+
+        currentStack.clear();
+        for (uint32_t i = 0; i < depth; ++i)
+            currentStack.push_back(stack[i].function);
+        if (state.execState & CPUState::EXEC_DMA)
+            currentStack.push_back(FRAME_DMA);
+        else if (state.execState & CPUState::EXEC_HALT)
+            currentStack.push_back(FRAME_HALT);
+
+        auto it = stacks.find(currentStack);
+        if (it == stacks.end())
+            stacks.emplace(currentStack, 1);
+        else
+            ++it->second;
+
+        // based on the due time, so the samples do not drift
+        cpu->scheduler.schedule(Scheduler::PROFILER_SAMPLE, timestamp + interval);
+    }
+
+    void GuestProfiler::countPC(uint32_t pc)
+    {
+        // open addressing, pc 0 marks a free slot (the reset vector is never sampled with a valid stack anyway)
+        const uint32_t key = pc ? pc : 1;
+        uint32_t index = (key * 0x9E3779B1) >> (32 - 14);
+        static_assert(PC_SLOTS == 1 << 14, "the hash has to match the histogram size");
+
+        for (uint32_t probe = 0; probe < PC_SLOTS; ++probe, index = (index + 1) & (PC_SLOTS - 1)) {
+            PCSlot &slot = pcs[index];
+            if (slot.pc == key) {
+                ++slot.samples;
+                return;
+            }
+            if (slot.pc == 0) {
+                slot.pc = key;
+                slot.samples = 1;
+                return;
+            }
+        }
+
+        ++droppedPCs;
+    }
+
+    void GuestProfiler::popTo(uint32_t pc)
+    {
+        // returns that skip frames, e.g. if a callee did not return through the address BL has set
+        for (uint32_t i = depth - 1; i-- > 0;) {
+            if (stack[i].returnAddr == pc) {
+                depth = i;
+                return;
+            }
+        }
+    }
+
+    std::string GuestProfiler::frameName(uint32_t function)
+    {
+        switch (function) {
+            case FRAME_IRQ:
+                return "[irq]";
+            case FRAME_HALT:
+                return "[halt]";
+            case FRAME_DMA:
+                return "[dma]";
+            default: {
+                std::stringstream ss;
+                ss << "0x" << std::hex << std::setw(8) << std::setfill('0') << function;
+                return ss.str();
+            }
+        }
+    }
+
+    std::string GuestProfiler::flatProfile() const
+    {
+        // samples outside of any observed call belong to the code that was entered without BL
+        static constexpr uint32_t ROOT = 0xFFFFFFF8;
+
+        struct Counts {
+            uint64_t self = 0;
+            uint64_t inclusive = 0;
+        };
+        std::unordered_map<uint32_t, Counts> functions;
+
+        for (const auto &entry : stacks) {
+            const std::vector<uint32_t> &frames = entry.first;
+
+            functions[frames.empty() ? ROOT : frames.back()].self += entry.second;
+            functions[ROOT].inclusive += entry.second;
+            for (size_t i = 0; i < frames.size(); ++i) {
+                // recursive functions are only counted once per stack
+                if (std::find(frames.begin(), frames.begin() + i, frames[i]) == frames.begin() + i)
+                    functions[frames[i]].inclusive += entry.second;
+            }
+        }
+
+        std::vector<std::pair<uint32_t, Counts>> sortedFunctions(functions.begin(), functions.end());
+        std::sort(sortedFunctions.begin(), sortedFunctions.end(), [](const auto &a, const auto &b) {
+            return a.second.self > b.second.self || (a.second.self == b.second.self && a.second.inclusive > b.second.inclusive);
+        });
+
+        std::vector<PCSlot> sortedPCs;
+        for (const PCSlot &slot : pcs)
+            if (slot.pc)
+                sortedPCs.push_back(slot);
+        std::sort(sortedPCs.begin(), sortedPCs.end(), [](const PCSlot &a, const PCSlot &b) { return a.samples > b.samples; });
+        if (sortedPCs.size() > 100)
+            sortedPCs.resize(100);
+
+        const double total = sampleCount ? static_cast<double>(sampleCount) : 1.0;
+
+        std::stringstream ss;
+        ss << "Guest profile: " << sampleCount << " samples, one every " << interval << " cycles\n";
+        if (droppedCalls)
+            ss << "calls deeper than " << MAX_DEPTH << " frames (ignored): " << droppedCalls << '\n';
+        if (droppedPCs)
+            ss << "samples of PCs that did not fit into the histogram: " << droppedPCs << '\n';
+
+        ss << std::fixed << std::setprecision(2);
+        ss << "\nFunctions (self / inclusive samples):\n";
+        for (const auto &function : sortedFunctions) {
+            ss << "  " << std::left << std::setw(10) << (function.first == ROOT ? "[root]" : frameName(function.first)) << std::right
+               << "  self: " << std::setw(10) << function.second.self << " (" << std::setw(6) << (100.0 * function.second.self / total) << "%)"
+               << "  inclusive: " << std::setw(10) << function.second.inclusive << " (" << std::setw(6) << (100.0 * function.second.inclusive / total) << "%)\n";
+        }
+
+        ss << "\nHottest PCs:\n";
+        for (const PCSlot &slot : sortedPCs) {
+            ss << "  0x" << std::hex << std::setw(8) << std::setfill('0') << slot.pc << std::dec << std::setfill(' ')
+               << "  " << std::setw(10) << slot.samples << " (" << std::setw(6) << (100.0 * slot.samples / total) << "%)\n";
+        }
+
+        return ss.str();
+    }
+
+    std::string GuestProfiler::collapsedStacks() const
+    {
+        std::stringstream ss;
+        for (const auto &entry : stacks) {
+            ss << "[root]";
+            for (uint32_t function : entry.first)
+                ss << ';' << frameName(function);
+            ss << ' ' << entry.second << '\n';
+        }
+        return ss.str();
+    }
+
+    bool GuestProfiler::write(const std::string &basePath) const
+    {
+        std::ofstream flat(basePath + ".profile.txt");
+        std::ofstream folded(basePath + ".folded");
+
+        if (!flat.is_open() || !folded.is_open())
+            return false;
+
+        flat << flatProfile();
+        folded << collapsedStacks();
+
+        return flat.good() && folded.good();
+    }
+} // namespace gbaemu
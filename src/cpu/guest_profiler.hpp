@@ -0,0 +1,131 @@
+#ifndef GUEST_PROFILER_HPP
+#define GUEST_PROFILER_HPP
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace gbaemu
+{
+    class CPU;
+
+    /*
+        Sampling profiler for guest code: a scheduled event records the current PC every interval cycles, so there
+        is no per instruction overhead & all execution paths (interpreter, JIT, AOT) are covered.
+
+        Functions are the targets of the BL instructions seen while profiling. BL pushes its target & return address
+        onto a shadow call stack, any branch to a return address on that stack pops the frames up to it. Interrupts
+        push an [irq] frame that is popped by the return to the interrupted instruction. Every sample counts the
+        current call stack, halted CPUs & running DMAs are recorded as [halt] & [dma] on top of it.
+
+        On exit a flat profile (self & inclusive samples per function, hottest PCs) and the collapsed stacks
+        (one "frame;frame;frame count" line per stack, the input format of flamegraph.pl) are written.
+     */
+    class GuestProfiler
+    {
+      public:
+        static constexpr uint32_t DEFAULT_INTERVAL = 4096;
+        static constexpr uint32_t MAX_DEPTH = 64;
+        // Size of the PC histogram, further PCs are only counted as dropped
+        static constexpr uint32_t PC_SLOTS = 1 << 14;
+
+        // Pseudo functions, no code can be executed at these addresses
+        static constexpr uint32_t FRAME_IRQ = 0xFFFFFFFE;
+        static constexpr uint32_t FRAME_HALT = 0xFFFFFFFC;
+        static constexpr uint32_t FRAME_DMA = 0xFFFFFFFA;
+
+      private:
+        struct Frame {
+            uint32_t function;
+            uint32_t returnAddr;
+        };
+
+        struct PCSlot {
+            uint32_t pc;
+            uint64_t samples;
+        };
+
+        CPU *cpu;
+
+        bool enabled;
+        uint32_t interval;
+
+        Frame stack[MAX_DEPTH];
+        uint32_t depth;
+        // calls that did not fit onto the stack
+        uint64_t droppedCalls;
+
+        uint64_t sampleCount;
+        std::vector<PCSlot> pcs;
+        uint64_t droppedPCs;
+        // call stack (outermost function first) -> samples
+        std::map<std::vector<uint32_t>, uint64_t> stacks;
+        std::vector<uint32_t> currentStack;
+
+        void sample(uint64_t timestamp);
+        void countPC(uint32_t pc);
+        void popTo(uint32_t pc);
+
+        static std::string frameName(uint32_t function);
+
+      public:
+        GuestProfiler(CPU *cpu);
+
+        GuestProfiler(const GuestProfiler &) = delete;
+        GuestProfiler &operator=(const GuestProfiler &) = delete;
+
+        // Starts sampling every interval cycles (of the nominal clock)
+        void start(uint32_t interval = DEFAULT_INTERVAL);
+
+        void stop();
+
+        // Forgets the call stack, e.g. after a CPU reset. The samples are kept.
+        void resetCalls()
+        {
+            depth = 0;
+        }
+
+        bool isEnabled() const
+        {
+            return enabled;
+        }
+
+        // Called by BL after the PC & LR are updated
+        void onCall(uint32_t target, uint32_t returnAddr)
+        {
+            if (depth < MAX_DEPTH)
+                stack[depth++] = Frame{target & ~static_cast<uint32_t>(1), returnAddr & ~static_cast<uint32_t>(1)};
+            else
+                ++droppedCalls;
+        }
+
+        // Called when an interrupt is taken, pc is the address of the interrupted instruction
+        void onInterrupt(uint32_t pc)
+        {
+            onCall(FRAME_IRQ, pc);
+        }
+
+        // Called for every branch with its normalized target
+        void onBranch(uint32_t pc)
+        {
+            if (depth && stack[depth - 1].returnAddr == pc)
+                --depth;
+            else if (depth > 1)
+                popTo(pc);
+        }
+
+        uint64_t getSampleCount() const
+        {
+            return sampleCount;
+        }
+
+        std::string flatProfile() const;
+        std::string collapsedStacks() const;
+
+        // Writes basePath.profile.txt & basePath.folded, returns false if a file could not be written
+        bool write(const std::string &basePath) const;
+    };
+} // namespace gbaemu
+
+#endif /* GUEST_PROFILER_HPP */
@@ -0,0 +1,63 @@
+#include "handler_profile.hpp"
+
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+
+namespace gbaemu
+{
+    HandlerProfile::HandlerProfile()
+    {
+        reset();
+    }
+
+    void HandlerProfile::reset()
+    {
+        // same sizes as the handler LUTs
+        slots[0].assign(4096, Slot());
+        slots[1].assign(1024, Slot());
+    }
+
+    std::string HandlerProfile::toString(size_t maxLines) const
+    {
+        struct Line {
+            bool thumb;
+            uint16_t hash;
+            const Slot *slot;
+        };
+
+        std::vector<Line> lines;
+        uint64_t totalCount = 0;
+        uint64_t totalCycles = 0;
+        for (bool thumb : {false, true}) {
+            for (size_t i = 0; i < slots[thumb].size(); ++i) {
+                const Slot &slot = slots[thumb][i];
+                if (slot.count) {
+                    lines.push_back(Line{thumb, static_cast<uint16_t>(i), &slot});
+                    totalCount += slot.count;
+                    totalCycles += slot.cycles;
+                }
+            }
+        }
+
+        std::sort(lines.begin(), lines.end(), [](const Line &a, const Line &b) {
+            return a.slot->cycles > b.slot->cycles || (a.slot->cycles == b.slot->cycles && a.slot->count > b.slot->count);
+        });
+        if (maxLines && lines.size() > maxLines)
+            lines.resize(maxLines);
+
+        std::stringstream ss;
+        ss << "Handler profile: " << totalCount << " instructions, " << totalCycles << " cycles\n";
+        ss << std::fixed << std::setprecision(2);
+        for (const Line &line : lines) {
+            const Slot &slot = *line.slot;
+            ss << "  " << (line.thumb ? "THUMB" : "ARM  ") << " 0x" << std::hex << std::setw(3) << std::setfill('0') << line.hash
+               << std::dec << std::setfill(' ')
+               << "  count: " << std::setw(12) << slot.count << " (" << std::setw(6) << (100.0 * slot.count / totalCount) << "%)"
+               << "  cycles: " << std::setw(12) << slot.cycles << " (" << std::setw(6) << (100.0 * slot.cycles / totalCycles) << "%)"
+               << "  " << Instruction{slot.example, !line.thumb}.toString() << '\n';
+        }
+
+        return ss.str();
+    }
+} // namespace gbaemu
@@ -0,0 +1,57 @@
+#ifndef HANDLER_PROFILE_HPP
+#define HANDLER_PROFILE_HPP
+
+#include "decode/inst.hpp"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace gbaemu
+{
+    /*
+        Counts the executed instructions & their cycles per slot of the ARM / THUMB handler LUTs, only built with
+        PROFILE_HANDLERS (see logging.hpp). While profiling every instruction is interpreted by its plain handler
+        (no JIT, AOT, threaded dispatch or superinstructions), so the report shows which handlers deserve a fast path.
+        The cycles of an instruction include its fetch, skipped idle loops are not attributed to any slot.
+     */
+    class HandlerProfile
+    {
+      public:
+        struct Slot {
+            uint64_t count = 0;
+            uint64_t cycles = 0;
+            // first instruction seen in this slot, used to name the slot in the report
+            uint32_t example = 0;
+        };
+
+      private:
+        // indexed by hashArm / hashThumb
+        std::vector<Slot> slots[2];
+
+      public:
+        HandlerProfile();
+
+        void reset();
+
+        template <bool thumb>
+        void record(uint32_t inst, uint32_t cycles)
+        {
+            Slot &slot = slots[thumb][thumb ? hashThumb(static_cast<uint16_t>(inst)) : hashArm(inst)];
+
+            if (slot.count++ == 0)
+                slot.example = inst;
+            slot.cycles += cycles;
+        }
+
+        const std::vector<Slot> &getSlots(bool thumb) const
+        {
+            return slots[thumb];
+        }
+
+        // Slots sorted by their cycles, limited to the given number of lines (0 for all)
+        std::string toString(size_t maxLines = 0) const;
+    };
+} // namespace gbaemu
+
+#endif /* HANDLER_PROFILE_HPP */
@@ -0,0 +1,90 @@
+#include "idle_loop.hpp"
+
+#include "cpu.hpp"
+#include "logging.hpp"
+
+#include <algorithm>
+#include <sstream>
+#include <vector>
+
+namespace gbaemu
+{
+    IdleLoopDetector::IdleLoopDetector(CPU *cpu) : cpu(cpu), enabled(true)
+    {
+        reset();
+    }
+
+    void IdleLoopDetector::reset()
+    {
+        armed = false;
+        loops.clear();
+    }
+
+    void IdleLoopDetector::arm(uint32_t key)
+    {
+        const CPUState &state = cpu->state;
+
+        for (uint8_t i = 0; i < 16; ++i) {
+            regs[i] = state.accessReg(i);
+        }
+        regs[16] = cpu->state.getCurrentCPSR();
+
+        loopKey = key;
+        memWrites = state.memory.writeCounter;
+        timerReads = cpu->timerGroup.getCounterReads();
+        armed = true;
+    }
+
+    bool IdleLoopDetector::stateUnchanged() const
+    {
+        const CPUState &state = cpu->state;
+
+        if (memWrites != state.memory.writeCounter || timerReads != cpu->timerGroup.getCounterReads())
+            return false;
+
+        for (uint8_t i = 0; i < 16; ++i) {
+            if (regs[i] != state.accessReg(i))
+                return false;
+        }
+
+        return regs[16] == cpu->state.getCurrentCPSR();
+    }
+
+    void IdleLoopDetector::checkLoop(uint32_t key)
+    {
+        if (!armed || key != loopKey || !stateUnchanged()) {
+            arm(key);
+            return;
+        }
+
+        // One whole iteration had no side effects: skip to the next event, timer overflows are scheduled as well
+        uint32_t skip = static_cast<uint32_t>(std::max(cpu->cyclesLeft, 0));
+
+        if (skip) {
+            cpu->cyclesLeft -= skip;
+
+            LoopStats &stats = loops[key];
+            ++stats.hits;
+            stats.skippedCycles += skip;
+        }
+
+        armed = false;
+    }
+
+    std::string IdleLoopDetector::toString() const
+    {
+        std::vector<std::pair<uint32_t, LoopStats>> sorted(loops.begin(), loops.end());
+        std::sort(sorted.begin(), sorted.end(), [](const auto &a, const auto &b) {
+            return a.second.skippedCycles > b.second.skippedCycles;
+        });
+
+        std::stringstream ss;
+        ss << "Idle loops:\n";
+        for (const auto &loop : sorted) {
+            ss << "  0x" << std::hex << (loop.first & ~1) << (loop.first & 1 ? " (THUMB)" : " (ARM)  ")
+               << std::dec << "  hits: " << loop.second.hits << "  skipped cycles: " << loop.second.skippedCycles << '\n';
+        }
+
+        return ss.str();
+    }
+} // namespace gbaemu
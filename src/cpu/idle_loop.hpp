@@ -0,0 +1,90 @@
+#ifndef IDLE_LOOP_HPP
+#define IDLE_LOOP_HPP
+
+#include <cstdint>
+#include <map>
+#include <string>
+
+namespace gbaemu
+{
+    class CPU;
+
+    /*
+        Detects busy waiting loops, i.e. polling of VCOUNT, DISPSTAT or the BIOS interrupt check flag.
+
+        Every short backward branch is a candidate: the registers & CPSR are stored when the loop head is reached.
+        If the next iteration arrives at the loop head again with the exact same register values and neither
+        memory writes nor reads of the (always changing) timer counters happened, the loop only depends on memory
+        that changes due to hardware events. The CPU can therefore skip ahead to the next scheduled event
+        (HBlank, VCount, VBlank, DMA triggers, timer overflows).
+        After a skip the loop has to prove again that it is idle, as the event may have changed its result.
+     */
+    class IdleLoopDetector
+    {
+      public:
+        // Maximum distance of a backward branch in bytes
+        static constexpr uint32_t MAX_LOOP_SIZE = 64;
+
+        struct LoopStats {
+            uint64_t hits = 0;
+            uint64_t skippedCycles = 0;
+        };
+
+      private:
+        CPU *cpu;
+
+        bool armed;
+        uint32_t loopKey;
+        uint32_t regs[17];
+        uint32_t memWrites;
+        uint32_t timerReads;
+
+        // per loop head address (bit 0 set for THUMB code)
+        std::map<uint32_t, LoopStats> loops;
+
+        bool enabled;
+
+        void arm(uint32_t key);
+        bool stateUnchanged() const;
+
+      public:
+        IdleLoopDetector(CPU *cpu);
+
+        void reset();
+
+        bool isEnabled() const
+        {
+            return enabled;
+        }
+
+        void setEnabled(bool enable)
+        {
+            enabled = enable;
+            armed = false;
+        }
+
+        // Scheduled events may change the memory a loop depends on
+        void disarm()
+        {
+            armed = false;
+        }
+
+        template <bool thumb>
+        void onBackwardBranch(uint32_t target)
+        {
+            if (enabled)
+                checkLoop(target | static_cast<uint32_t>(thumb));
+        }
+
+        void checkLoop(uint32_t key);
+
+        const std::map<uint32_t, LoopStats> &getLoops() const
+        {
+            return loops;
+        }
+
+        std::string toString() const;
+    };
+} // namespace gbaemu
+
+#endif /* IDLE_LOOP_HPP */
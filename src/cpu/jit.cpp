@@ -0,0 +1,1549 @@
+#include "jit.hpp"
+
+#include "cpu.hpp"
+#include "decode/inst.hpp"
+#include "logging.hpp"
+#include "native_decode.hpp"
+#include "util.hpp"
+
+#include <cstddef>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <utility>
+#include <vector>
+
+#if JIT_SUPPORTED
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace gbaemu
+{
+#if JIT_SUPPORTED
+    namespace
+    {
+        using namespace native;
+
+        // Layout of a non virtual member function pointer in the Itanium C++ ABI
+        struct MemberFunctionPtr {
+            uintptr_t ptr;
+            ptrdiff_t adj;
+        };
+        static_assert(sizeof(MemberFunctionPtr) == sizeof(BlockCache::InstExecutor), "unexpected member function pointer layout");
+
+        enum Reg : uint8_t {
+            RAX,
+            RCX,
+            RDX,
+            RBX,
+            RSP,
+            RBP,
+            RSI,
+            RDI,
+            R8,
+            R9,
+            R10,
+            R11,
+            R12,
+            R13,
+            R14,
+            R15,
+            NO_REG = 0xFF
+        };
+
+        // [base + index + disp]
+        struct Mem {
+            Reg base;
+            int32_t disp;
+            Reg index;
+
+            Mem(Reg base, int32_t disp, Reg index = NO_REG) : base(base), disp(disp), index(index) {}
+        };
+
+        // x86 condition codes
+        enum CondCode : uint8_t {
+            CC_B = 0x2,
+            CC_AE = 0x3,
+            CC_E = 0x4,
+            CC_NE = 0x5,
+            CC_LE = 0xE
+        };
+
+        // The ALU instructions encoded by the 0x01 / 0x03 / 0x81 opcode groups
+        enum AluOp : uint8_t {
+            X86_ADD = 0,
+            X86_OR = 1,
+            X86_ADC = 2,
+            X86_SBB = 3,
+            X86_AND = 4,
+            X86_SUB = 5,
+            X86_XOR = 6,
+            X86_CMP = 7
+        };
+
+        // The shifts encoded by the 0xC1 / 0xD3 opcode groups
+        enum ShiftOp : uint8_t {
+            X86_ROL = 0,
+            X86_ROR = 1,
+            X86_RCR = 3,
+            X86_SHL = 4,
+            X86_SHR = 5,
+            X86_SAR = 7
+        };
+
+        /*
+            Tiny x86-64 assembler. All jumps are relative & stay inside of the emitted code, so it can be copied anywhere.
+            Operations are 32 bit wide unless stated otherwise.
+         */
+        class Emitter
+        {
+          public:
+            std::vector<uint8_t> code;
+
+            void emit8(uint8_t v)
+            {
+                code.push_back(v);
+            }
+            void emit32(uint32_t v)
+            {
+                for (int i = 0; i < 4; ++i)
+                    emit8(static_cast<uint8_t>(v >> (i * 8)));
+            }
+            void emit64(uint64_t v)
+            {
+                emit32(static_cast<uint32_t>(v));
+                emit32(static_cast<uint32_t>(v >> 32));
+            }
+
+          private:
+            static bool fits8(int32_t v)
+            {
+                return v >= -128 && v <= 127;
+            }
+
+            static bool needsRexForByte(uint8_t reg)
+            {
+                // without REX spl - dil would be ah - bh
+                return reg >= RSP && reg <= RDI;
+            }
+
+            void rex(bool w, uint8_t reg, uint8_t index, uint8_t base, bool force)
+            {
+                uint8_t prefix = 0x40 | (w ? 8 : 0) | ((reg & 8) ? 4 : 0) | ((index != NO_REG && (index & 8)) ? 2 : 0) | ((base & 8) ? 1 : 0);
+                if (prefix != 0x40 || force)
+                    emit8(prefix);
+            }
+
+            void opcode(std::initializer_list<uint8_t> op)
+            {
+                for (uint8_t b : op)
+                    emit8(b);
+            }
+
+            void modrm(uint8_t reg, const Mem &m)
+            {
+                const uint8_t mod = (m.disp == 0 && (m.base & 7) != RBP) ? 0 : (fits8(m.disp) ? 1 : 2);
+
+                if (m.index != NO_REG) {
+                    emit8((mod << 6) | ((reg & 7) << 3) | 4);
+                    emit8(((m.index & 7) << 3) | (m.base & 7));
+                } else if ((m.base & 7) == RSP) {
+                    emit8((mod << 6) | ((reg & 7) << 3) | 4);
+                    emit8(0x24);
+                } else {
+                    emit8((mod << 6) | ((reg & 7) << 3) | (m.base & 7));
+                }
+
+                if (mod == 1)
+                    emit8(static_cast<uint8_t>(m.disp));
+                else if (mod == 2)
+                    emit32(static_cast<uint32_t>(m.disp));
+            }
+
+          public:
+            // op reg, [mem] or op [mem], reg depending on the opcode, byteReg: reg is an 8 bit register
+            void rm(std::initializer_list<uint8_t> op, uint8_t reg, const Mem &m, bool w = false, bool byteReg = false)
+            {
+                rex(w, reg, m.index, m.base, byteReg && needsRexForByte(reg));
+                opcode(op);
+                modrm(reg, m);
+            }
+            // op reg, rmReg, byteReg: both are 8 bit registers
+            void rr(std::initializer_list<uint8_t> op, uint8_t reg, uint8_t rmReg, bool w = false, bool byteReg = false)
+            {
+                rex(w, reg, NO_REG, rmReg, byteReg && (needsRexForByte(reg) || needsRexForByte(rmReg)));
+                opcode(op);
+                emit8(0xC0 | ((reg & 7) << 3) | (rmReg & 7));
+            }
+
+            void mov(Reg dst, const Mem &m) { rm({0x8B}, dst, m); }
+            void mov(const Mem &m, Reg src) { rm({0x89}, src, m); }
+            void mov64(Reg dst, const Mem &m) { rm({0x8B}, dst, m, true); }
+            void mov(Reg dst, Reg src) { rr({0x8B}, dst, src); }
+            void mov64(Reg dst, Reg src) { rr({0x8B}, dst, src, true); }
+            void mov8(const Mem &m, Reg src) { rm({0x88}, src, m, false, true); }
+            void mov16(const Mem &m, Reg src)
+            {
+                emit8(0x66);
+                rm({0x89}, src, m);
+            }
+            void mov(const Mem &m, uint32_t imm)
+            {
+                rm({0xC7}, 0, m);
+                emit32(imm);
+            }
+            void mov8(const Mem &m, uint8_t imm)
+            {
+                rm({0xC6}, 0, m);
+                emit8(imm);
+            }
+            void mov(Reg dst, uint32_t imm)
+            {
+                if (dst & 8)
+                    emit8(0x41);
+                emit8(0xB8 + (dst & 7));
+                emit32(imm);
+            }
+            void mov64(Reg dst, uint64_t imm)
+            {
+                emit8((dst & 8) ? 0x49 : 0x48);
+                emit8(0xB8 + (dst & 7));
+                emit64(imm);
+            }
+            void movzx8(Reg dst, const Mem &m) { rm({0x0F, 0xB6}, dst, m); }
+            void movzx16(Reg dst, const Mem &m) { rm({0x0F, 0xB7}, dst, m); }
+            void movsx8(Reg dst, const Mem &m) { rm({0x0F, 0xBE}, dst, m); }
+            void movsx16(Reg dst, const Mem &m) { rm({0x0F, 0xBF}, dst, m); }
+            void movzx8(Reg dst, Reg src) { rr({0x0F, 0xB6}, dst, src, false, true); }
+            void movsx8(Reg dst, Reg src) { rr({0x0F, 0xBE}, dst, src, false, true); }
+            void movsx16(Reg dst, Reg src) { rr({0x0F, 0xBF}, dst, src); }
+            void lea64(Reg dst, const Mem &m) { rm({0x8D}, dst, m, true); }
+
+            void alu(AluOp op, Reg dst, Reg src) { rr({static_cast<uint8_t>(op * 8 + 3)}, dst, src); }
+            void alu64(AluOp op, Reg dst, uint8_t imm)
+            {
+                rr({0x83}, op, dst, true);
+                emit8(imm);
+            }
+            void alu(AluOp op, Reg dst, const Mem &m) { rm({static_cast<uint8_t>(op * 8 + 3)}, dst, m); }
+            void alu(AluOp op, const Mem &m, Reg src) { rm({static_cast<uint8_t>(op * 8 + 1)}, src, m); }
+            void alu(AluOp op, Reg dst, uint32_t imm)
+            {
+                if (fits8(static_cast<int32_t>(imm))) {
+                    rr({0x83}, op, dst);
+                    emit8(static_cast<uint8_t>(imm));
+                } else {
+                    rr({0x81}, op, dst);
+                    emit32(imm);
+                }
+            }
+            void alu(AluOp op, const Mem &m, uint32_t imm)
+            {
+                if (fits8(static_cast<int32_t>(imm))) {
+                    rm({0x83}, op, m);
+                    emit8(static_cast<uint8_t>(imm));
+                } else {
+                    rm({0x81}, op, m);
+                    emit32(imm);
+                }
+            }
+            void alu8(AluOp op, const Mem &m, uint8_t imm)
+            {
+                rm({0x80}, op, m);
+                emit8(imm);
+            }
+            void test(Reg a, Reg b) { rr({0x85}, b, a); }
+            void test64(Reg a, Reg b) { rr({0x85}, b, a, true); }
+            void test8(const Mem &m, uint8_t imm)
+            {
+                rm({0xF6}, 0, m);
+                emit8(imm);
+            }
+            void shift(ShiftOp op, Reg r, uint8_t amount)
+            {
+                rr({0xC1}, op, r);
+                emit8(amount);
+            }
+            void shift64(ShiftOp op, Reg r, uint8_t amount)
+            {
+                rr({0xC1}, op, r, true);
+                emit8(amount);
+            }
+            // shift by cl
+            void shiftCL(ShiftOp op, Reg r) { rr({0xD3}, op, r); }
+            void not_(Reg r) { rr({0xF7}, 2, r); }
+            void neg(Reg r) { rr({0xF7}, 3, r); }
+            // CF = bit of r
+            void bt(Reg r, uint8_t bit)
+            {
+                rr({0x0F, 0xBA}, 4, r);
+                emit8(bit);
+            }
+            // r = condition ? 1 : 0
+            void setcc(CondCode cc, Reg r)
+            {
+                rr({0x0F, static_cast<uint8_t>(0x90 + cc)}, 0, r, false, true);
+                movzx8(r, r);
+            }
+            void imul(Reg dst, Reg src, uint32_t imm)
+            {
+                rr({0x69}, dst, src);
+                emit32(imm);
+            }
+            void call(Reg r) { rr({0xFF}, 2, r); }
+            void push(Reg r)
+            {
+                if (r & 8)
+                    emit8(0x41);
+                emit8(0x50 + (r & 7));
+            }
+            void pop(Reg r)
+            {
+                if (r & 8)
+                    emit8(0x41);
+                emit8(0x58 + (r & 7));
+            }
+            void ret() { emit8(0xC3); }
+
+            // Jumps return the position of their rel32 operand that has to be patched with bind / patch
+            size_t jcc(CondCode cc)
+            {
+                emit8(0x0F);
+                emit8(0x80 + cc);
+                emit32(0);
+                return code.size() - 4;
+            }
+            size_t jmp()
+            {
+                emit8(0xE9);
+                emit32(0);
+                return code.size() - 4;
+            }
+            void patch(size_t pos, size_t target)
+            {
+                uint32_t rel = static_cast<uint32_t>(static_cast<int64_t>(target) - static_cast<int64_t>(pos + 4));
+                std::memcpy(code.data() + pos, &rel, sizeof(rel));
+            }
+            // lets the jump at pos continue at the current position
+            void bind(size_t pos)
+            {
+                patch(pos, code.size());
+            }
+        };
+
+        /*
+            Offsets of the state used by translated code relative to the CPU object (held in rbx).
+            Only the page table lives outside of it (held in r14).
+         */
+        struct Layout {
+            int32_t pipeline0, pipeline1, regs, cycleCount, memReg, execState, cyclesLeft;
+            int32_t lazyResult, lazyMsbOp1, lazyMsbOp2, lazyInvertCarry, lazyPending;
+            // the cpsr mirror flags in the order N, Z, C, V & the CPSR register
+            int32_t flags[4], cpsr;
+            int32_t seqCycles, nonSeqCycles;
+            int32_t writeCounter, invalidations, codePages;
+            // JIT::unitPC
+            int32_t unitPC;
+
+            const void *pages;
+            uint32_t pageSize;
+            int32_t pageRead, pageWrite, pageMask, pageCycles16, pageCycles32, pageByteWrites, pageCode, pageTiles;
+        };
+
+        // Flag bits of CPUState::LazyFlags::pending in the order N, Z, C, V
+        enum Flag : uint8_t {
+            FLAG_N,
+            FLAG_Z,
+            FLAG_C,
+            FLAG_V
+        };
+        constexpr uint8_t flagBit(Flag flag)
+        {
+            return static_cast<uint8_t>(1) << flag;
+        }
+        constexpr uint8_t cpsrBit(Flag flag)
+        {
+            return flag == FLAG_N ? cpsr_flags::N_FLAG : (flag == FLAG_Z ? cpsr_flags::Z_FLAG : (flag == FLAG_C ? cpsr_flags::C_FLAG : cpsr_flags::V_FLAG));
+        }
+        constexpr uint8_t NZ = flagBit(FLAG_N) | flagBit(FLAG_Z);
+        constexpr uint8_t NZC = NZ | flagBit(FLAG_C);
+        constexpr uint8_t NZCV = NZC | flagBit(FLAG_V);
+
+        /* Slow paths & everything else the translated code calls */
+        uint32_t read8(CPU *cpu, uint32_t addr)
+        {
+            return cpu->state.memory.read8(addr, cpu->state.cpuInfo, false);
+        }
+        uint32_t read16(CPU *cpu, uint32_t addr)
+        {
+            return cpu->state.memory.read16(addr, cpu->state.cpuInfo, false);
+        }
+        uint32_t read32(CPU *cpu, uint32_t addr)
+        {
+            return cpu->state.memory.read32(addr, cpu->state.cpuInfo, false);
+        }
+        void write8(CPU *cpu, uint32_t addr, uint32_t value)
+        {
+            cpu->state.memory.write8(addr, static_cast<uint8_t>(value), cpu->state.cpuInfo);
+        }
+        void write16(CPU *cpu, uint32_t addr, uint32_t value)
+        {
+            cpu->state.memory.write16(addr, static_cast<uint16_t>(value), cpu->state.cpuInfo);
+        }
+        void write32(CPU *cpu, uint32_t addr, uint32_t value)
+        {
+            cpu->state.memory.write32(addr, value, cpu->state.cpuInfo);
+        }
+        void invalidateCode(CPU *cpu, uint32_t addr)
+        {
+            cpu->blockCache.invalidate(addr);
+        }
+        template <bool thumb>
+        void refillPipeline(CPU *cpu)
+        {
+            cpu->refillPipelineAfterBranch<thumb>();
+        }
+
+        /*
+            Translates a single block. Register usage of the generated code:
+                rbx: CPU, r14: page table, r13d: blockCache.invalidations at the block entry,
+                r12d: address & rbp: written back base of memory accesses, r15d: value of stores,
+                all other registers are scratch registers.
+            Between instructions cycleCount is 0. PC, pipeline & memReg are only written if they are needed: by calls
+            into the emulator & when the block is left.
+         */
+        template <bool thumb>
+        class Translator
+        {
+            static constexpr uint32_t instSize = thumb ? 2 : 4;
+            static constexpr uint8_t entryExecState = thumb ? CPUState::EXEC_THUMB : 0;
+            static constexpr int UNKNOWN = -1;
+
+            Emitter &e;
+            const Layout &l;
+            CPU *cpu;
+            const BlockCache::Block &block;
+
+            // current instruction
+            uint32_t index;
+            uint32_t instPC;
+
+            // lazyFlags.pending if it is known at translation time, else UNKNOWN
+            int knownPending;
+            // instruction whose PC & pipeline are in the CPU state, else UNKNOWN
+            int flushedIndex;
+            // value of cpuInfo.memReg if it is known at translation time, else UNKNOWN
+            int knownMemReg;
+            // instructions execStep dispatches together with the following one as superinstruction
+            std::vector<bool> fusedFirst;
+
+            struct Exit {
+                size_t pos;
+                uint32_t index;
+                // PC & pipeline (and memReg) of the instruction have to be written
+                bool writeState;
+                bool writeMemReg;
+            };
+            std::vector<Exit> exits;
+
+          public:
+            uint32_t nativeCount;
+
+            Translator(Emitter &e, const Layout &l, CPU *cpu, const BlockCache::Block &block)
+                : e(e), l(l), cpu(cpu), block(block), index(0), instPC(0), knownPending(UNKNOWN), flushedIndex(UNKNOWN), knownMemReg(UNKNOWN), fusedFirst(block.length, false), nativeCount(0)
+            {
+                // execStep enters the block at its start, so the pairs are the same as in the interpreter
+                for (uint32_t i = 0; i + 1 < block.length; ++i) {
+                    if (block.insts[i].dispatch != block.insts[i].handler) {
+                        fusedFirst[i] = true;
+                        ++i;
+                    }
+                }
+            }
+
+            void translate()
+            {
+                const Reg saved[] = {RBX, RBP, R12, R13, R14, R15};
+                for (Reg r : saved)
+                    e.push(r);
+                // 6 pushes & the return address -> align the stack for calls
+                e.alu64(X86_SUB, RSP, 8);
+
+                e.mov64(RBX, reinterpret_cast<uint64_t>(cpu));
+                e.mov64(R14, reinterpret_cast<uint64_t>(l.pages));
+                e.mov(R13, Mem(RBX, l.invalidations));
+
+                // The pipeline has to contain the instructions of the block, only the second one was not checked yet
+                size_t bail = 0;
+                if (block.length > 1) {
+                    e.alu(X86_CMP, Mem(RBX, l.pipeline0), block.insts[1].inst);
+                    bail = e.jcc(CC_NE);
+                }
+
+                // forward the pipeline of the first instruction, the following ones only contain constants
+                e.mov(RAX, Mem(RBX, l.pipeline0));
+                e.mov(Mem(RBX, l.pipeline1), RAX);
+
+                for (index = 0; index < block.length; ++index) {
+                    instPC = (block.key & ~1) + index * instSize;
+                    const uint32_t inst = block.insts[index].inst;
+
+                    if (translateNative(thumb ? native::decodeThumb(inst, instPC) : native::decodeARM(inst, instPC)))
+                        ++nativeCount;
+                    else
+                        translateHandler();
+                }
+
+                // falling off the end of the block, execStep continues with the following instruction
+                index = block.length - 1;
+                instPC = (block.key & ~1) + index * instSize;
+                if (flushedIndex != static_cast<int>(index) || knownMemReg != block.insts[index].memReg)
+                    writeState(index, knownMemReg != block.insts[index].memReg);
+
+                // epilogue: returns true if at least one instruction was executed
+                const size_t epilogue = e.code.size();
+                e.mov(RAX, 1);
+                const size_t restore = e.code.size();
+                e.alu64(X86_ADD, RSP, 8);
+                for (int i = 5; i >= 0; --i)
+                    e.pop(saved[i]);
+                e.ret();
+
+                if (block.length > 1) {
+                    e.bind(bail);
+                    e.alu(X86_XOR, RAX, RAX);
+                    e.patch(e.jmp(), restore);
+                }
+
+                // exit stubs write the state of the instruction that was executed last
+                std::map<std::pair<uint32_t, bool>, size_t> stubs;
+                for (const Exit &exit : exits) {
+                    if (!exit.writeState) {
+                        e.patch(exit.pos, epilogue);
+                        continue;
+                    }
+
+                    auto it = stubs.find({exit.index, exit.writeMemReg});
+                    if (it == stubs.end()) {
+                        it = stubs.insert({{exit.index, exit.writeMemReg}, e.code.size()}).first;
+                        writeState(exit.index, exit.writeMemReg);
+                        e.patch(e.jmp(), epilogue);
+                    }
+                    e.patch(exit.pos, it->second);
+                }
+            }
+
+          private:
+            /* helpers */
+
+            Mem reg(uint8_t r) const
+            {
+                return Mem(RBX, l.regs + 4 * r);
+            }
+
+            uint32_t nextPC() const
+            {
+                return instPC + instSize;
+            }
+
+            /*
+                Dispatches of execStep: the first instruction of a superinstruction leaves its cycles in cycleCount
+                like CPU::execFusedPair, the second one accounts both. cycleCount is only non zero between them.
+             */
+            bool unitFirst() const
+            {
+                return fusedFirst[index];
+            }
+            bool unitSecond() const
+            {
+                return index > 0 && fusedFirst[index - 1];
+            }
+
+            // JIT::unitPC = PC of the dispatch the instruction belongs to, only needed for possible branches
+            void storeUnitPC()
+            {
+                if (unitSecond()) {
+                    // an ARM first instruction that was not executed is a dispatch of its own
+                    e.mov(Mem(RBX, l.unitPC), instPC - instSize);
+                    e.alu(X86_CMP, Mem(RBX, l.cycleCount), 0u);
+                    const size_t fused = e.jcc(CC_NE);
+                    e.mov(Mem(RBX, l.unitPC), instPC);
+                    e.bind(fused);
+                } else {
+                    e.mov(Mem(RBX, l.unitPC), instPC);
+                }
+            }
+
+            void callHelper(const void *function)
+            {
+                e.mov64(RAX, reinterpret_cast<uint64_t>(function));
+                e.call(RAX);
+            }
+
+            // PC, pipeline & memReg like after the (sequential) execution of instruction i
+            void writeState(uint32_t i, bool memReg)
+            {
+                const BlockCache::DecodedInst &decoded = block.insts[i];
+                e.mov(Mem(RBX, l.regs + 4 * regs::PC_OFFSET), (block.key & ~1) + (i + 1) * instSize);
+                e.mov(Mem(RBX, l.pipeline0), decoded.prefetch);
+                // the first instruction forwarded the pipeline at runtime
+                if (i > 0)
+                    e.mov(Mem(RBX, l.pipeline1), i + 1 < block.length ? block.insts[i + 1].inst : block.insts[i - 1].prefetch);
+                if (memReg)
+                    e.mov8(Mem(RBX, l.memReg), static_cast<uint8_t>(decoded.memReg));
+            }
+
+            // State needed by calls into the emulator
+            void flushState()
+            {
+                if (flushedIndex != static_cast<int>(index)) {
+                    writeState(index, false);
+                    flushedIndex = index;
+                }
+            }
+
+            void flushMemReg()
+            {
+                const uint8_t memReg = block.insts[index].memReg;
+                if (knownMemReg != memReg) {
+                    e.mov8(Mem(RBX, l.memReg), memReg);
+                    knownMemReg = memReg;
+                }
+            }
+
+            void exitIf(CondCode cc, bool writeState, bool writeMemReg)
+            {
+                exits.push_back(Exit{e.jcc(cc), index, writeState, writeMemReg});
+            }
+
+            // Accounts the fetch of an instruction that did not touch cycleCount, executed: false if its condition failed
+            void finishFetchCycles(bool executed)
+            {
+                const uint32_t cycles = block.insts[index].fetchCycles;
+                const bool writeMemReg = knownMemReg != block.insts[index].memReg;
+
+                if (executed && unitFirst()) {
+                    e.mov(Mem(RBX, l.cycleCount), cycles);
+                    e.alu(X86_CMP, Mem(RBX, l.cyclesLeft), cycles);
+                } else if (unitSecond()) {
+                    e.mov(RAX, Mem(RBX, l.cycleCount));
+                    e.alu(X86_ADD, RAX, cycles);
+                    e.mov(Mem(RBX, l.cycleCount), 0u);
+                    e.alu(X86_SUB, Mem(RBX, l.cyclesLeft), RAX);
+                } else {
+                    e.alu(X86_SUB, Mem(RBX, l.cyclesLeft), cycles);
+                }
+                exitIf(CC_LE, true, writeMemReg);
+            }
+
+            // Accounts cycleCount & leaves the block on state changes like CPU::execStep
+            void finishCycleCount(bool writeState, bool executed = true)
+            {
+                e.mov(RAX, Mem(RBX, l.cycleCount));
+                if (executed && unitFirst()) {
+                    e.alu(X86_CMP, Mem(RBX, l.cyclesLeft), RAX);
+                } else {
+                    e.mov(Mem(RBX, l.cycleCount), 0u);
+                    e.alu(X86_SUB, Mem(RBX, l.cyclesLeft), RAX);
+                }
+                exitIf(CC_LE, writeState, false);
+                e.alu8(X86_CMP, Mem(RBX, l.execState), entryExecState);
+                exitIf(CC_NE, writeState, false);
+                e.alu(X86_CMP, R13, Mem(RBX, l.invalidations));
+                exitIf(CC_NE, writeState, false);
+            }
+
+            /* condition flags */
+
+            void loadLazyFlag(Flag flag, Reg dst, Reg tmp1, Reg tmp2)
+            {
+                switch (flag) {
+                    case FLAG_N:
+                        e.mov(dst, Mem(RBX, l.lazyResult));
+                        e.shift(X86_SHR, dst, 31);
+                        break;
+                    case FLAG_Z:
+                        e.alu(X86_CMP, Mem(RBX, l.lazyResult), 0u);
+                        e.setcc(CC_E, dst);
+                        break;
+                    case FLAG_C:
+                        e.mov(dst, Mem(RBX, l.lazyResult + 4));
+                        e.alu(X86_AND, dst, 1u);
+                        e.movzx8(tmp1, Mem(RBX, l.lazyInvertCarry));
+                        e.alu(X86_XOR, dst, tmp1);
+                        break;
+                    case FLAG_V:
+                        // msbOp1 == msbOp2 && N != msbOp1
+                        e.movzx8(dst, Mem(RBX, l.lazyMsbOp1));
+                        e.movzx8(tmp1, Mem(RBX, l.lazyMsbOp2));
+                        e.alu(X86_XOR, tmp1, dst);
+                        e.alu(X86_XOR, tmp1, 1u);
+                        e.mov(tmp2, Mem(RBX, l.lazyResult));
+                        e.shift(X86_SHR, tmp2, 31);
+                        e.alu(X86_XOR, dst, tmp2);
+                        e.alu(X86_AND, dst, tmp1);
+                        break;
+                }
+            }
+
+            // dst = flag like CPUState::getFlag
+            void loadFlag(Flag flag, Reg dst, Reg tmp1, Reg tmp2)
+            {
+                if (knownPending != UNKNOWN) {
+                    if (knownPending & flagBit(flag))
+                        loadLazyFlag(flag, dst, tmp1, tmp2);
+                    else
+                        e.movzx8(dst, Mem(RBX, l.flags[flag]));
+                    return;
+                }
+
+                e.test8(Mem(RBX, l.lazyPending), flagBit(flag));
+                const size_t notPending = e.jcc(CC_E);
+                loadLazyFlag(flag, dst, tmp1, tmp2);
+                const size_t done = e.jmp();
+                e.bind(notPending);
+                e.movzx8(dst, Mem(RBX, l.flags[flag]));
+                e.bind(done);
+            }
+
+            // Writes the given pending flags into CPSR like CPUState::resolveLazyFlags, uses rax, rcx, rdx & rsi
+            void resolveFlags(uint8_t mask)
+            {
+                if (knownPending != UNKNOWN)
+                    mask &= knownPending;
+
+                for (uint8_t f = FLAG_N; f <= FLAG_V; ++f) {
+                    const Flag flag = static_cast<Flag>(f);
+                    if (!(mask & flagBit(flag)))
+                        continue;
+
+                    size_t notPending = 0;
+                    if (knownPending == UNKNOWN) {
+                        e.test8(Mem(RBX, l.lazyPending), flagBit(flag));
+                        notPending = e.jcc(CC_E);
+                    }
+
+                    loadLazyFlag(flag, RDX, RCX, RSI);
+                    e.mov8(Mem(RBX, l.flags[flag]), RDX);
+                    e.mov(RAX, Mem(RBX, l.cpsr));
+                    e.alu(X86_AND, RAX, ~(static_cast<uint32_t>(1) << cpsrBit(flag)));
+                    e.shift(X86_SHL, RDX, cpsrBit(flag));
+                    e.alu(X86_OR, RAX, RDX);
+                    e.mov(Mem(RBX, l.cpsr), RAX);
+                    e.alu8(X86_AND, Mem(RBX, l.lazyPending), static_cast<uint8_t>(~flagBit(flag)));
+
+                    if (knownPending == UNKNOWN)
+                        e.bind(notPending);
+                }
+
+                if (knownPending != UNKNOWN)
+                    knownPending &= ~mask;
+            }
+
+            /*
+                Stores the lazy flags like CPUState::setALUFlags, the flags that are not part of mask have to be resolved
+                before. The low word of the result is in eax, bit 32 of the result in carry (0 or 1), the signs of the
+                operands in msbOp1 & msbOp2 (registers or constants if NO_REG is given).
+             */
+            void storeFlags(uint8_t mask, bool invertCarry, Reg carry, Reg msbOp1, uint8_t constMsbOp1, Reg msbOp2, uint8_t constMsbOp2)
+            {
+                e.mov(Mem(RBX, l.lazyResult), RAX);
+                if (mask & flagBit(FLAG_C)) {
+                    e.mov(Mem(RBX, l.lazyResult + 4), carry);
+                    e.mov8(Mem(RBX, l.lazyInvertCarry), static_cast<uint8_t>(invertCarry));
+                }
+                if (mask & flagBit(FLAG_V)) {
+                    if (msbOp1 != NO_REG)
+                        e.mov8(Mem(RBX, l.lazyMsbOp1), msbOp1);
+                    else
+                        e.mov8(Mem(RBX, l.lazyMsbOp1), constMsbOp1);
+                    if (msbOp2 != NO_REG)
+                        e.mov8(Mem(RBX, l.lazyMsbOp2), msbOp2);
+                    else
+                        e.mov8(Mem(RBX, l.lazyMsbOp2), constMsbOp2);
+                }
+                e.mov8(Mem(RBX, l.lazyPending), mask);
+                knownPending = mask;
+            }
+
+            /*
+                Evaluates an ARM condition, returns the jump that has to be taken if it is not satisfied.
+                Uses rax, rcx, rdx, rsi & rdi.
+             */
+            size_t condition(uint8_t cond)
+            {
+                const auto flag = [this](Flag flag, Reg dst) {
+                    loadFlag(flag, dst, RSI, RDI);
+                };
+
+                switch (cond) {
+                    case EQ:
+                    case NE:
+                        flag(FLAG_Z, RAX);
+                        break;
+                    case CS_HS:
+                    case CC_LO:
+                        flag(FLAG_C, RAX);
+                        break;
+                    case MI:
+                    case PL:
+                        flag(FLAG_N, RAX);
+                        break;
+                    case VS:
+                    case VC:
+                        flag(FLAG_V, RAX);
+                        break;
+                    case HI:
+                    case LS:
+                        // C && !Z
+                        flag(FLAG_C, RAX);
+                        flag(FLAG_Z, RCX);
+                        e.alu(X86_XOR, RCX, 1u);
+                        e.alu(X86_AND, RAX, RCX);
+                        break;
+                    case GE:
+                    case LT:
+                        // N == V
+                        flag(FLAG_N, RAX);
+                        flag(FLAG_V, RCX);
+                        e.alu(X86_XOR, RAX, RCX);
+                        e.alu(X86_XOR, RAX, 1u);
+                        break;
+                    case GT:
+                    case LE:
+                        // !Z && N == V
+                        flag(FLAG_N, RAX);
+                        flag(FLAG_V, RCX);
+                        e.alu(X86_XOR, RAX, RCX);
+                        e.alu(X86_XOR, RAX, 1u);
+                        flag(FLAG_Z, RCX);
+                        e.alu(X86_XOR, RCX, 1u);
+                        e.alu(X86_AND, RAX, RCX);
+                        break;
+                    default:
+                        // NV
+                        e.alu(X86_XOR, RAX, RAX);
+                        break;
+                }
+
+                e.test(RAX, RAX);
+                // the odd conditions are the negation of the preceding even ones
+                const bool negate = cond != NV && (cond & 1);
+                return e.jcc(negate ? CC_NE : CC_E);
+            }
+
+            /* operands */
+
+            void load(Reg dst, const Operand &op)
+            {
+                if (op.isConst)
+                    e.mov(dst, op.value);
+                else
+                    e.mov(dst, reg(op.value));
+            }
+
+            /*
+                edx = shifted operand like shifts::shift<true>, the shifter carry is stored in r10d if needed.
+                r11d has to contain the C flag for RRX.
+             */
+            void shiftedOperand(const ShiftedOperand &op, bool carry)
+            {
+                load(RDX, op.base);
+
+                if (op.immCarry >= 0 && carry)
+                    e.mov(R10, static_cast<uint32_t>(op.immCarry));
+
+                switch (op.type) {
+                    case shifts::LSL:
+                        if (op.amount == 0)
+                            return;
+                        e.shift(X86_SHL, RDX, op.amount);
+                        break;
+                    case shifts::LSR:
+                        if (op.amount == 0) {
+                            // LSR #32
+                            if (carry) {
+                                e.mov(R10, RDX);
+                                e.shift(X86_SHR, R10, 31);
+                            }
+                            e.alu(X86_XOR, RDX, RDX);
+                            return;
+                        }
+                        e.shift(X86_SHR, RDX, op.amount);
+                        break;
+                    case shifts::ASR:
+                        // ASR #32 equals ASR #31 except for the carry
+                        e.shift(X86_SAR, RDX, op.amount == 0 ? 31 : op.amount);
+                        if (op.amount == 0) {
+                            if (carry) {
+                                e.mov(R10, RDX);
+                                e.alu(X86_AND, R10, 1u);
+                            }
+                            return;
+                        }
+                        break;
+                    case shifts::ROR:
+                        if (op.amount == 0) {
+                            // RRX
+                            e.bt(R11, 0);
+                            e.rr({0xD1}, X86_RCR, RDX);
+                        } else {
+                            e.shift(X86_ROR, RDX, op.amount);
+                        }
+                        break;
+                }
+
+                if (carry)
+                    e.setcc(CC_B, R10);
+            }
+
+            /*
+                Data processing like CPU::execDataProc with an operand shifted by an immediate.
+                rd is only written if write is set (never the PC).
+             */
+            void dataProc(DataProcOp op, bool s, uint8_t rd, bool write, const Operand &op1, const ShiftedOperand &op2)
+            {
+                const bool logical = op == DP_AND || op == DP_EOR || op == DP_TST || op == DP_TEQ || op == DP_ORR || op == DP_MOV || op == DP_BIC || op == DP_MVN;
+                const bool carryIn = op == DP_ADC || op == DP_SBC || op == DP_RSC;
+                const bool shifterCarry = s && logical && op2.updatesShifterCarry();
+
+                uint8_t mask = 0;
+                if (s) {
+                    mask = NZ;
+                    if (!logical || shifterCarry)
+                        mask |= flagBit(FLAG_C);
+                    if (!logical || op == DP_MOV)
+                        mask |= flagBit(FLAG_V);
+
+                    // flags of the previous operation that are not overwritten have to be kept
+                    resolveFlags(NZCV & ~mask);
+                }
+
+                if (carryIn || op2.needsCarryIn())
+                    loadFlag(FLAG_C, R11, RCX, RSI);
+
+                shiftedOperand(op2, shifterCarry);
+                if (op != DP_MOV && op != DP_MVN)
+                    load(RAX, op1);
+
+                const bool v = mask & flagBit(FLAG_V);
+                if (v && op != DP_MOV) {
+                    e.mov(R8, RAX);
+                    e.shift(X86_SHR, R8, 31);
+                    e.mov(R9, RDX);
+                    e.shift(X86_SHR, R9, 31);
+                    if (op == DP_SUB || op == DP_SBC || op == DP_CMP)
+                        e.alu(X86_XOR, R9, 1u);
+                    else if (op == DP_RSB || op == DP_RSC)
+                        e.alu(X86_XOR, R8, 1u);
+                    else if (op == DP_NEG) {
+                        // NEG only uses rs, the sign of rd is used as second operand
+                        e.alu(X86_XOR, R8, 1u);
+                        e.mov(R9, R8);
+                        e.alu(X86_XOR, R8, R8);
+                    }
+                }
+
+                switch (op) {
+                    case DP_AND:
+                    case DP_TST:
+                        e.alu(X86_AND, RAX, RDX);
+                        break;
+                    case DP_EOR:
+                    case DP_TEQ:
+                        e.alu(X86_XOR, RAX, RDX);
+                        break;
+                    case DP_ORR:
+                        e.alu(X86_OR, RAX, RDX);
+                        break;
+                    case DP_BIC:
+                        e.not_(RDX);
+                        e.alu(X86_AND, RAX, RDX);
+                        break;
+                    case DP_MOV:
+                        e.mov(RAX, RDX);
+                        break;
+                    case DP_MVN:
+                        e.not_(RDX);
+                        e.mov(RAX, RDX);
+                        break;
+                    case DP_ADD:
+                    case DP_CMN:
+                        e.alu(X86_ADD, RAX, RDX);
+                        break;
+                    case DP_ADC:
+                        e.bt(R11, 0);
+                        e.alu(X86_ADC, RAX, RDX);
+                        break;
+                    case DP_SUB:
+                    case DP_CMP:
+                        e.alu(X86_SUB, RAX, RDX);
+                        break;
+                    case DP_SBC:
+                        // borrow = !C
+                        e.alu(X86_XOR, R11, 1u);
+                        e.bt(R11, 0);
+                        e.alu(X86_SBB, RAX, RDX);
+                        break;
+                    case DP_RSB:
+                        e.alu(X86_SUB, RDX, RAX);
+                        e.mov(RAX, RDX);
+                        break;
+                    case DP_RSC:
+                        e.alu(X86_XOR, R11, 1u);
+                        e.bt(R11, 0);
+                        e.alu(X86_SBB, RDX, RAX);
+                        e.mov(RAX, RDX);
+                        break;
+                    case DP_NEG:
+                        e.mov(RAX, RDX);
+                        e.neg(RAX);
+                        break;
+                }
+
+                // bit 32 of the 64 bit result: the carry of additions, the borrow of subtractions
+                if (s && !logical)
+                    e.setcc(CC_B, R10);
+
+                if (write)
+                    e.mov(reg(rd), RAX);
+
+                if (s) {
+                    const bool invertCarry = op == DP_SUB || op == DP_SBC || op == DP_CMP || op == DP_RSB || op == DP_RSC || op == DP_NEG;
+                    // MOV never sets V, its operands are replaced by constants with different signs
+                    if (op == DP_MOV)
+                        storeFlags(mask, false, R10, NO_REG, 1, NO_REG, 0);
+                    else
+                        storeFlags(mask, invertCarry, R10, R8, 0, R9, 0);
+                }
+            }
+
+            /* memory accesses */
+
+            // rsi = page of the address in r12d
+            void lookupPage()
+            {
+                e.mov(RAX, R12);
+                e.shift(X86_SHR, RAX, 14);
+                e.alu(X86_AND, RAX, 0x3FFFu);
+                e.imul(RAX, RAX, l.pageSize);
+                e.lea64(RSI, Mem(R14, 0, RAX));
+            }
+
+            // cpuInfo.memReg = region of the address in r12d
+            void storeMemReg()
+            {
+                e.mov(RDX, R12);
+                e.shift(X86_SHR, RDX, 24);
+                e.alu(X86_AND, RDX, 0xFu);
+                e.mov8(Mem(RBX, l.memReg), RDX);
+            }
+
+            // eax = value at the address in r12d, like Memory::read8 / read16 / read32 (size in bytes)
+            void read(uint8_t size, bool sign)
+            {
+                lookupPage();
+                e.mov64(RCX, Mem(RSI, l.pageRead));
+                e.test64(RCX, RCX);
+                const size_t slow = e.jcc(CC_E);
+
+                e.movzx8(RAX, Mem(RSI, size == 4 ? l.pageCycles32 : l.pageCycles16));
+                e.alu(X86_ADD, Mem(RBX, l.cycleCount), RAX);
+                e.mov(RAX, Mem(RSI, l.pageMask));
+                e.alu(X86_AND, RAX, R12);
+                if (size > 1)
+                    e.alu(X86_AND, RAX, ~static_cast<uint32_t>(size - 1));
+                const Mem host(RCX, 0, RAX);
+                if (size == 1)
+                    sign ? e.movsx8(RAX, host) : e.movzx8(RAX, host);
+                else if (size == 2)
+                    sign ? e.movsx16(RAX, host) : e.movzx16(RAX, host);
+                else
+                    e.mov(RAX, host);
+                storeMemReg();
+                const size_t done = e.jmp();
+
+                e.bind(slow);
+                flushState();
+                e.mov64(RDI, RBX);
+                e.mov(RSI, R12);
+                callHelper(reinterpret_cast<const void *>(size == 1 ? &read8 : (size == 2 ? &read16 : &read32)));
+                if (sign)
+                    size == 1 ? e.movsx8(RAX, RAX) : e.movsx16(RAX, RAX);
+
+                e.bind(done);
+            }
+
+            // Writes r15d to the address in r12d, like Memory::write8 / write16 / write32 (size in bytes)
+            void write(uint8_t size)
+            {
+                lookupPage();
+                e.mov64(RCX, Mem(RSI, l.pageWrite));
+                size_t slow;
+                size_t slowTiles = 0;
+                if (size == 1) {
+                    e.alu8(X86_CMP, Mem(RSI, l.pageByteWrites), 0);
+                    slow = e.jcc(CC_E);
+                } else {
+                    e.test64(RCX, RCX);
+                    slow = e.jcc(CC_E);
+                    // the VRAM tiles have to be marked dirty
+                    e.alu8(X86_CMP, Mem(RSI, l.pageTiles), 0);
+                    slowTiles = e.jcc(CC_NE);
+                }
+
+                e.movzx8(RAX, Mem(RSI, size == 4 ? l.pageCycles32 : l.pageCycles16));
+                e.alu(X86_ADD, Mem(RBX, l.cycleCount), RAX);
+                e.alu(X86_ADD, Mem(RBX, l.writeCounter), 1u);
+                e.mov(RAX, Mem(RSI, l.pageMask));
+                e.alu(X86_AND, RAX, R12);
+                if (size > 1)
+                    e.alu(X86_AND, RAX, ~static_cast<uint32_t>(size - 1));
+                const Mem host(RCX, 0, RAX);
+                if (size == 1)
+                    e.mov8(host, R15);
+                else if (size == 2)
+                    e.mov16(host, R15);
+                else
+                    e.mov(host, R15);
+                storeMemReg();
+
+                // WRAM & IWRAM: invalidate decoded code, see BlockCache::invalidate
+                e.alu8(X86_CMP, Mem(RSI, l.pageCode), 0);
+                const size_t noCode = e.jcc(CC_E);
+                e.mov(RAX, R12);
+                e.alu(X86_CMP, RDX, static_cast<uint32_t>(memory::WRAM));
+                const size_t iwram = e.jcc(CC_NE);
+                e.alu(X86_AND, RAX, static_cast<uint32_t>(memory::WRAM_LIMIT - memory::WRAM_OFFSET));
+                e.shift(X86_SHR, RAX, BlockCache::PAGE_SHIFT);
+                const size_t check = e.jmp();
+                e.bind(iwram);
+                e.alu(X86_AND, RAX, static_cast<uint32_t>(memory::IWRAM_LIMIT - memory::IWRAM_OFFSET));
+                e.shift(X86_SHR, RAX, BlockCache::PAGE_SHIFT);
+                e.alu(X86_ADD, RAX, BlockCache::WRAM_PAGES);
+                e.bind(check);
+                e.alu8(X86_CMP, Mem(RBX, l.codePages, RAX), 0);
+                const size_t noCodePage = e.jcc(CC_E);
+                e.mov64(RDI, RBX);
+                e.mov(RSI, R12);
+                callHelper(reinterpret_cast<const void *>(&invalidateCode));
+                const size_t done = e.jmp();
+
+                e.bind(slow);
+                if (size != 1)
+                    e.bind(slowTiles);
+                flushState();
+                e.mov64(RDI, RBX);
+                e.mov(RSI, R12);
+                e.mov(RDX, R15);
+                callHelper(reinterpret_cast<const void *>(size == 1 ? &write8 : (size == 2 ? &write16 : &write32)));
+
+                e.bind(done);
+                e.bind(noCode);
+                e.bind(noCodePage);
+            }
+
+            /*
+                Load / store like CPU::execLoadStoreRegUByte & CPU::execHalfwordDataTransferImmRegSignedTransfer.
+                Neither rd nor a written back rn may be the PC.
+             */
+            void memoryAccess(const MemAccess &access)
+            {
+                const bool isLoad = access.op <= MEM_LDRSH;
+
+                // the fetch & 1I for loads, stores replace the S cycle of the fetch by a N cycle
+                if (isLoad) {
+                    e.alu(X86_ADD, Mem(RBX, l.cycleCount), static_cast<uint32_t>(block.insts[index].fetchCycles + 1));
+                } else {
+                    e.movzx8(RAX, Mem(RBX, l.nonSeqCycles));
+                    e.movzx8(RCX, Mem(RBX, l.seqCycles));
+                    e.alu(X86_SUB, RAX, RCX);
+                    e.alu(X86_ADD, RAX, static_cast<uint32_t>(block.insts[index].fetchCycles));
+                    e.alu(X86_ADD, Mem(RBX, l.cycleCount), RAX);
+                }
+
+                if (access.offset.needsCarryIn())
+                    loadFlag(FLAG_C, R11, RCX, RSI);
+                shiftedOperand(access.offset, false);
+                load(R12, access.base);
+                e.mov(RBP, R12);
+                e.alu(access.up ? X86_ADD : X86_SUB, RBP, RDX);
+                if (access.pre)
+                    e.mov(R12, RBP);
+
+                if (!isLoad)
+                    e.mov(R15, reg(access.rd));
+
+                switch (access.op) {
+                    case MEM_LDR:
+                        read(4, false);
+                        // unaligned words are rotated
+                        e.mov(RCX, R12);
+                        e.alu(X86_AND, RCX, 3u);
+                        e.shift(X86_SHL, RCX, 3);
+                        e.shiftCL(X86_ROR, RAX);
+                        break;
+                    case MEM_LDRB:
+                        read(1, false);
+                        break;
+                    case MEM_LDRH:
+                        read(2, false);
+                        e.mov(RCX, R12);
+                        e.alu(X86_AND, RCX, 1u);
+                        e.shift(X86_SHL, RCX, 3);
+                        e.shiftCL(X86_ROR, RAX);
+                        break;
+                    case MEM_LDRSB:
+                        read(1, true);
+                        break;
+                    case MEM_LDRSH: {
+                        // odd addresses load a sign extended byte
+                        e.bt(R12, 0);
+                        const size_t odd = e.jcc(CC_B);
+                        const int savedFlushed = flushedIndex;
+                        read(2, true);
+                        const size_t done = e.jmp();
+                        e.bind(odd);
+                        flushedIndex = savedFlushed;
+                        read(1, true);
+                        e.bind(done);
+                        break;
+                    }
+                    case MEM_STR:
+                        write(4);
+                        break;
+                    case MEM_STRB:
+                        write(1);
+                        break;
+                    case MEM_STRH:
+                        write(2);
+                        break;
+                }
+                // the slow paths are not always taken
+                flushedIndex = UNKNOWN;
+                knownMemReg = UNKNOWN;
+
+                if (isLoad)
+                    e.mov(reg(access.rd), RAX);
+                if (access.writeback && (!isLoad || access.rn != access.rd))
+                    e.mov(reg(access.rn), RBP);
+            }
+
+            /* instruction kinds */
+
+            template <class F>
+            void nativeALU(F body)
+            {
+                body();
+                finishFetchCycles(true);
+            }
+
+            void nativeMemory(const MemAccess &access)
+            {
+                memoryAccess(access);
+                finishCycleCount(true);
+            }
+
+            // ARM instructions with a condition, the not executed instruction only costs its fetch
+            template <class F>
+            void conditional(uint8_t cond, F body)
+            {
+                if (cond == AL) {
+                    body();
+                    return;
+                }
+
+                const int pendingBefore = knownPending;
+                const int memRegBefore = knownMemReg;
+                const int flushedBefore = flushedIndex;
+                const size_t skip = condition(cond);
+
+                body();
+                const size_t done = e.jmp();
+
+                e.bind(skip);
+                const int pendingAfter = knownPending;
+                const int memRegAfter = knownMemReg;
+                const int flushedAfter = flushedIndex;
+                knownPending = pendingBefore;
+                knownMemReg = memRegBefore;
+                flushedIndex = flushedBefore;
+                finishFetchCycles(false);
+
+                e.bind(done);
+                knownPending = pendingAfter == pendingBefore ? pendingAfter : UNKNOWN;
+                knownMemReg = memRegAfter == memRegBefore ? memRegAfter : UNKNOWN;
+                flushedIndex = flushedAfter == flushedBefore ? flushedAfter : UNKNOWN;
+            }
+
+            /*
+                Taken branches refill the pipeline like the branch handlers & leave the block. The cycles of the
+                dispatch are left in cycleCount, execStep accounts them after checking for idle loops.
+             */
+            void branch(uint32_t target)
+            {
+                e.alu(X86_ADD, Mem(RBX, l.cycleCount), static_cast<uint32_t>(block.insts[index].fetchCycles));
+                e.mov(Mem(RBX, l.regs + 4 * regs::PC_OFFSET), target);
+                e.mov64(RDI, RBX);
+                callHelper(reinterpret_cast<const void *>(&refillPipeline<thumb>));
+                exits.push_back(Exit{e.jmp(), index, false, false});
+            }
+
+            void conditionalBranch(uint8_t cond, uint32_t target)
+            {
+                storeUnitPC();
+
+                if (cond == AL) {
+                    branch(target);
+                    return;
+                }
+
+                const size_t notTaken = condition(cond);
+                const int pending = knownPending;
+                branch(target);
+                e.bind(notTaken);
+                knownPending = pending;
+                finishFetchCycles(false);
+            }
+
+            // Everything else is executed by calling the instruction handler
+            void translateHandler()
+            {
+                const BlockCache::DecodedInst &decoded = block.insts[index];
+
+                flushState();
+                flushMemReg();
+                storeUnitPC();
+                e.alu(X86_ADD, Mem(RBX, l.cycleCount), static_cast<uint32_t>(decoded.fetchCycles));
+
+                size_t skip = 0;
+                if (decoded.conditional)
+                    skip = condition(decoded.inst >> 28);
+
+                MemberFunctionPtr handler;
+                std::memcpy(&handler, &decoded.handler, sizeof(handler));
+                e.mov64(RDI, reinterpret_cast<uint64_t>(cpu) + handler.adj);
+                e.mov(RSI, decoded.inst);
+                callHelper(reinterpret_cast<const void *>(handler.ptr));
+
+                // handlers may change anything
+                knownPending = UNKNOWN;
+                knownMemReg = UNKNOWN;
+
+                // any branch leaves the block, execStep accounts the cycles like for native branches
+                e.alu(X86_CMP, Mem(RBX, l.regs + 4 * regs::PC_OFFSET), nextPC());
+                exitIf(CC_NE, false, false);
+
+                if (decoded.conditional && unitFirst()) {
+                    // the second instruction is only dispatched together with an executed first one
+                    finishCycleCount(false);
+                    const size_t done = e.jmp();
+                    e.bind(skip);
+                    finishCycleCount(false, false);
+                    e.bind(done);
+                    return;
+                }
+
+                if (decoded.conditional)
+                    e.bind(skip);
+                finishCycleCount(false);
+            }
+
+            // Instructions decoded by native::decodeARM / decodeThumb, returns false if the handler has to be called
+            bool translateNative(const native::Inst &decoded)
+            {
+                switch (decoded.kind) {
+                    case native::Inst::DATA_PROC: {
+                        const native::DataProc dp = decoded.dataProc;
+                        conditional(decoded.cond, [=]() { nativeALU([=]() { dataProc(dp.op, dp.s, dp.rd, dp.write, dp.op1, dp.op2); }); });
+                        return true;
+                    }
+                    case native::Inst::THUMB_SHIFT: {
+                        const native::DataProc dp = decoded.dataProc;
+                        nativeALU([=]() { thumbShift(dp.op2.type, dp.rd, dp.op2.base.value, dp.op2.amount); });
+                        return true;
+                    }
+                    case native::Inst::MEMORY: {
+                        const MemAccess access = decoded.memAccess;
+                        conditional(decoded.cond, [=]() { nativeMemory(access); });
+                        return true;
+                    }
+                    case native::Inst::BRANCH:
+                        // BL uses the handler
+                        if (decoded.link)
+                            return false;
+                        if (thumb && decoded.cond == AL)
+                            branch(decoded.target);
+                        else
+                            conditionalBranch(decoded.cond, decoded.target);
+                        return true;
+                    default:
+                        return false;
+                }
+            }
+
+            // THUMB move shifted register, unlike ARM LSL #0 clears C (see CPU::handleThumbMoveShiftedReg)
+            void thumbShift(shifts::ShiftType type, uint8_t rd, uint8_t rs, uint8_t amount)
+            {
+                resolveFlags(flagBit(FLAG_V));
+
+                e.mov(RAX, reg(rs));
+                if (type == shifts::LSL && amount == 0) {
+                    e.alu(X86_XOR, R10, R10);
+                } else if (amount == 0) {
+                    // LSR #32 & ASR #32
+                    e.mov(R10, RAX);
+                    e.shift(X86_SHR, R10, 31);
+                    if (type == shifts::LSR)
+                        e.alu(X86_XOR, RAX, RAX);
+                    else
+                        e.shift(X86_SAR, RAX, 31);
+                } else {
+                    e.shift(type == shifts::LSL ? X86_SHL : (type == shifts::LSR ? X86_SHR : X86_SAR), RAX, amount);
+                    e.setcc(CC_B, R10);
+                }
+
+                e.mov(reg(rd), RAX);
+                storeFlags(NZC, false, R10, NO_REG, 0, NO_REG, 0);
+            }
+        };
+    } // namespace
+
+    JIT::JIT(CPU *cpu, BlockCache &blockCache) : cpu(cpu), blockCache(blockCache), enabled(false), codeBuffer(nullptr), codeSize(0), unitPC(0)
+    {
+    }
+
+    JIT::~JIT()
+    {
+        if (codeBuffer)
+            munmap(codeBuffer, CODE_BUFFER_SIZE);
+    }
+
+    void JIT::setEnabled(bool enable)
+    {
+        if (enable && !codeBuffer) {
+            // W^X: the buffer is never writable & executable at the same time, see translate
+            void *mem = mmap(nullptr, CODE_BUFFER_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (mem == MAP_FAILED) {
+                std::cout << "WARNING: could not allocate memory for translated code, JIT stays disabled!" << std::endl;
+                return;
+            }
+            codeBuffer = static_cast<uint8_t *>(mem);
+        }
+
+        enabled = enable;
+    }
+
+    void JIT::flush()
+    {
+        blockCache.flushNative();
+        codeSize = 0;
+    }
+
+    template <bool thumb>
+    const uint8_t *JIT::translate(const BlockCache::Block &block)
+    {
+        const auto offset = [this](const void *member) {
+            return static_cast<int32_t>(reinterpret_cast<const uint8_t *>(member) - reinterpret_cast<const uint8_t *>(cpu));
+        };
+        CPUState &state = cpu->state;
+        Memory &memory = state.memory;
+
+        Layout l;
+        l.pipeline0 = offset(&state.pipeline[0]);
+        l.pipeline1 = offset(&state.pipeline[1]);
+        l.regs = offset(state.regs.rx);
+        l.cycleCount = offset(&state.cpuInfo.cycleCount);
+        l.memReg = offset(&state.cpuInfo.memReg);
+        l.execState = offset(&state.execState);
+        l.cyclesLeft = offset(&cpu->cyclesLeft);
+        l.lazyResult = offset(&state.lazyFlags.result);
+        l.lazyMsbOp1 = offset(&state.lazyFlags.msbOp1);
+        l.lazyMsbOp2 = offset(&state.lazyFlags.msbOp2);
+        l.lazyInvertCarry = offset(&state.lazyFlags.invertCarry);
+        l.lazyPending = offset(&state.lazyFlags.pending);
+        l.flags[FLAG_N] = offset(&state.cpsr.negative);
+        l.flags[FLAG_Z] = offset(&state.cpsr.zero);
+        l.flags[FLAG_C] = offset(&state.cpsr.carry);
+        l.flags[FLAG_V] = offset(&state.cpsr.overflow);
+        l.cpsr = offset(&state.regs.CPSR);
+        l.seqCycles = offset(&state.seqCycles);
+        l.nonSeqCycles = offset(&state.nonSeqCycles);
+        l.writeCounter = offset(&memory.writeCounter);
+        l.invalidations = offset(&blockCache.invalidations);
+        l.codePages = offset(blockCache.codePages);
+        l.unitPC = offset(&unitPC);
+
+        l.pages = memory.pages;
+        l.pageSize = sizeof(Memory::Page);
+        l.pageRead = offsetof(Memory::Page, read);
+        l.pageWrite = offsetof(Memory::Page, write);
+        l.pageMask = offsetof(Memory::Page, mask);
+        l.pageCycles16 = offsetof(Memory::Page, cycles16);
+        l.pageCycles32 = offsetof(Memory::Page, cycles32);
+        l.pageByteWrites = offsetof(Memory::Page, byteWrites);
+        l.pageCode = offsetof(Memory::Page, code);
+        l.pageTiles = offsetof(Memory::Page, tiles);
+
+        Emitter e;
+        Translator<thumb> translator(e, l, cpu, block);
+        translator.translate();
+
+        if (e.code.size() > CODE_BUFFER_SIZE)
+            return nullptr;
+
+        if (codeSize + e.code.size() > CODE_BUFFER_SIZE) {
+            LOG_JIT(std::cout << "INFO: JIT code buffer full, flushing translated code" << std::endl;);
+            flush();
+        }
+
+        uint8_t *native = codeBuffer + codeSize;
+
+        // make the affected pages writable, copy the code & make them executable again
+        const uintptr_t pageSize = static_cast<uintptr_t>(sysconf(_SC_PAGESIZE));
+        uint8_t *first = reinterpret_cast<uint8_t *>(reinterpret_cast<uintptr_t>(native) & ~(pageSize - 1));
+        const size_t length = static_cast<size_t>(native + e.code.size() - first);
+
+        if (mprotect(first, length, PROT_READ | PROT_WRITE) != 0)
+            return nullptr;
+        std::memcpy(native, e.code.data(), e.code.size());
+        if (mprotect(first, length, PROT_READ | PROT_EXEC) != 0)
+            return nullptr;
+
+        codeSize += e.code.size();
+
+        LOG_JIT(std::cout << "INFO: translated block at 0x" << std::hex << (block.key & ~1) << " (" << std::dec << block.length << " instructions, " << translator.nativeCount << " native, " << e.code.size() << " bytes)" << std::endl;);
+
+        return native;
+    }
+#else
+    JIT::JIT(CPU *cpu, BlockCache &blockCache) : cpu(cpu), blockCache(blockCache), enabled(false), codeBuffer(nullptr), codeSize(0), unitPC(0)
+    {
+    }
+
+    JIT::~JIT()
+    {
+    }
+
+    void JIT::setEnabled(bool enable)
+    {
+        if (enable)
+            std::cout << "WARNING: JIT is not supported on this platform!" << std::endl;
+    }
+
+    void JIT::flush()
+    {
+        blockCache.flushNative();
+    }
+
+    template <bool thumb>
+    const uint8_t *JIT::translate(const BlockCache::Block &)
+    {
+        return nullptr;
+    }
+#endif
+
+    template const uint8_t *JIT::translate<true>(const BlockCache::Block &);
+    template const uint8_t *JIT::translate<false>(const BlockCache::Block &);
+} // namespace gbaemu
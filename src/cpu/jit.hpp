@@ -0,0 +1,113 @@
+#ifndef JIT_HPP
+#define JIT_HPP
+
+#include "block_cache.hpp"
+
+#include <cstddef>
+#include <cstdint>
+
+/*
+    The JIT emits x86-64 machine code and needs executable memory via mmap.
+ */
+#if defined(__x86_64__) && defined(__unix__)
+#define JIT_SUPPORTED 1
+#else
+#define JIT_SUPPORTED 0
+#endif
+
+namespace gbaemu
+{
+    class CPU;
+
+    /*
+        Translates hot blocks of the block cache into x86-64 host code.
+
+        The generated code works directly on the CPUState of the CPU it was created for. Data processing
+        instructions with immediate shifts, branches and single loads & stores are translated into native
+        code operating on the guest registers and the lazy flags. Memory accesses use the page table of
+        Memory and only call back into it for IO, VRAM tiles and unmapped pages. Everything else calls
+        the instruction handler. PC and pipeline are only written before calls and when the block is left.
+        After every instruction cyclesLeft is updated exactly like in CPU::execStep.
+        The native code returns to execStep as soon as a branch is taken, the execution state changes,
+        the cycle budget is used up or code was invalidated.
+
+        Translated code is copied into a buffer that is never writable and executable at the same time.
+     */
+    class JIT
+    {
+      public:
+        // Number of block entries before a block gets translated
+        static constexpr uint32_t HOT_THRESHOLD = 32;
+        static constexpr size_t CODE_BUFFER_SIZE = 4 * 1024 * 1024;
+
+      private:
+        CPU *cpu;
+        BlockCache &blockCache;
+
+        bool enabled;
+
+        uint8_t *codeBuffer;
+        size_t codeSize;
+
+        // PC of the last instruction execStep would have dispatched if the translated code took a branch
+        uint32_t unitPC;
+
+        template <bool thumb>
+        const uint8_t *translate(const BlockCache::Block &block);
+
+      public:
+        JIT(CPU *cpu, BlockCache &blockCache);
+        ~JIT();
+
+        JIT(const JIT &) = delete;
+        JIT &operator=(const JIT &) = delete;
+
+        static bool isSupported()
+        {
+            return JIT_SUPPORTED;
+        }
+
+        bool isEnabled() const
+        {
+            return enabled;
+        }
+
+        // Runtime switch between translated code and the interpreter
+        void setEnabled(bool enable);
+
+        void flush();
+
+        /*
+            Executes the block starting at pc if it was translated, inst is the instruction in the pipeline.
+            Returns false if the interpreter has to execute the next instruction. Otherwise prevPC is set
+            like the interpreter would have, so that execStep finds the same idle loops.
+         */
+        template <bool thumb>
+        bool execute(uint32_t pc, uint32_t inst, uint32_t &prevPC)
+        {
+            BlockCache::Block *block = blockCache.find<thumb>(pc);
+
+            if (!block || block->insts[0].inst != inst)
+                return false;
+
+            if (!block->native) {
+                if (++block->hits < HOT_THRESHOLD)
+                    return false;
+
+                block->native = translate<thumb>(*block);
+                if (!block->native)
+                    return false;
+            }
+
+            // returns false if the pipeline does not hold the block
+            unitPC = pc;
+            if (!reinterpret_cast<bool (*)()>(const_cast<uint8_t *>(block->native))())
+                return false;
+
+            prevPC = unitPC;
+            return true;
+        }
+    };
+} // namespace gbaemu
+
+#endif /* JIT_HPP */
@@ -0,0 +1,267 @@
+#include "native_decode.hpp"
+
+#include "regs.hpp"
+#include "util.hpp"
+
+namespace gbaemu
+{
+    namespace native
+    {
+        namespace
+        {
+            Inst handler()
+            {
+                Inst decoded{};
+                decoded.kind = Inst::HANDLER;
+                decoded.cond = AL;
+                return decoded;
+            }
+
+            Inst dataProc(uint8_t cond, DataProcOp op, bool s, uint8_t rd, bool write, Operand op1, ShiftedOperand op2)
+            {
+                Inst decoded{};
+                decoded.kind = Inst::DATA_PROC;
+                decoded.cond = cond;
+                decoded.dataProc = DataProc{op, s, rd, write, op1, op2};
+                return decoded;
+            }
+
+            Inst memory(uint8_t cond, const MemAccess &access)
+            {
+                Inst decoded{};
+                decoded.kind = Inst::MEMORY;
+                decoded.cond = cond;
+                decoded.memAccess = access;
+                return decoded;
+            }
+
+            Inst branch(uint8_t cond, bool link, uint32_t target)
+            {
+                Inst decoded{};
+                decoded.kind = Inst::BRANCH;
+                decoded.cond = cond;
+                decoded.link = link;
+                decoded.target = target;
+                return decoded;
+            }
+        } // namespace
+
+        Inst decodeARM(uint32_t inst, uint32_t pc)
+        {
+            const uint8_t cond = inst >> 28;
+            const uint8_t rn = (inst >> 16) & 0xF;
+            const uint8_t rd = (inst >> 12) & 0xF;
+            const uint8_t rm = inst & 0xF;
+
+            // Note that pc is already incremented by 4 when the instruction is executed
+            const auto operand = [pc](uint8_t r) {
+                return r == regs::PC_OFFSET ? Operand::constant(pc + 8) : Operand::reg(r);
+            };
+            // the offset registers of loads & stores are used without adjustment
+            const auto rawOperand = [pc](uint8_t r) {
+                return r == regs::PC_OFFSET ? Operand::constant(pc + 4) : Operand::reg(r);
+            };
+            const auto shiftedReg = [inst](Operand base) {
+                return ShiftedOperand{base, static_cast<shifts::ShiftType>((inst >> 5) & 3), static_cast<uint8_t>((inst >> 7) & 0x1F), -1};
+            };
+
+            if (cond > AL)
+                return handler();
+
+            if ((inst & 0x0C000000) == 0) {
+                const bool i = inst & (1 << 25);
+                const bool s = inst & (1 << 20);
+                const uint8_t op = (inst >> 21) & 0xF;
+
+                if (!i && (inst & 0x90) == 0x90) {
+                    // halfword & signed transfers, multiplications & swaps use the handlers
+                    const uint8_t sh = (inst >> 5) & 3;
+                    const bool l = inst & (1 << 20);
+                    if (sh == 0 || (!l && sh != 1))
+                        return handler();
+
+                    MemAccess access;
+                    access.op = !l ? MEM_STRH : (sh == 1 ? MEM_LDRH : (sh == 2 ? MEM_LDRSB : MEM_LDRSH));
+                    access.rd = rd;
+                    access.rn = rn;
+                    access.base = operand(rn);
+                    access.offset = ShiftedOperand::plain((inst & (1 << 22)) ? Operand::constant(((inst >> 4) & 0xF0) | (inst & 0xF)) : rawOperand(rm));
+                    access.pre = inst & (1 << 24);
+                    access.up = inst & (1 << 23);
+                    access.writeback = !access.pre || (inst & (1 << 21));
+
+                    if (rd == regs::PC_OFFSET || (access.writeback && rn == regs::PC_OFFSET))
+                        return handler();
+
+                    return memory(cond, access);
+                }
+
+                // shifts by register, PSR transfers & writes to PC use the handlers
+                if ((!i && (inst & 0x10)) || (op >= DP_TST && op <= DP_CMN && !s) || rd == regs::PC_OFFSET)
+                    return handler();
+
+                ShiftedOperand op2;
+                if (i) {
+                    const uint8_t rotate = ((inst >> 8) & 0xF) * 2;
+                    const uint32_t imm = inst & 0xFF;
+                    const uint32_t value = rotate ? (imm >> rotate) | (imm << (32 - rotate)) : imm;
+                    // rotated immediates set C to bit 31, unrotated ones keep it
+                    const int8_t carry = rotate ? static_cast<int8_t>(value >> 31) : -1;
+                    op2 = ShiftedOperand{Operand::constant(value), shifts::LSL, 0, carry};
+                } else {
+                    op2 = shiftedReg(operand(rm));
+                }
+
+                const bool write = op < DP_TST || op > DP_CMN;
+                return dataProc(cond, static_cast<DataProcOp>(op), s, rd, write, operand(rn), op2);
+            }
+
+            if ((inst & 0x0C000000) == 0x04000000) {
+                const bool i = inst & (1 << 25);
+                if (i && (inst & 0x10))
+                    return handler();
+
+                MemAccess access;
+                const bool byte = inst & (1 << 22);
+                const bool l = inst & (1 << 20);
+                access.op = byte ? (l ? MEM_LDRB : MEM_STRB) : (l ? MEM_LDR : MEM_STR);
+                access.rd = rd;
+                access.rn = rn;
+                access.base = operand(rn);
+                access.offset = i ? shiftedReg(rawOperand(rm)) : ShiftedOperand::plain(Operand::constant(inst & 0xFFF));
+                access.pre = inst & (1 << 24);
+                access.up = inst & (1 << 23);
+                access.writeback = !access.pre || (inst & (1 << 21));
+
+                // loads into PC are branches, stores of PC & written back PCs are odd edge cases
+                if (rd == regs::PC_OFFSET || (access.writeback && rn == regs::PC_OFFSET))
+                    return handler();
+
+                return memory(cond, access);
+            }
+
+            if ((inst & 0x0E000000) == 0x0A000000) {
+                const int32_t offset = signExt<int32_t, uint32_t, 24>(inst & 0x00FFFFFF) * 4;
+                return branch(cond, inst & (1 << 24), pc + 8 + offset);
+            }
+
+            return handler();
+        }
+
+        Inst decodeThumb(uint16_t inst, uint32_t pc)
+        {
+            const uint8_t rd = inst & 7;
+            const uint8_t rs = (inst >> 3) & 7;
+
+            if ((inst & 0xF800) < 0x1800) {
+                // move shifted register
+                Inst decoded = dataProc(AL, DP_MOV, true, rd, true, Operand::reg(rd),
+                                        ShiftedOperand{Operand::reg(rs), static_cast<shifts::ShiftType>((inst >> 11) & 3), static_cast<uint8_t>((inst >> 6) & 0x1F), -1});
+                decoded.kind = Inst::THUMB_SHIFT;
+                return decoded;
+            }
+            if ((inst & 0xF800) == 0x1800) {
+                // add / subtract
+                const bool immediate = inst & (1 << 10);
+                const bool sub = inst & (1 << 9);
+                const uint8_t rn = (inst >> 6) & 7;
+                const Operand op2 = immediate ? Operand::constant(rn) : Operand::reg(rn);
+                return dataProc(AL, sub ? DP_SUB : DP_ADD, true, rd, true, Operand::reg(rs), ShiftedOperand::plain(op2));
+            }
+            if ((inst & 0xE000) == 0x2000) {
+                // move / compare / add / subtract immediate
+                static constexpr DataProcOp ops[] = {DP_MOV, DP_CMP, DP_ADD, DP_SUB};
+                const DataProcOp op = ops[(inst >> 11) & 3];
+                const uint8_t r = (inst >> 8) & 7;
+                return dataProc(AL, op, true, r, op != DP_CMP, Operand::reg(r), ShiftedOperand::plain(Operand::constant(inst & 0xFF)));
+            }
+            if ((inst & 0xFC00) == 0x4000) {
+                // ALU operations, shifts by register & MUL use the handlers
+                static constexpr int ops[] = {DP_AND, DP_EOR, -1, -1, -1, DP_ADC, DP_SBC, -1, DP_TST, DP_NEG, DP_CMP, DP_CMN, DP_ORR, -1, DP_BIC, DP_MVN};
+                const int op = ops[(inst >> 6) & 0xF];
+                if (op < 0)
+                    return handler();
+                const bool write = op != DP_TST && op != DP_CMP && op != DP_CMN;
+                return dataProc(AL, static_cast<DataProcOp>(op), true, rd, write, Operand::reg(rd), ShiftedOperand::plain(Operand::reg(rs)));
+            }
+            if ((inst & 0xFC00) == 0x4400) {
+                // hi register operations, BX & writes to PC use the handlers
+                const uint8_t op = (inst >> 8) & 3;
+                const uint8_t hd = rd | ((inst >> 4) & 8);
+                const uint8_t hs = (inst >> 3) & 0xF;
+                if (op == 3 || hd == regs::PC_OFFSET)
+                    return handler();
+                // Note that pc is already incremented by 2 when the instruction is executed
+                const auto operand = [pc](uint8_t r) {
+                    return r == regs::PC_OFFSET ? Operand::constant(pc + 4) : Operand::reg(r);
+                };
+                // only CMP sets flags
+                static constexpr DataProcOp ops[] = {DP_ADD, DP_CMP, DP_MOV};
+                return dataProc(AL, ops[op], op == 1, hd, op != 1, operand(hd), ShiftedOperand::plain(operand(hs)));
+            }
+
+            const uint8_t rb = rs;
+            MemAccess access{MEM_LDR, rd, rb, Operand::reg(rb), ShiftedOperand::plain(Operand::constant(0)), true, true, false};
+
+            if ((inst & 0xF800) == 0x4800) {
+                // PC relative load
+                access.rd = (inst >> 8) & 7;
+                access.base = Operand::constant((pc + 4) & ~2);
+                access.offset = ShiftedOperand::plain(Operand::constant((inst & 0xFF) << 2));
+            } else if ((inst & 0xF000) == 0x5000) {
+                // load / store with register offset, sign extended byte / halfword
+                static constexpr MemOp ops[] = {MEM_STR, MEM_STRB, MEM_LDR, MEM_LDRB, MEM_STRH, MEM_LDRSB, MEM_LDRH, MEM_LDRSH};
+                access.op = ops[(((inst >> 9) & 1) << 2) | ((inst >> 10) & 3)];
+                access.offset = ShiftedOperand::plain(Operand::reg((inst >> 6) & 7));
+            } else if ((inst & 0xE000) == 0x6000) {
+                // load / store with immediate offset
+                const bool byte = inst & (1 << 12);
+                const bool l = inst & (1 << 11);
+                const uint32_t offset = (inst >> 6) & 0x1F;
+                access.op = byte ? (l ? MEM_LDRB : MEM_STRB) : (l ? MEM_LDR : MEM_STR);
+                access.offset = ShiftedOperand::plain(Operand::constant(byte ? offset : offset << 2));
+            } else if ((inst & 0xF000) == 0x8000) {
+                // load / store halfword
+                access.op = (inst & (1 << 11)) ? MEM_LDRH : MEM_STRH;
+                access.offset = ShiftedOperand::plain(Operand::constant(((inst >> 6) & 0x1F) << 1));
+            } else if ((inst & 0xF000) == 0x9000) {
+                // SP relative load / store
+                access.op = (inst & (1 << 11)) ? MEM_LDR : MEM_STR;
+                access.rd = (inst >> 8) & 7;
+                access.rn = regs::SP_OFFSET;
+                access.base = Operand::reg(regs::SP_OFFSET);
+                access.offset = ShiftedOperand::plain(Operand::constant((inst & 0xFF) << 2));
+            } else if ((inst & 0xF000) == 0xA000) {
+                // load address
+                const uint8_t r = (inst >> 8) & 7;
+                const Operand offset = Operand::constant((inst & 0xFF) << 2);
+                if (inst & (1 << 11))
+                    return dataProc(AL, DP_ADD, false, r, true, Operand::reg(regs::SP_OFFSET), ShiftedOperand::plain(offset));
+                return dataProc(AL, DP_MOV, false, r, true, Operand::reg(r), ShiftedOperand::plain(Operand::constant(((pc + 4) & ~2) + offset.value)));
+            } else if ((inst & 0xFF00) == 0xB000) {
+                // add offset to stack pointer
+                const Operand offset = Operand::constant((inst & 0x7F) << 2);
+                return dataProc(AL, (inst & (1 << 7)) ? DP_SUB : DP_ADD, false, regs::SP_OFFSET, true, Operand::reg(regs::SP_OFFSET), ShiftedOperand::plain(offset));
+            } else if ((inst & 0xF000) == 0xD000) {
+                // conditional branch, the undefined condition & SWI use the handlers
+                const uint8_t cond = (inst >> 8) & 0xF;
+                if (cond >= AL)
+                    return handler();
+                const int32_t offset = static_cast<int8_t>(inst & 0xFF) * 2;
+                return branch(cond, false, pc + 4 + offset);
+            } else if ((inst & 0xF800) == 0xE000) {
+                // unconditional branch
+                const int32_t offset = signExt<int32_t, uint32_t, 11>(inst & 0x7FF) * 2;
+                return branch(AL, false, pc + 4 + offset);
+            } else if ((inst & 0xF800) == 0xF000) {
+                // first half of BL
+                const uint32_t offset = signExt<int32_t, uint32_t, 23>((inst & 0x7FF) << 12);
+                return dataProc(AL, DP_MOV, false, regs::LR_OFFSET, true, Operand::reg(regs::LR_OFFSET), ShiftedOperand::plain(Operand::constant(pc + 4 + offset)));
+            } else {
+                return handler();
+            }
+
+            return memory(AL, access);
+        }
+    } // namespace native
+} // namespace gbaemu
@@ -0,0 +1,137 @@
+#ifndef NATIVE_DECODE_HPP
+#define NATIVE_DECODE_HPP
+
+#include "decode/inst.hpp"
+
+#include <cstdint>
+
+namespace gbaemu
+{
+    /*
+        Decoding of the instructions that are translated into native code instead of calling their handlers: data
+        processing with immediate shifts, single loads & stores and direct branches. Shared by the JIT and the ahead
+        of time compiler (gbarecomp), everything that is not decoded here uses the instruction handlers.
+     */
+    namespace native
+    {
+        // Data processing operations, ARM opcode order with THUMB NEG at the end
+        enum DataProcOp : uint8_t {
+            DP_AND,
+            DP_EOR,
+            DP_SUB,
+            DP_RSB,
+            DP_ADD,
+            DP_ADC,
+            DP_SBC,
+            DP_RSC,
+            DP_TST,
+            DP_TEQ,
+            DP_CMP,
+            DP_CMN,
+            DP_ORR,
+            DP_MOV,
+            DP_BIC,
+            DP_MVN,
+            DP_NEG
+        };
+
+        enum MemOp : uint8_t {
+            MEM_LDR,
+            MEM_LDRB,
+            MEM_LDRH,
+            MEM_LDRSB,
+            MEM_LDRSH,
+            MEM_STR,
+            MEM_STRB,
+            MEM_STRH
+        };
+
+        // Either a guest register or a constant (e.g. the PC or an immediate)
+        struct Operand {
+            bool isConst;
+            uint32_t value;
+
+            static Operand reg(uint8_t r) { return Operand{false, r}; }
+            static Operand constant(uint32_t value) { return Operand{true, value}; }
+        };
+
+        // Operand shifted by an immediate like the ARM shifter with shiftByImm
+        struct ShiftedOperand {
+            Operand base;
+            shifts::ShiftType type;
+            uint8_t amount;
+            // immediates of data processing instructions: the carry is either unchanged (-1) or constant
+            int8_t immCarry;
+
+            static ShiftedOperand plain(Operand op) { return ShiftedOperand{op, shifts::LSL, 0, -1}; }
+
+            // RRX shifts the C flag in
+            bool needsCarryIn() const
+            {
+                return type == shifts::ROR && amount == 0 && immCarry < 0;
+            }
+
+            // True if the shifter carry is written to the C flag by logical operations (see CPU::execDataProc)
+            bool updatesShifterCarry() const
+            {
+                return immCarry >= 0 || type != shifts::LSL || amount != 0;
+            }
+        };
+
+        // rd is only written if write is set (never the PC)
+        struct DataProc {
+            DataProcOp op;
+            bool s;
+            uint8_t rd;
+            bool write;
+            Operand op1;
+            ShiftedOperand op2;
+
+            bool logical() const
+            {
+                return op == DP_AND || op == DP_EOR || op == DP_TST || op == DP_TEQ || op == DP_ORR || op == DP_MOV || op == DP_BIC || op == DP_MVN;
+            }
+        };
+
+        struct MemAccess {
+            MemOp op;
+            uint8_t rd;
+            uint8_t rn;
+            Operand base;
+            ShiftedOperand offset;
+            bool pre, up, writeback;
+
+            bool isLoad() const
+            {
+                return op <= MEM_LDRSH;
+            }
+        };
+
+        struct Inst {
+            enum Kind : uint8_t {
+                // executed by the handler
+                HANDLER,
+                DATA_PROC,
+                // THUMB move shifted register: dataProc.op2 shifted into dataProc.rd, unlike ARM LSL #0 clears C
+                THUMB_SHIFT,
+                MEMORY,
+                // B & ARM BL, THUMB branches are unconditional if cond is AL
+                BRANCH
+            };
+
+            Kind kind;
+            // AL for all THUMB instructions but conditional branches
+            uint8_t cond;
+            bool link;
+            uint32_t target;
+            DataProc dataProc;
+            MemAccess memAccess;
+        };
+
+        // pc is the address of the instruction itself
+        Inst decodeARM(uint32_t inst, uint32_t pc);
+        Inst decodeThumb(uint16_t inst, uint32_t pc);
+    } // namespace native
+} // namespace gbaemu
+
+#endif /* NATIVE_DECODE_HPP */
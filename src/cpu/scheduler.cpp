@@ -0,0 +1,81 @@
+#include "scheduler.hpp"
+
+#include <algorithm>
+#include <cassert>
+
+namespace gbaemu
+{
+    Scheduler::Scheduler(int32_t &cyclesLeft) : cyclesLeft(cyclesLeft), clockScale(CLOCK_SCALE_ONE)
+    {
+        reset();
+    }
+
+    void Scheduler::reset()
+    {
+        for (Event &event : events)
+            event.pending = false;
+
+        cyclesLeft = 0;
+        deadline = 0;
+        stopRequested = false;
+    }
+
+    void Scheduler::updateDeadline()
+    {
+        const uint64_t current = now();
+
+        deadline = current + MAX_SLICE;
+        for (const Event &event : events)
+            if (event.pending && event.timestamp < deadline)
+                deadline = event.timestamp;
+
+        // may be negative if an event is already overdue
+        cyclesLeft = static_cast<int32_t>(toCPUCycles(static_cast<int64_t>(deadline - current)));
+    }
+
+    void Scheduler::setClockScale(uint32_t scale)
+    {
+        // the current time has to be taken with the old scale
+        const uint64_t current = now();
+
+        // callers validate the scale, the clamp only keeps the cycle conversions from overflowing
+        assert(scale >= MIN_CLOCK_SCALE && scale <= MAX_CLOCK_SCALE);
+        clockScale = std::min(std::max(scale, MIN_CLOCK_SCALE), MAX_CLOCK_SCALE);
+        cyclesLeft = static_cast<int32_t>(toCPUCycles(static_cast<int64_t>(deadline - current)));
+    }
+
+    void Scheduler::schedule(EventType type, uint64_t timestamp)
+    {
+        events[type].timestamp = timestamp;
+        events[type].pending = true;
+        updateDeadline();
+    }
+
+    void Scheduler::cancel(EventType type)
+    {
+        events[type].pending = false;
+        updateDeadline();
+    }
+
+    void Scheduler::processEvents()
+    {
+        for (;;) {
+            const uint64_t current = now();
+
+            // find the earliest due event, on equal timestamps the lower type wins
+            int next = -1;
+            for (int i = 0; i < EVENT_TYPE_COUNT; ++i)
+                if (events[i].pending && events[i].timestamp <= current && (next < 0 || events[i].timestamp < events[next].timestamp))
+                    next = i;
+
+            if (next < 0)
+                break;
+
+            events[next].pending = false;
+            // handlers may schedule new events
+            handlers[next](events[next].timestamp);
+        }
+
+        updateDeadline();
+    }
+} // namespace gbaemu
@@ -0,0 +1,146 @@
+#ifndef SCHEDULER_HPP
+#define SCHEDULER_HPP
+
+#include <cstdint>
+#include <functional>
+
+namespace gbaemu
+{
+    /*
+        Central event scheduler: hardware units post events with an absolute timestamp (in cycles) and the
+        CPU runs until the earliest of them is due. Every event type has at most one pending instance, scheduling
+        it again replaces the old timestamp. The few event types are kept in a fixed table & the earliest one is
+        searched linearly, which is cheaper than a heap for this size and allows canceling events.
+
+        The current time is not counted per instruction: CPU::cyclesLeft holds the cycles until the next
+        deadline, therefore now = deadline - cyclesLeft. Whenever the deadline changes cyclesLeft is adjusted
+        so that the execution loops (interpreter, JIT, idle loop skipping) stop exactly at the next event.
+
+        The CPU may be overclocked: cyclesLeft is counted in CPU cycles, timestamps in cycles of the nominal clock
+        the LCD, timers & DMAs run at. Both are only converted into each other when the deadline changes, the
+        execution loops are not affected. At the nominal clock the conversions are exact.
+     */
+    class Scheduler
+    {
+      public:
+        // Events that are due at the same time are handled in this order
+        enum EventType : uint8_t {
+            // end of the visible part of a scanline, HBlank starts
+            LCD_HDRAW_END = 0,
+            // end of a scanline including its HBlank
+            LCD_SCANLINE_END,
+            // overflow of a timer that counts cycles (count-up timers are driven by their predecessor)
+            TIMER_0_OVERFLOW,
+            TIMER_1_OVERFLOW,
+            TIMER_2_OVERFLOW,
+            TIMER_3_OVERFLOW,
+            // sample of the guest profiler, see GuestProfiler
+            PROFILER_SAMPLE,
+            // end of the cycle budget given to CPU::step
+            STEP_END,
+            EVENT_TYPE_COUNT
+        };
+
+        typedef std::function<void(uint64_t)> EventHandler;
+
+        // Deadline used if no events are pending
+        static constexpr uint32_t MAX_SLICE = 0x100000;
+
+        // Nominal clock of the GBA in Hz
+        static constexpr uint32_t CLOCK_HZ = 16 * 1024 * 1024;
+        // CPU cycles per nominal cycle are given in units of 1 / CLOCK_SCALE_ONE
+        static constexpr uint32_t CLOCK_SCALE_ONE = 256;
+        static constexpr uint32_t MIN_CLOCK_SCALE = CLOCK_SCALE_ONE / 4;
+        static constexpr uint32_t MAX_CLOCK_SCALE = CLOCK_SCALE_ONE * 8;
+
+      private:
+        struct Event {
+            uint64_t timestamp;
+            bool pending;
+        };
+
+        Event events[EVENT_TYPE_COUNT];
+        EventHandler handlers[EVENT_TYPE_COUNT];
+
+        int32_t &cyclesLeft;
+        uint64_t deadline;
+
+        uint32_t clockScale;
+
+        bool stopRequested;
+
+        void updateDeadline();
+
+      public:
+        Scheduler(int32_t &cyclesLeft);
+
+        void reset();
+
+        uint64_t now() const
+        {
+            return deadline - toNominalCycles(cyclesLeft);
+        }
+
+        // Rounds down by default, also for negative values (events that are overdue)
+        int64_t toCPUCycles(int64_t nominalCycles, bool roundUp = false) const
+        {
+            return (nominalCycles * clockScale + (roundUp ? CLOCK_SCALE_ONE - 1 : 0)) >> 8;
+        }
+        int64_t toNominalCycles(int64_t cpuCycles, bool roundUp = false) const
+        {
+            const int64_t scaled = cpuCycles * CLOCK_SCALE_ONE + (roundUp ? clockScale - 1 : 0);
+            return scaled >= 0 ? scaled / clockScale : -((-scaled + clockScale - 1) / clockScale);
+        }
+
+        /*
+            Multiplies the cycles the CPU gets per nominal cycle (per scanline, timer tick, ...) by
+            scale / CLOCK_SCALE_ONE, the scale has to be in [MIN_CLOCK_SCALE, MAX_CLOCK_SCALE].
+         */
+        void setClockScale(uint32_t scale);
+
+        uint32_t getClockScale() const
+        {
+            return clockScale;
+        }
+
+        // Effective clock of the CPU in Hz
+        double getCPUClock() const
+        {
+            return static_cast<double>(CLOCK_HZ) * clockScale / CLOCK_SCALE_ONE;
+        }
+
+        // The handler gets the timestamp the event was scheduled for, which might be slightly in the past
+        void setHandler(EventType type, EventHandler handler)
+        {
+            handlers[type] = std::move(handler);
+        }
+
+        void schedule(EventType type, uint64_t timestamp);
+
+        void cancel(EventType type);
+
+        bool isPending(EventType type) const
+        {
+            return events[type].pending;
+        }
+
+        // Handles all events that are due
+        void processEvents();
+
+        // Lets CPU::run return once the current events are handled
+        void requestStop()
+        {
+            stopRequested = true;
+        }
+
+        // Returns and clears the stop request
+        bool consumeStop()
+        {
+            bool stop = stopRequested;
+            stopRequested = false;
+            return stop;
+        }
+    };
+} // namespace gbaemu
+
+#endif /* SCHEDULER_HPP */
@@ -0,0 +1,80 @@
+#ifndef SUPERINSTRUCTIONS_TPP
+#define SUPERINSTRUCTIONS_TPP
+
+namespace gbaemu
+{
+    /*
+        Superinstructions: the block cache replaces the dispatch handler of the first instruction of a frequent
+        pair by one that also executes the second instruction, which saves one pass through execStep and one LUT
+        dispatch. The second instruction is only executed if execStep would have continued with it right away,
+        i.e. the first one did not branch, change the execution state or use up the cycles until the next event.
+        Therefore the cycle accounting & event timing are the same as for two separate dispatches.
+     */
+    template <bool thumb, CPU::InstExecutor first, CPU::InstExecutor second>
+    void CPU::execFusedPair(uint32_t inst)
+    {
+        constexpr uint32_t instSize = thumb ? 2 : 4;
+
+        (this->*first)(inst);
+
+        const uint32_t pc = state.getCurrentPC();
+        if (cyclesLeft - static_cast<int32_t>(state.cpuInfo.cycleCount) <= 0 ||
+            state.execState != (thumb ? CPUState::EXEC_THUMB : 0) ||
+            !blockCache.continuesBlock<thumb>(pc))
+            return;
+
+        const uint32_t secondInst = state.pipeline[1];
+        const BlockCache::DecodedInst *decoded = blockCache.next<thumb>(pc, secondInst, state.memory, thumb ? thumbExeLUT : armExeLUT);
+        if (!decoded)
+            return;
+
+        // forward the pipeline, the fetch was already done when the block was decoded
+        state.pipeline[1] = state.pipeline[0];
+        state.getPC() = pc + instSize;
+        state.pipeline[0] = decoded->prefetch;
+        state.cpuInfo.cycleCount += decoded->fetchCycles;
+        state.cpuInfo.memReg = decoded->memReg;
+
+        if (thumb || !decoded->conditional || conditionSatisfied(static_cast<ConditionOPCode>(secondInst >> 28), state)) {
+            (this->*second)(secondInst);
+        }
+    }
+
+#define THUMB_HANDLER(inst) CPU::resolveThumbHashHandler<constexprHashThumb(inst)>()
+#define ARM_HANDLER(inst) CPU::resolveArmHashHandler<constexprHashArm(inst)>()
+#define FUSED_PAIR(thumb, first, second) {first, second, &CPU::execFusedPair<thumb, first, second>}
+
+    const BlockCache::FusedPair CPU::thumbFusedPairs[] = {
+        // BL prefix & suffix
+        FUSED_PAIR(true, THUMB_HANDLER(0xF000), THUMB_HANDLER(0xF800)),
+        // CMP Rd,#nn / CMP Rd,Rs / CMP Rd,Rs (hi registers) followed by a conditional branch
+        FUSED_PAIR(true, THUMB_HANDLER(0x2800), THUMB_HANDLER(0xD000)),
+        FUSED_PAIR(true, THUMB_HANDLER(0x4280), THUMB_HANDLER(0xD000)),
+        FUSED_PAIR(true, THUMB_HANDLER(0x4500), THUMB_HANDLER(0xD000)),
+        // LDR Rd,[PC,#nn] from the literal pool
+        FUSED_PAIR(true, THUMB_HANDLER(0x4800), THUMB_HANDLER(0x4800)),
+        // PUSH / POP followed by BX
+        FUSED_PAIR(true, THUMB_HANDLER(0xB400), THUMB_HANDLER(0x4700)),
+        FUSED_PAIR(true, THUMB_HANDLER(0xBC00), THUMB_HANDLER(0x4700)),
+    };
+    const uint32_t CPU::thumbFusedPairCount = sizeof(thumbFusedPairs) / sizeof(thumbFusedPairs[0]);
+
+    const BlockCache::FusedPair CPU::armFusedPairs[] = {
+        // CMP Rn,#imm / CMP Rn,Rm followed by a (conditional) branch
+        FUSED_PAIR(false, ARM_HANDLER(0x03500000), ARM_HANDLER(0x0A000000)),
+        FUSED_PAIR(false, ARM_HANDLER(0x01500000), ARM_HANDLER(0x0A000000)),
+        // LDR Rd,[Rn,#imm], includes loads from the literal pool
+        FUSED_PAIR(false, ARM_HANDLER(0x059F0000), ARM_HANDLER(0x059F0000)),
+        // LDMIA SP!,{...} / STMDB SP!,{...} followed by BX
+        FUSED_PAIR(false, ARM_HANDLER(0x08BD0000), ARM_HANDLER(0x012FFF10)),
+        FUSED_PAIR(false, ARM_HANDLER(0x092D0000), ARM_HANDLER(0x012FFF10)),
+    };
+    const uint32_t CPU::armFusedPairCount = sizeof(armFusedPairs) / sizeof(armFusedPairs[0]);
+
+#undef THUMB_HANDLER
+#undef ARM_HANDLER
+#undef FUSED_PAIR
+
+} // namespace gbaemu
+
+#endif /* SUPERINSTRUCTIONS_TPP */
@@ -32,12 +32,10 @@ namespace gbaemu
             In some cases the BIOS may allow interrupts to be executed from inside of the SWI procedure. If so, and if the interrupt handler calls further SWIs, then care should be taken that the Supervisor Stack does not overflow.
             */
 
-            // Save the current CPSR register value into SPSR_svc
-            auto svcRegs = cpu->state.getModeRegs(CPUState::SupervisorMode);
-            *(svcRegs[regs::SPSR_OFFSET]) = cpu->state.getCurrentCPSR();
-            // Save PC to LR_svc
+            // The registers of the supervisor mode are swapped in by setCPUMode
+            const uint32_t savedCPSR = cpu->state.getCurrentCPSR();
             // Note that pc is already incremented by 2/4
-            *(svcRegs[regs::LR_OFFSET]) = cpu->state.getCurrentPC();
+            const uint32_t returnAddr = cpu->state.getCurrentPC();
 
             // Ensure that the CPSR represents that we are in ARM mode again
             // Clear all flags & enforce supervisor mode
@@ -46,8 +44,13 @@ namespace gbaemu
             cpu->state.setFlag<cpsr_flags::IRQ_DISABLE>(true);
             cpu->state.setCPUMode(0b010011);
 
+            // Save the previous CPSR register value into SPSR_svc
+            cpu->state.accessSPSR() = savedCPSR;
+            // Save PC to LR_svc
+            cpu->state.accessReg(regs::LR_OFFSET) = returnAddr;
+
             // Offset to the swi routine
-            *svcRegs[regs::PC_OFFSET] = Memory::BIOS_SWI_HANDLER_OFFSET;
+            cpu->state.getPC() = Memory::BIOS_SWI_HANDLER_OFFSET;
 
             cpu->refillPipelineAfterBranch<false>();
         }
@@ -129,26 +132,26 @@ namespace gbaemu
             r1: numerator % denominator
             r3: abs(numerator / denominator)
         */
-        static void _div(InstructionExecutionInfo &info, uint32_t *const *const currentRegs, int32_t numerator, int32_t denominator)
+        static void _div(InstructionExecutionInfo &info, uint32_t *currentRegs, int32_t numerator, int32_t denominator)
         {
             if (denominator == 0) {
                 LOG_SWI(std::cout << "WARNING: game attempted division by 0!" << std::endl;);
 
                 // Return something and pray that the game stops attempting suicide
-                *currentRegs[regs::R0_OFFSET] = (numerator < 0) ? -1 : 1;
-                *currentRegs[regs::R1_OFFSET] = static_cast<uint32_t>(numerator);
-                *currentRegs[regs::R3_OFFSET] = 1;
+                currentRegs[regs::R0_OFFSET] = (numerator < 0) ? -1 : 1;
+                currentRegs[regs::R1_OFFSET] = static_cast<uint32_t>(numerator);
+                currentRegs[regs::R3_OFFSET] = 1;
             } else if (numerator == static_cast<int32_t>(0x80000000) && denominator == static_cast<int32_t>(0xFFFFFFFF)) {
-                *currentRegs[regs::R0_OFFSET] = 0x80000000;
-                *currentRegs[regs::R1_OFFSET] = 0;
-                *currentRegs[regs::R3_OFFSET] = 0x80000000;
+                currentRegs[regs::R0_OFFSET] = 0x80000000;
+                currentRegs[regs::R1_OFFSET] = 0;
+                currentRegs[regs::R3_OFFSET] = 0x80000000;
             } else {
                 /* The standard way to do it. */
                 div_t result = std::div(numerator, denominator);
 
-                *currentRegs[regs::R0_OFFSET] = result.quot;
-                *currentRegs[regs::R1_OFFSET] = result.rem;
-                *currentRegs[regs::R3_OFFSET] = std::abs(result.quot);
+                currentRegs[regs::R0_OFFSET] = result.quot;
+                currentRegs[regs::R1_OFFSET] = result.rem;
+                currentRegs[regs::R3_OFFSET] = std::abs(result.quot);
             }
 
             //TODO proper time calculation
@@ -158,8 +161,8 @@ namespace gbaemu
             cpu->state.memory.setBiosState(Bios::BIOS_AFTER_SWI);
             auto currentRegs = cpu->state.getCurrentRegs();
 
-            int32_t numerator = static_cast<int32_t>(*currentRegs[regs::R0_OFFSET]);
-            int32_t denominator = static_cast<int32_t>(*currentRegs[regs::R1_OFFSET]);
+            int32_t numerator = static_cast<int32_t>(currentRegs[regs::R0_OFFSET]);
+            int32_t denominator = static_cast<int32_t>(currentRegs[regs::R1_OFFSET]);
             _div(cpu->state.cpuInfo, currentRegs, numerator, denominator);
         }
 
@@ -168,8 +171,8 @@ namespace gbaemu
             cpu->state.memory.setBiosState(Bios::BIOS_AFTER_SWI);
             auto currentRegs = cpu->state.getCurrentRegs();
 
-            int32_t numerator = static_cast<int32_t>(*currentRegs[regs::R1_OFFSET]);
-            int32_t denominator = static_cast<int32_t>(*currentRegs[regs::R0_OFFSET]);
+            int32_t numerator = static_cast<int32_t>(currentRegs[regs::R1_OFFSET]);
+            int32_t denominator = static_cast<int32_t>(currentRegs[regs::R0_OFFSET]);
             _div(cpu->state.cpuInfo, currentRegs, numerator, denominator);
         }
 
@@ -331,9 +334,9 @@ namespace gbaemu
             //TODO proper time calculation
 
             const auto currentRegs = cpu->state.getCurrentRegs();
-            uint32_t sourceAddr = *currentRegs[regs::R0_OFFSET];
-            uint32_t destAddr = *currentRegs[regs::R1_OFFSET];
-            uint32_t iterationCount = *currentRegs[regs::R2_OFFSET];
+            uint32_t sourceAddr = currentRegs[regs::R0_OFFSET];
+            uint32_t destAddr = currentRegs[regs::R1_OFFSET];
+            uint32_t iterationCount = currentRegs[regs::R2_OFFSET];
 
             auto &m = cpu->state.memory;
 
@@ -406,10 +409,10 @@ namespace gbaemu
         {
             cpu->state.memory.setBiosState(Bios::BIOS_AFTER_SWI);
             const auto currentRegs = cpu->state.getCurrentRegs();
-            uint32_t sourceAddr = *currentRegs[regs::R0_OFFSET];
-            uint32_t destAddr = *currentRegs[regs::R1_OFFSET];
-            const uint32_t iterationCount = *currentRegs[regs::R2_OFFSET];
-            uint32_t diff = *currentRegs[regs::R3_OFFSET];
+            uint32_t sourceAddr = currentRegs[regs::R0_OFFSET];
+            uint32_t destAddr = currentRegs[regs::R1_OFFSET];
+            const uint32_t iterationCount = currentRegs[regs::R2_OFFSET];
+            uint32_t diff = currentRegs[regs::R3_OFFSET];
 
             auto &m = cpu->state.memory;
             //TODO do those read & writes count as non sequential?
@@ -468,9 +471,9 @@ namespace gbaemu
         {
             cpu->state.memory.setBiosState(Bios::BIOS_AFTER_SWI);
             const auto currentRegs = cpu->state.getCurrentRegs();
-            uint32_t sourceAddr = *currentRegs[regs::R0_OFFSET];
-            uint32_t destAddr = *currentRegs[regs::R1_OFFSET];
-            uint32_t unpackFormatPtr = *currentRegs[regs::R2_OFFSET];
+            uint32_t sourceAddr = currentRegs[regs::R0_OFFSET];
+            uint32_t destAddr = currentRegs[regs::R1_OFFSET];
+            uint32_t unpackFormatPtr = currentRegs[regs::R2_OFFSET];
 
             //TODO proper time calculation
 
@@ -559,8 +562,8 @@ namespace gbaemu
         {
             cpu->state.memory.setBiosState(Bios::BIOS_AFTER_SWI);
             const auto currentRegs = cpu->state.getCurrentRegs();
-            uint32_t sourceAddr = *currentRegs[regs::R0_OFFSET];
-            uint32_t destAddr = *currentRegs[regs::R1_OFFSET];
+            uint32_t sourceAddr = currentRegs[regs::R0_OFFSET];
+            uint32_t destAddr = currentRegs[regs::R1_OFFSET];
 
             //TODO proper time calculation
 
@@ -654,8 +657,8 @@ namespace gbaemu
         {
             cpu->state.memory.setBiosState(Bios::BIOS_AFTER_SWI);
             const auto currentRegs = cpu->state.getCurrentRegs();
-            uint32_t sourceAddr = *currentRegs[regs::R0_OFFSET];
-            uint32_t destAddr = *currentRegs[regs::R1_OFFSET];
+            uint32_t sourceAddr = currentRegs[regs::R0_OFFSET];
+            uint32_t destAddr = currentRegs[regs::R1_OFFSET];
 
             //TODO proper time calculation
 
@@ -773,8 +776,8 @@ namespace gbaemu
         {
             cpu->state.memory.setBiosState(Bios::BIOS_AFTER_SWI);
             const auto currentRegs = cpu->state.getCurrentRegs();
-            uint32_t sourceAddr = *currentRegs[regs::R0_OFFSET];
-            uint32_t destAddr = *currentRegs[regs::R1_OFFSET];
+            uint32_t sourceAddr = currentRegs[regs::R0_OFFSET];
+            uint32_t destAddr = currentRegs[regs::R1_OFFSET];
 
             //TODO proper time calculation
 
@@ -848,8 +851,8 @@ namespace gbaemu
         {
             cpu->state.memory.setBiosState(Bios::BIOS_AFTER_SWI);
             const auto currentRegs = cpu->state.getCurrentRegs();
-            uint32_t srcAddr = *currentRegs[regs::R0_OFFSET];
-            uint32_t destAddr = *currentRegs[regs::R1_OFFSET];
+            uint32_t srcAddr = currentRegs[regs::R0_OFFSET];
+            uint32_t destAddr = currentRegs[regs::R1_OFFSET];
 
             //TODO proper time calculation considering bit width!
 
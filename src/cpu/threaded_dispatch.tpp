@@ -0,0 +1,69 @@
+#ifndef THREADED_DISPATCH_TPP
+#define THREADED_DISPATCH_TPP
+
+#ifdef THREADED_DISPATCH
+
+namespace gbaemu
+{
+    /*
+        Threaded dispatch of decoded blocks: instead of returning to execStep after every instruction, each handler
+        instance performs the bookkeeping of execStep itself and (tail) calls the handler of the next instruction.
+        Every handler therefore has its own dispatch site which allows the branch predictor to learn the successors
+        per instruction, and the handler is a template parameter so it is called directly instead of through a
+        member function pointer.
+
+        Execution stays inside of the block: branches, events, state changes (IRQ, DMA, HALT, THUMB switch) and
+        invalidated blocks return to execStep. The next handler is called with THREADED_TAIL_CALL, so the stack does
+        not grow. Without it the next instruction is returned through threadedNext to the loop in execThreaded.
+        The PC is already incremented & the pipeline forwarded for the instruction passed in.
+     */
+    template <bool thumb, CPU::InstExecutor handler>
+    uint32_t CPU::threadedStep(CPU &cpu, const BlockCache::DecodedInst *decoded)
+    {
+        constexpr uint32_t instSize = thumb ? 2 : 4;
+        CPUState &state = cpu.state;
+
+        const uint32_t pc = state.getCurrentPC() - instSize;
+
+        // the fetch was already done when the block was decoded
+        state.pipeline[0] = decoded->prefetch;
+        state.cpuInfo.cycleCount += decoded->fetchCycles;
+        state.cpuInfo.memReg = decoded->memReg;
+        if (thumb || !decoded->conditional || conditionSatisfied(static_cast<ConditionOPCode>(decoded->inst >> 28), state)) {
+            (cpu.*handler)(decoded->inst);
+        }
+
+        const uint32_t nextPC = state.getCurrentPC();
+        // execStep subtracts the cycles of the last executed instruction
+        const int32_t cyclesLeft = cpu.cyclesLeft - static_cast<int32_t>(state.cpuInfo.cycleCount);
+
+        if (cyclesLeft > 0 && state.execState == (thumb ? CPUState::EXEC_THUMB : 0) && cpu.blockCache.continuesBlock<thumb>(nextPC)) {
+            const BlockCache::DecodedInst *next = cpu.blockCache.next<thumb>(nextPC, state.pipeline[1], state.memory, thumb ? thumbExeLUT : armExeLUT);
+
+            if (next) {
+                cpu.cyclesLeft = cyclesLeft;
+                state.cpuInfo.cycleCount = 0;
+
+                // forward the pipeline
+                state.pipeline[1] = state.pipeline[0];
+                state.getPC() = nextPC + instSize;
+
+#ifdef THREADED_TAIL_CALL
+                THREADED_TAIL_CALL return next->threaded(cpu, next);
+#else
+                cpu.threadedNext = next;
+                return pc;
+#endif
+            }
+        }
+
+#ifndef THREADED_TAIL_CALL
+        cpu.threadedNext = nullptr;
+#endif
+        return pc;
+    }
+} // namespace gbaemu
+
+#endif
+
+#endif /* THREADED_DISPATCH_TPP */
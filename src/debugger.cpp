@@ -81,10 +81,13 @@ namespace gbaemu::debugger
         switch (bitSize) {
             case 8:
                 value = state.memory.read8(memAddr, execInfo, false);
+                break;
             case 16:
                 value = state.memory.read16(memAddr, execInfo, false);
+                break;
             case 32:
                 value = state.memory.read32(memAddr, execInfo, false);
+                break;
         }
 
         prevMemValue = value;
@@ -99,10 +102,13 @@ namespace gbaemu::debugger
         switch (bitSize) {
             case 8:
                 value = state.memory.read8(memAddr, execInfo, false);
+                break;
             case 16:
                 value = state.memory.read16(memAddr, execInfo, false);
+                break;
             case 32:
                 value = state.memory.read32(memAddr, execInfo, false);
+                break;
             default:
                 return false;
         }
@@ -157,6 +163,11 @@ namespace gbaemu::debugger
         traps.push_back(&t);
     }
 
+    void Watchdog::clear()
+    {
+        traps.clear();
+    }
+
     void Watchdog::check(uint32_t prevPC, uint32_t postPC, const Instruction &inst, const CPUState &state)
     {
         for (auto trap : traps)
@@ -164,7 +175,6 @@ namespace gbaemu::debugger
                 trap->trigger(prevPC, postPC, inst, state);
     }
 
-#ifdef DEBUG_CLI
     /* DebugCLI */
 
     void DebugCLI::executeInput(const std::string &line)
@@ -239,7 +249,12 @@ namespace gbaemu::debugger
             }
 
             address_t where = std::stoul(words[1], nullptr, 16);
-            cpu.state.memory.memWatch.watchAddress(where, MemWatch::Condition{0, true, true, false, false});
+            if (!cpu.state.memory.watchAddress(where, MemWatch::Condition{0, true, true, false, false})) {
+                std::cout << "DebugCLI: Only RAM, palette, VRAM, OAM & ROM can be watched." << std::endl;
+                return;
+            }
+            // instruction fetches from the fetch window do not go through the page table
+            cpu.state.invalidateFetchWindow();
             std::cout << "DebugCLI: Added watchpoint 0x" << std::hex << where << std::endl;
 
             return;
@@ -252,7 +267,7 @@ namespace gbaemu::debugger
             }
 
             address_t where = std::stoul(words[1], nullptr, 16);
-            cpu.state.memory.memWatch.unwatchAddress(where);
+            cpu.state.memory.unwatchAddress(where);
             std::cout << "DebugCLI: Watchpoint 0x" << std::hex << where << " removed." << std::endl;
 
             return;
@@ -305,8 +320,45 @@ namespace gbaemu::debugger
                 << "continue/con\nbreak/b [address] (defaults to PC)\nlistbreak/lb\nunbreak address\n"
                 << "watch address\nunwatch address\ndisas/dis [address] [length] (defaults to PC)\n"
                 << "regs/r\nbreakpoints/bps\nwatchpoints/wps\nstep/s\nreset\n"
-                << "watchevents\nmem address [1/2/4] [count]" << std::endl;
+                << "watchevents\nmem address [1/2/4] [count]\n"
+                << "trap addr address [times]\ntrap region region\ntrap mode mode\ntrap reg register [min pc]\n"
+                << "trap mem address [8/16/32] [min pc]\ntrap jumps\nuntrap\njumps\nhandlers [count/reset]" << std::endl;
+
+            return;
+        }
+
+        if (words[0] == "trap") {
+            executeTrapInput(words);
+            return;
+        }
 
+        if (words[0] == "untrap") {
+            watchdog.clear();
+            traps.clear();
+            jumpTrap = nullptr;
+            std::cout << "DebugCLI: Removed all traps." << std::endl;
+            return;
+        }
+
+        if (words[0] == "jumps") {
+            if (jumpTrap)
+                std::cout << jumpTrap->toString() << std::endl;
+            else
+                std::cout << "DebugCLI: No jump trap, add one with 'trap jumps'." << std::endl;
+            return;
+        }
+
+        if (words[0] == "handlers") {
+#ifdef PROFILE_HANDLERS
+            if (words.size() > 1 && words[1] == "reset") {
+                cpu.handlerProfile.reset();
+                std::cout << "DebugCLI: Reset the handler profile." << std::endl;
+            } else {
+                std::cout << cpu.handlerProfile.toString(words.size() > 1 ? std::stoul(words[1]) : 30);
+            }
+#else
+            std::cout << "DebugCLI: Handler profiling is only available in builds with PROFILE_HANDLERS." << std::endl;
+#endif
             return;
         }
 
@@ -371,7 +423,7 @@ namespace gbaemu::debugger
                 return;
             }
 
-            uint32_t objIndex = std::stol(words[1]);
+            //uint32_t objIndex = std::stol(words[1]);
             //std::cout << lcdController.getOBJLayerString(objIndex) << std::endl;
             return;
         }
@@ -382,7 +434,7 @@ namespace gbaemu::debugger
                 return;
             }
 
-            uint32_t bgIndex = std::stol(words[1]);
+            //uint32_t bgIndex = std::stol(words[1]);
             //std::cout << lcdController.getBGLayerString(bgIndex) << std::endl;
             return;
         }
@@ -390,99 +442,160 @@ namespace gbaemu::debugger
         std::cout << "DebugCLI: Invalid command!" << std::endl;
     }
 
-    DebugCLI::DebugCLI(CPU &cpuRef, lcd::LCDController &lcdRef) : cpu(cpuRef), lcdController(lcdRef), stepCount(0), cpuStepCount(0)
+    void DebugCLI::executeTrapInput(const std::vector<std::string> &words)
+    {
+        if (words.size() < 2) {
+            std::cout << "DebugCLI: Missing trap type." << std::endl;
+            return;
+        }
+
+        if (words[1] == "jumps") {
+            jumpTrap = new JumpTrap();
+            addTrap(jumpTrap);
+            std::cout << "DebugCLI: Logging jumps." << std::endl;
+            return;
+        }
+
+        if (words.size() < 3) {
+            std::cout << "DebugCLI: Missing trap parameter." << std::endl;
+            return;
+        }
+
+        uint32_t param = std::stoul(words[2], nullptr, 16);
+
+        if (words[1] == "addr") {
+            if (words.size() >= 4)
+                addTrap(new AddressTrapTimesX(param, std::stoul(words[3]), &trapTriggered));
+            else
+                addTrap(new AddressTrap(param, &trapTriggered));
+        } else if (words[1] == "region") {
+            addTrap(new ExecutionRegionTrap(static_cast<memory::MemoryRegion>(param & 0xF), &trapTriggered));
+        } else if (words[1] == "mode") {
+            if (param > CPUState::SystemMode) {
+                std::cout << "DebugCLI: Invalid CPU mode." << std::endl;
+                return;
+            }
+            addTrap(new CPUModeTrap(static_cast<CPUState::CPUMode>(param), &trapTriggered));
+        } else if (words[1] == "reg") {
+            if (param > regs::PC_OFFSET) {
+                std::cout << "DebugCLI: Invalid register." << std::endl;
+                return;
+            }
+            addTrap(new RegisterNonZeroTrap(param, words.size() >= 4 ? std::stoul(words[3], nullptr, 16) : 0, &trapTriggered));
+        } else if (words[1] == "mem") {
+            size_t bitSize = words.size() >= 4 ? std::stoul(words[3]) : 32;
+            if (bitSize != 8 && bitSize != 16 && bitSize != 32) {
+                std::cout << "DebugCLI: Invalid bit size." << std::endl;
+                return;
+            }
+            uint32_t value = bitSize == 8 ? safeRead8(param) : (bitSize == 16 ? safeRead16(param) : safeRead32(param));
+            addTrap(new MemoryChangeTrap(param, words.size() >= 5 ? std::stoul(words[4], nullptr, 16) : 0, &trapTriggered, value, bitSize));
+        } else {
+            std::cout << "DebugCLI: Invalid trap type." << std::endl;
+            return;
+        }
+
+        std::cout << "DebugCLI: Added trap." << std::endl;
+    }
+
+    void DebugCLI::addTrap(Trap *trap)
+    {
+        traps.emplace_back(trap);
+        watchdog.registerTrap(*trap);
+    }
+
+    void DebugCLI::updateAttachment()
+    {
+#ifdef DUMP_CPU_STATE
+        const bool attach = true;
+#else
+        const bool attach = exe1Step || !breakpoints.empty() || !watchdog.empty();
+#endif
+        cpu.setDebugHook(attach ? this : nullptr);
+    }
+
+    DebugCLI::DebugCLI(CPU &cpuRef, lcd::LCDController &lcdRef) : cpu(cpuRef), lcdController(lcdRef)
     {
         state = RUNNING;
-        watchEvent.address = INVALID_ADDRESS;
 
         cpu.state.memory.memWatch.registerTrigger([&](address_t addr, const MemWatch::Condition &cond,
                                                       uint32_t oldValue, bool onWrite, uint32_t newValue) {
-            watchEvent.address = addr;
-            watchEvent.condition = cond;
-            watchEvent.isWrite = onWrite;
-            watchEvent.oldValue = oldValue;
-            watchEvent.newValue = newValue;
+            if (ignoreWatchEvents)
+                return;
+
+            // PC is already incremented by the executing instruction
+            address_t pc = cpu.state.getCurrentPC() - (cpu.state.getFlag<cpsr_flags::THUMB_STATE>() ? 2 : 4);
+
+            if (onWrite)
+                watchEvents[addr].incWrite(pc);
+            else
+                watchEvents[addr].incRead(pc);
         });
     }
 
-    bool DebugCLI::step()
+    DebugCLI::~DebugCLI()
     {
-        if (state == STOPPED || state == HALTED)
-            return false;
+        cpu.setDebugHook(nullptr);
+        cpu.state.memory.memWatch.registerTrigger(nullptr);
+    }
+
+    bool DebugCLI::step(uint32_t cycles)
+    {
+        cpuExecutionMutex.lock();
 
         if (state == RUNNING) {
-            cpuExecutionMutex.lock();
-            ++cpuStepCount;
-            CPUExecutionInfoType executionInfo = cpu.step(1);
+            // attaching & detaching switches between the execution loop instantiations
+            updateAttachment();
+
+            CPUExecutionInfoType executionInfo = cycles ? cpu.step(cycles) : cpu.run();
             if (executionInfo != CPUExecutionInfoType::NORMAL) {
                 state = HALTED;
                 std::cout << "CPU error occurred: " << std::endl;
-                std::cout << cpu.state.executionInfo.message.str() << std::endl;
+                std::cout << cpu.state.executionInfo->message.str() << std::endl;
             }
-#ifdef DUMP_CPU_STATE
-            std::cout << cpu.state.toString() << std::endl;
-#endif
-            cpuExecutionMutex.unlock();
         }
 
-        address_t pc = cpu.state.accessReg(regs::PC_OFFSET);
-
-        if (pc != prevPC) {
-            if (state == RUNNING) {
-                if (watchEvent.address != INVALID_ADDRESS) {
-                    address_t addr = watchEvent.address;
-
-                    if (watchEvent.isWrite)
-                        watchEvents[watchEvent.address].incWrite(pc);
-                    else
-                        watchEvents[watchEvent.address].incRead(pc);
-
-                    // clear event
-                    watchEvent.address = INVALID_ADDRESS;
-                }
+        cpuExecutionMutex.unlock();
 
-                /*
-                if (watchEvent.address != INVALID_ADDRESS) {
-                    address_t addr = watchEvent.address;
+        return false;
+    }
 
-                    cpuExecutionMutex.lock();
-                    std::cout << "DebugCLI: watchpoint " << std::hex << addr << " reached" << '\n' <<
-                        "old value: " << std::dec << watchEvent.oldValue << "    0x" << std::hex << watchEvent.oldValue << '\n';
+    bool DebugCLI::afterStep(uint32_t prevPC, uint32_t pc)
+    {
+#ifdef DUMP_CPU_STATE
+        std::cout << cpu.state.toString() << std::endl;
+#endif
 
-                    if (watchEvent.isWrite)
-                        std::cout << "new value: " << std::dec << watchEvent.newValue << "    0x" << std::hex << watchEvent.newValue << '\n';
+        if (!watchdog.empty()) {
+            Instruction inst;
+            inst.isArm = !cpu.state.getFlag<cpsr_flags::THUMB_STATE>();
+            inst.inst = inst.isArm ? safeRead32(prevPC) : safeRead16(prevPC);
 
-                    std::cout << "acesses from " << std::hex << pc << std::endl;
+            watchdog.check(prevPC, pc, inst, cpu.state);
 
-                    state = STOPPED;
-                    cpuExecutionMutex.unlock();
+            if (trapTriggered) {
+                std::cout << "DebugCLI: trap triggered at 0x" << std::hex << pc << std::endl;
+                state = STOPPED;
+                trapTriggered = false;
+            }
+        }
 
-                    // clear event
-                    watchEvent.address = INVALID_ADDRESS;
-                }
-                 */
-
-                if (exe1Step) {
-                    cpuExecutionMutex.lock();
-                    std::cout << "DebugCLI: step executed" << std::endl;
-                    state = STOPPED;
-                    exe1Step = false;
-                    cpuExecutionMutex.unlock();
-                }
+        // DMA & halt steps
+        if (pc == prevPC)
+            return state == STOPPED;
 
-                if (breakpoints.find(pc) != breakpoints.end()) {
-                    cpuExecutionMutex.lock();
-                    std::cout << "DebugCLI: breakpoint 0x" << std::hex << pc << " reached" << std::endl;
-                    state = STOPPED;
-                    cpuExecutionMutex.unlock();
-                }
-            }
+        if (exe1Step) {
+            std::cout << "DebugCLI: step executed" << std::endl;
+            state = STOPPED;
+            exe1Step = false;
         }
 
-        prevPC = pc;
-        ++stepCount;
+        if (breakpoints.find(pc) != breakpoints.end()) {
+            std::cout << "DebugCLI: breakpoint 0x" << std::hex << pc << " reached" << std::endl;
+            state = STOPPED;
+        }
 
-        return false;
+        return state == STOPPED;
     }
 
     DebugCLI::State DebugCLI::getState() const
@@ -499,53 +612,53 @@ namespace gbaemu::debugger
 
     uint8_t DebugCLI::safeRead8(address_t addr)
     {
-        WatchEvent backup = watchEvent;
+        ignoreWatchEvents = true;
         InstructionExecutionInfo execInfo{0};
         auto value = cpu.state.memory.read8(addr, execInfo, false);
-        watchEvent = backup;
+        ignoreWatchEvents = false;
         return value;
     }
 
     uint16_t DebugCLI::safeRead16(address_t addr)
     {
-        WatchEvent backup = watchEvent;
+        ignoreWatchEvents = true;
         InstructionExecutionInfo execInfo{0};
         auto value = cpu.state.memory.read16(addr, execInfo, false);
-        watchEvent = backup;
+        ignoreWatchEvents = false;
         return value;
     }
 
     uint32_t DebugCLI::safeRead32(address_t addr)
     {
-        WatchEvent backup = watchEvent;
+        ignoreWatchEvents = true;
         InstructionExecutionInfo execInfo{0};
         auto value = cpu.state.memory.read32(addr, execInfo, false);
-        watchEvent = backup;
+        ignoreWatchEvents = false;
         return value;
     }
 
     void DebugCLI::safeWrite8(address_t addr, uint8_t value)
     {
-        WatchEvent backup = watchEvent;
+        ignoreWatchEvents = true;
         InstructionExecutionInfo execInfo{0};
         cpu.state.memory.write8(addr, value, execInfo);
-        watchEvent = backup;
+        ignoreWatchEvents = false;
     }
 
     void DebugCLI::safeWrite16(address_t addr, uint16_t value)
     {
-        WatchEvent backup = watchEvent;
+        ignoreWatchEvents = true;
         InstructionExecutionInfo execInfo{0};
         cpu.state.memory.write16(addr, value, execInfo);
-        watchEvent = backup;
+        ignoreWatchEvents = false;
     }
 
     void DebugCLI::safeWrite32(address_t addr, uint32_t value)
     {
-        WatchEvent backup = watchEvent;
+        ignoreWatchEvents = true;
         InstructionExecutionInfo execInfo{0};
         cpu.state.memory.write32(addr, value, execInfo);
-        watchEvent = backup;
+        ignoreWatchEvents = false;
     }
 
     std::string DebugCLI::getBreakpointInfo() const
@@ -575,6 +688,4 @@ namespace gbaemu::debugger
 
         return ss.str();
     }
-
-#endif
 } // namespace gbaemu::debugger
\ No newline at end of file
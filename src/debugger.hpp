@@ -7,6 +7,7 @@
 #include "logging.hpp"
 #include <cassert>
 #include <cstring>
+#include <map>
 #include <memory>
 #include <mutex>
 #include <optional>
@@ -35,6 +36,8 @@ namespace gbaemu::debugger
     class Trap
     {
       public:
+        virtual ~Trap() = default;
+
         virtual void trigger(uint32_t prevPC, uint32_t postPC, const Instruction &inst, const CPUState &state) = 0;
         virtual bool satisfied(uint32_t prevPC, uint32_t postPC, const Instruction &inst, const CPUState &state) = 0;
     };
@@ -156,11 +159,20 @@ namespace gbaemu::debugger
 
       public:
         void registerTrap(Trap &t);
+        void clear();
+        bool empty() const
+        {
+            return traps.empty();
+        }
         void check(uint32_t prevPC, uint32_t postPC, const Instruction &inst, const CPUState &state);
     };
 
-#ifdef DEBUG_CLI
-    class DebugCLI
+    /*
+        Command line debugger, enabled with --debug. It only attaches itself to the CPU (see DebugHook) while it has
+        to check something after every instruction: breakpoints, traps or a single step. Memory watchpoints work
+        without being attached, see Memory::watchAddress.
+     */
+    class DebugCLI : public DebugHook
     {
       public:
         enum State {
@@ -169,14 +181,6 @@ namespace gbaemu::debugger
             HALTED
         };
 
-        struct WatchEvent {
-            address_t address;
-            MemWatch::Condition condition;
-            uint32_t oldValue;
-            bool isWrite;
-            uint32_t newValue;
-        };
-
         struct WatchEventCounter {
             std::map<address_t, uint32_t> reads;
             std::map<address_t, uint32_t> writes;
@@ -204,24 +208,37 @@ namespace gbaemu::debugger
         State state;
 
         bool exe1Step = false;
-
-        address_t prevPC;
+        // set by the traps
+        bool trapTriggered = false;
+        // memory accesses of the debugger itself are no watch events
+        bool ignoreWatchEvents = false;
 
         std::mutex cpuExecutionMutex;
-        uint64_t stepCount;
-        uint64_t cpuStepCount;
 
-        WatchEvent watchEvent;
         std::map<address_t, WatchEventCounter> watchEvents;
 
         /* for code */
         std::set<address_t> breakpoints;
 
+        std::vector<std::unique_ptr<Trap>> traps;
+        Watchdog watchdog;
+        JumpTrap *jumpTrap = nullptr;
+
         void executeInput(const std::string &line);
+        void executeTrapInput(const std::vector<std::string> &words);
+        void addTrap(Trap *trap);
+
+        // Attaches to the CPU if anything has to be checked after every instruction, detaches otherwise
+        void updateAttachment();
 
       public:
         DebugCLI(CPU &cpuRef, lcd::LCDController &lcdRef);
-        bool step();
+        ~DebugCLI() override;
+
+        /* Runs the CPU for the given amount of cycles or until it requests a stop (0), does nothing while stopped. */
+        bool step(uint32_t cycles = 0);
+        bool afterStep(uint32_t prevPC, uint32_t pc) override;
+
         /* These can be called from external threads. */
         State getState() const;
         void passCommand(const std::string &line);
@@ -237,7 +254,6 @@ namespace gbaemu::debugger
         std::string getBreakpointInfo() const;
         std::string getWatchEventsInfo() const;
     };
-#endif
 } // namespace gbaemu::debugger
 
 #endif /* DEBUGGER_HPP */
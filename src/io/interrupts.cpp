@@ -32,8 +32,15 @@ namespace gbaemu
             *(offset + reinterpret_cast<uint8_t *>(&regs)) &= ~value;
             checkIRQStateCondition();
         } else if (offset == offsetof(InterruptControlRegs, waitStateCnt) || offset == offsetof(InterruptControlRegs, waitStateCnt) + 1) {
-            *(offset + reinterpret_cast<uint8_t *>(&regs)) = value;
-            cpu->state.memory.updateWaitCycles(le(regs.waitStateCnt));
+            uint8_t &reg = *(offset + reinterpret_cast<uint8_t *>(&regs));
+            if (reg != value) {
+                reg = value;
+                cpu->state.memory.updateWaitCycles(le(regs.waitStateCnt));
+                cpu->state.invalidateFetchWindow();
+                // decoded blocks & translated code contain the fetch cycles of the old wait states
+                cpu->blockCache.flush();
+                cpu->jit.flush();
+            }
         } else {
             if (offset == offsetof(InterruptControlRegs, irqMasterEnable)) {
                 // We store in LSB so this is fine!
@@ -95,11 +102,12 @@ namespace gbaemu
         are reserved for interrupt stack at 03007F00h-03007F9Fh.
         */
 
-        // Save the current CPSR register value into SPSR_irq
-        auto irqRegs = cpu->state.getModeRegs(CPUState::IRQ);
-        *(irqRegs[regs::SPSR_OFFSET]) = cpu->state.getCurrentCPSR();
-        // Save PC to LR_irq
-        *(irqRegs[regs::LR_OFFSET]) = cpu->state.getCurrentPC() + 4;
+        // The registers of the irq mode are swapped in by setCPUMode
+        const uint32_t savedCPSR = cpu->state.getCurrentCPSR();
+        const uint32_t returnAddr = cpu->state.getCurrentPC() + 4;
+
+        if (cpu->profiler.isEnabled())
+            cpu->profiler.onInterrupt(returnAddr - 4);
 
         // Change instruction mode to arm
         // Change the register mode to irq
@@ -110,7 +118,12 @@ namespace gbaemu
         cpu->state.setFlag<cpsr_flags::IRQ_DISABLE>(true);
         cpu->state.setCPUMode(0b010010);
 
-        *irqRegs[regs::PC_OFFSET] = Memory::BIOS_IRQ_HANDLER_OFFSET;
+        // Save the previous CPSR register value into SPSR_irq
+        cpu->state.accessSPSR() = savedCPSR;
+        // Save PC to LR_irq
+        cpu->state.accessReg(regs::LR_OFFSET) = returnAddr;
+
+        cpu->state.getPC() = Memory::BIOS_IRQ_HANDLER_OFFSET;
 
         // Flush the pipeline
         cpu->refillPipelineAfterBranch<false>();
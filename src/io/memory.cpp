@@ -1,4 +1,5 @@
 #include "memory.hpp"
+#include "cpu/block_cache.hpp"
 #include "decode/inst.hpp"
 #include "lcd/lcd-controller.hpp"
 #include "logging.hpp"
@@ -11,7 +12,6 @@
 namespace gbaemu
 {
 
-#ifdef DEBUG_CLI
     void MemWatch::registerTrigger(const std::function<void(address_t, Condition, uint32_t, bool, uint32_t)> &trig)
     {
         trigger = trig;
@@ -72,7 +72,6 @@ namespace gbaemu
 
         return ss.str();
     }
-#endif
 #define GBA_ALLOC_MEM_REG(x) new uint8_t[x##_LIMIT - x##_OFFSET + 1]
 #define GBA_MEM_CLEAR(arr, x) std::fill_n(arr, x##_LIMIT - x##_OFFSET + 1, 0)
 #define GBA_MEM_CLEAR_VALUE(arr, x, value) std::fill_n(arr, x##_LIMIT - x##_OFFSET + 1, (value))
@@ -82,6 +81,7 @@ namespace gbaemu
         wram = GBA_ALLOC_MEM_REG(memory::WRAM);
         iwram = GBA_ALLOC_MEM_REG(memory::IWRAM);
         bg_obj_ram = GBA_ALLOC_MEM_REG(memory::BG_OBJ_RAM);
+        pages = new Page[PAGE_COUNT];
         reset();
     }
 
@@ -147,6 +147,146 @@ namespace gbaemu
         cycles32Bit[1][memory::EXT_ROM1] = cycles32Bit[1][memory::EXT_ROM1_] = 2 * cycles16Bit[1][memory::EXT_ROM1];
         cycles32Bit[1][memory::EXT_ROM2] = cycles32Bit[1][memory::EXT_ROM2_] = 2 * cycles16Bit[1][memory::EXT_ROM2];
         cycles32Bit[1][memory::EXT_ROM3] = cycles32Bit[1][memory::EXT_ROM3_] = 2 * cycles16Bit[1][memory::EXT_ROM3];
+
+        updatePageTable();
+    }
+
+    void Memory::updatePageTable()
+    {
+        const uint8_t *romData = rom.rawAccess();
+        const size_t romSize = rom.getRomSize();
+
+        for (uint32_t i = 0; i < PAGE_COUNT; ++i) {
+            const uint32_t addr = i << PAGE_SHIFT;
+            const memory::MemoryRegion memReg = extractMemoryRegion(addr);
+            Page &page = pages[i];
+
+            page.read = nullptr;
+            page.write = nullptr;
+            page.mask = (static_cast<uint32_t>(1) << PAGE_SHIFT) - 1;
+            page.byteWrites = false;
+            page.code = false;
+            page.tiles = false;
+            page.watched = false;
+
+            for (uint8_t seq = 0; seq < 2; ++seq) {
+                page.cycles16[seq] = cycles16Bit[seq][memReg];
+                page.cycles32[seq] = cycles32Bit[seq][memReg];
+            }
+
+            uint8_t *host = nullptr;
+
+            switch (memReg) {
+                case memory::WRAM:
+                    host = wram + ((addr & memory::WRAM_LIMIT) - memory::WRAM_OFFSET);
+                    page.byteWrites = page.code = true;
+                    break;
+                case memory::IWRAM:
+                    host = iwram + ((addr & memory::IWRAM_LIMIT) - memory::IWRAM_OFFSET);
+                    page.byteWrites = page.code = true;
+                    break;
+                case memory::BG_OBJ_RAM:
+                    // 8 bit writes are repeated to the whole halfword
+                    host = bg_obj_ram;
+                    page.mask = memory::BG_OBJ_RAM_LIMIT - memory::BG_OBJ_RAM_OFFSET;
+                    break;
+                case memory::VRAM:
+                    // 8 bit writes depend on the BG mode
+                    host = vram.rawAccess() + (VRAM::handleMirroring(addr) - memory::VRAM_OFFSET);
+                    page.tiles = true;
+                    break;
+                case memory::OAM:
+                    // writes need to update the decoded objects
+                    page.read = oam.mem;
+                    page.mask = memory::OAM_LIMIT - memory::OAM_OFFSET;
+                    break;
+
+                case memory::EXT_ROM3_:
+                    if (rom.hasEEPROM())
+                        break;
+                    // Fall through, no EEPROM is mapped
+                case memory::EXT_ROM1:
+                case memory::EXT_ROM1_:
+                case memory::EXT_ROM2:
+                case memory::EXT_ROM2_:
+                case memory::EXT_ROM3:
+                    // Pages (partially) beyond the end of the ROM return the open bus values
+                    if (romData && (addr & 0x00FFFFFF) + (static_cast<uint32_t>(1) << PAGE_SHIFT) <= romSize)
+                        page.read = romData + (addr & 0x00FFFFFF);
+                    break;
+
+                default:
+                    break;
+            }
+
+            if (host) {
+                page.read = host;
+                page.write = host;
+            }
+        }
+
+        // the pages of watched addresses have to take the slow path
+        watchedPages.clear();
+        for (address_t addr : memWatch.getAddresses()) {
+            Page &page = pages[pageIndex(addr)];
+            if (page.watched)
+                continue;
+
+            watchedPages[pageIndex(addr)] = page;
+            page.read = nullptr;
+            page.write = nullptr;
+            page.byteWrites = false;
+            page.watched = true;
+        }
+    }
+
+    bool Memory::watchAddress(address_t addr, const MemWatch::Condition &cond)
+    {
+        const Page &page = pages[pageIndex(addr)];
+        if (!page.read && !page.watched)
+            return false;
+
+        memWatch.watchAddress(addr, cond);
+        updatePageTable();
+        return true;
+    }
+
+    void Memory::unwatchAddress(address_t addr)
+    {
+        memWatch.unwatchAddress(addr);
+        updatePageTable();
+    }
+
+    template <class T>
+    T Memory::readWatched(uint32_t addr) const
+    {
+        const Page &page = watchedPages.find(pageIndex(addr))->second;
+        const T value = le(*reinterpret_cast<const T *>(page.read + (addr & page.mask & ~static_cast<uint32_t>(sizeof(T) - 1))));
+
+        if (memWatch.isAddressWatched(addr))
+            memWatch.addressCheckTrigger(addr, value);
+
+        return value;
+    }
+
+    template <class T>
+    bool Memory::writeWatched(uint32_t addr, T value)
+    {
+        const Page &page = watchedPages.find(pageIndex(addr))->second;
+        const uint32_t offset = addr & page.mask & ~static_cast<uint32_t>(sizeof(T) - 1);
+
+        if (memWatch.isAddressWatched(addr))
+            memWatch.addressCheckTrigger(addr, le(*reinterpret_cast<const T *>(page.read + offset)), value);
+
+        if (!(sizeof(T) == 1 ? page.byteWrites : page.write != nullptr))
+            return false;
+
+        *reinterpret_cast<T *>(page.write + offset) = le(value);
+        if (page.code && blockCache)
+            blockCache->invalidate(addr);
+        else if (page.tiles)
+            markTilesDirty(page.write + offset, sizeof(T));
+        return true;
     }
 
     Memory::~Memory()
@@ -154,494 +294,385 @@ namespace gbaemu
         delete[] wram;
         delete[] iwram;
         delete[] bg_obj_ram;
+        delete[] pages;
 
         wram = nullptr;
         iwram = nullptr;
         bg_obj_ram = nullptr;
+        pages = nullptr;
     }
 
+    /*
+        The fast paths below handle all accesses to pages mapped by the page table.
+        The region switches only handle the remaining memory: plain RAM is always mapped.
+     */
+
     uint8_t Memory::read8(uint32_t addr, InstructionExecutionInfo &execInfo, bool seq) const
     {
-
+        const Page &page = pages[pageIndex(addr)];
         execInfo.memReg = extractMemoryRegion(addr);
-        execInfo.cycleCount += memCycles16(execInfo.memReg, seq);
+        execInfo.cycleCount += page.cycles16[bmap<uint8_t>(seq)];
 
         uint8_t currValue;
 
-        switch (execInfo.memReg) {
-            case memory::WRAM:
-                // Trivial mirroring
-                currValue = wram[(addr & memory::WRAM_LIMIT) - memory::WRAM_OFFSET];
-                break;
-            case memory::IWRAM:
-                // Trivial mirroring
-                currValue = iwram[(addr & memory::IWRAM_LIMIT) - memory::IWRAM_OFFSET];
-                break;
-            case memory::IO_REGS:
-                currValue = ioHandler.externalRead8(addr);
-                break;
-            case memory::BG_OBJ_RAM:
-                // Trivial mirroring
-                currValue = bg_obj_ram[(addr & memory::BG_OBJ_RAM_LIMIT) - memory::BG_OBJ_RAM_OFFSET];
-                break;
-            case memory::VRAM:
-                currValue = vram.read8(addr);
-                break;
-            case memory::OAM:
-                // Trivial mirroring
-                currValue = oam.mem[(addr & memory::OAM_LIMIT) - memory::OAM_OFFSET];
-                break;
+        if (page.read) {
+            currValue = page.read[addr & page.mask];
+        } else if (page.watched) {
+            currValue = readWatched<uint8_t>(addr);
+        } else {
+            switch (execInfo.memReg) {
+                case memory::IO_REGS:
+                    currValue = ioHandler.externalRead8(addr);
+                    break;
 
-            case memory::EXT_ROM1:
-            case memory::EXT_ROM1_:
-            case memory::EXT_ROM2:
-            case memory::EXT_ROM2_:
-            case memory::EXT_ROM3:
-                currValue = rom.read8(addr);
-                break;
-            case memory::EXT_ROM3_:
-                currValue = rom.read8ROM3_(addr);
-                break;
-            case memory::EXT_SRAM:
-            case memory::EXT_SRAM_:
-                currValue = rom.read8SRAM(addr);
-                break;
+                case memory::EXT_ROM1:
+                case memory::EXT_ROM1_:
+                case memory::EXT_ROM2:
+                case memory::EXT_ROM2_:
+                case memory::EXT_ROM3:
+                    currValue = rom.read8(addr);
+                    break;
+                case memory::EXT_ROM3_:
+                    currValue = rom.read8ROM3_(addr);
+                    break;
+                case memory::EXT_SRAM:
+                case memory::EXT_SRAM_:
+                    currValue = rom.read8SRAM(addr);
+                    break;
 
-            case memory::BIOS:
-                if (addr < memory::BIOS_LIMIT) {
-                    currValue = bios.read8(addr);
+                case memory::BIOS:
+                    if (addr < memory::BIOS_LIMIT) {
+                        currValue = bios.read8(addr);
+                        break;
+                    }
+                    // Fall through if not in bios area, as this is unused memory!
+                default:
+                    // Unused Memory
+                    currValue = readUnusedHandle();
+                    // get the selected byte
+                    currValue >>= ((addr & 3) << 3);
                     break;
-                }
-                // Fall through if not in bios area, as this is unused memory!
-            default:
-                // Unused Memory
-                currValue = readUnusedHandle();
-                // get the selected byte
-                currValue >>= ((addr & 3) << 3);
-                break;
+            }
         }
 
-#ifdef DEBUG_CLI
-        if (memWatch.isAddressWatched(addr))
-            memWatch.addressCheckTrigger(addr, currValue);
-#endif
-
         return currValue;
     }
 
     uint16_t Memory::readInst16(uint32_t addr, InstructionExecutionInfo &execInfo)
     {
+        const Page &page = pages[pageIndex(addr)];
         execInfo.memReg = extractMemoryRegion(addr);
-        execInfo.cycleCount += memCycles16(execInfo.memReg, true);
+        execInfo.cycleCount += page.cycles16[1];
 
         uint16_t currValue;
 
-        switch (execInfo.memReg) {
-            case memory::WRAM:
-                // Trivial mirroring
-                currValue = le(*reinterpret_cast<uint16_t *>(wram + (addr & memory::WRAM_LIMIT & ~1) - memory::WRAM_OFFSET));
-                break;
-            case memory::IWRAM:
-                // Trivial mirroring
-                currValue = le(*reinterpret_cast<uint16_t *>(iwram + (addr & memory::IWRAM_LIMIT & ~1) - memory::IWRAM_OFFSET));
-                break;
-            case memory::IO_REGS:
-                currValue = ioHandler.externalRead16(addr & ~1);
-                break;
-            case memory::BG_OBJ_RAM:
-                // Trivial mirroring
-                currValue = le(*reinterpret_cast<uint16_t *>(bg_obj_ram + (addr & memory::BG_OBJ_RAM_LIMIT & ~1) - memory::BG_OBJ_RAM_OFFSET));
-                break;
-            case memory::VRAM:
-                currValue = vram.read16(addr);
-                break;
-            case memory::OAM:
-                // Trivial mirroring
-                currValue = le(*reinterpret_cast<uint16_t *>(oam.mem + (addr & memory::OAM_LIMIT & ~1) - memory::OAM_OFFSET));
-                break;
+        if (page.read) {
+            currValue = le(*reinterpret_cast<const uint16_t *>(page.read + (addr & page.mask & ~1)));
+        } else if (page.watched) {
+            currValue = readWatched<uint16_t>(addr);
+        } else {
+            switch (execInfo.memReg) {
+                case memory::IO_REGS:
+                    currValue = ioHandler.externalRead16(addr & ~1);
+                    break;
 
-            case memory::EXT_ROM1:
-            case memory::EXT_ROM1_:
-            case memory::EXT_ROM2:
-            case memory::EXT_ROM2_:
-            case memory::EXT_ROM3:
-                currValue = rom.read16(addr);
-                break;
-            case memory::EXT_ROM3_:
-                currValue = rom.read16ROM3_(addr);
-                break;
-            case memory::EXT_SRAM:
-            case memory::EXT_SRAM_:
-                currValue = rom.read16SRAM(addr);
-                break;
+                case memory::EXT_ROM1:
+                case memory::EXT_ROM1_:
+                case memory::EXT_ROM2:
+                case memory::EXT_ROM2_:
+                case memory::EXT_ROM3:
+                    currValue = rom.read16(addr);
+                    break;
+                case memory::EXT_ROM3_:
+                    currValue = rom.read16ROM3_(addr);
+                    break;
+                case memory::EXT_SRAM:
+                case memory::EXT_SRAM_:
+                    currValue = rom.read16SRAM(addr);
+                    break;
 
-            case memory::BIOS:
-                if (addr < memory::BIOS_LIMIT) {
-                    currValue = bios.read16Inst(addr);
+                case memory::BIOS:
+                    if (addr < memory::BIOS_LIMIT) {
+                        currValue = bios.read16Inst(addr);
+                        break;
+                    }
+                    // Fall through if not in bios area, as this is unused memory!
+                default:
+                    // Unused Memory
+                    currValue = readUnusedHandle();
+                    // get the selected HW
+                    currValue >>= ((addr & 2) << 3);
                     break;
-                }
-                // Fall through if not in bios area, as this is unused memory!
-            default:
-                // Unused Memory
-                currValue = readUnusedHandle();
-                // get the selected HW
-                currValue >>= ((addr & 2) << 3);
-                break;
+            }
         }
 
-#ifdef DEBUG_CLI
-        if (memWatch.isAddressWatched(addr))
-            memWatch.addressCheckTrigger(addr, currValue);
-#endif
-
         return currValue;
     }
     uint16_t Memory::readDMA16(uint32_t addr, InstructionExecutionInfo &execInfo, bool seq) const
     {
+        const Page &page = pages[pageIndex(addr)];
         execInfo.memReg = extractMemoryRegion(addr);
-        execInfo.cycleCount += memCycles16(execInfo.memReg, seq);
+        execInfo.cycleCount += page.cycles16[bmap<uint8_t>(seq)];
 
         uint16_t currValue;
 
-        switch (execInfo.memReg) {
-            case memory::WRAM:
-                // Trivial mirroring
-                currValue = le(*reinterpret_cast<uint16_t *>(wram + (addr & memory::WRAM_LIMIT & ~1) - memory::WRAM_OFFSET));
-                break;
-            case memory::IWRAM:
-                // Trivial mirroring
-                currValue = le(*reinterpret_cast<uint16_t *>(iwram + (addr & memory::IWRAM_LIMIT & ~1) - memory::IWRAM_OFFSET));
-                break;
-            case memory::IO_REGS:
-                currValue = ioHandler.externalRead16(addr & ~1);
-                break;
-            case memory::BG_OBJ_RAM:
-                // Trivial mirroring
-                currValue = le(*reinterpret_cast<uint16_t *>(bg_obj_ram + (addr & memory::BG_OBJ_RAM_LIMIT & ~1) - memory::BG_OBJ_RAM_OFFSET));
-                break;
-            case memory::VRAM:
-                currValue = vram.read16(addr);
-                break;
-            case memory::OAM:
-                // Trivial mirroring
-                currValue = le(*reinterpret_cast<uint16_t *>(oam.mem + (addr & memory::OAM_LIMIT & ~1) - memory::OAM_OFFSET));
-                break;
+        if (page.read) {
+            currValue = le(*reinterpret_cast<const uint16_t *>(page.read + (addr & page.mask & ~1)));
+        } else if (page.watched) {
+            currValue = readWatched<uint16_t>(addr);
+        } else {
+            switch (execInfo.memReg) {
+                case memory::IO_REGS:
+                    currValue = ioHandler.externalRead16(addr & ~1);
+                    break;
 
-            case memory::EXT_ROM1:
-            case memory::EXT_ROM1_:
-            case memory::EXT_ROM2:
-            case memory::EXT_ROM2_:
-            case memory::EXT_ROM3:
-                currValue = rom.read16(addr);
-                break;
-            case memory::EXT_ROM3_:
-                currValue = rom.read16ROM3_DMA(addr);
-                break;
-            case memory::EXT_SRAM:
-            case memory::EXT_SRAM_:
-                currValue = rom.read16SRAM(addr);
-                break;
+                case memory::EXT_ROM1:
+                case memory::EXT_ROM1_:
+                case memory::EXT_ROM2:
+                case memory::EXT_ROM2_:
+                case memory::EXT_ROM3:
+                    currValue = rom.read16(addr);
+                    break;
+                case memory::EXT_ROM3_:
+                    currValue = rom.read16ROM3_DMA(addr);
+                    break;
+                case memory::EXT_SRAM:
+                case memory::EXT_SRAM_:
+                    currValue = rom.read16SRAM(addr);
+                    break;
 
-            case memory::BIOS:
-                if (addr < memory::BIOS_LIMIT) {
-                    currValue = bios.read16(addr);
+                case memory::BIOS:
+                    if (addr < memory::BIOS_LIMIT) {
+                        currValue = bios.read16(addr);
+                        break;
+                    }
+                    // Fall through if not in bios area, as this is unused memory!
+                default:
+                    // Unused Memory
+                    currValue = readUnusedHandle();
+                    // get the selected HW
+                    currValue >>= ((addr & 2) << 3);
                     break;
-                }
-                // Fall through if not in bios area, as this is unused memory!
-            default:
-                // Unused Memory
-                currValue = readUnusedHandle();
-                // get the selected HW
-                currValue >>= ((addr & 2) << 3);
-                break;
+            }
         }
 
-#ifdef DEBUG_CLI
-        if (memWatch.isAddressWatched(addr))
-            memWatch.addressCheckTrigger(addr, currValue);
-#endif
-
         return currValue;
     }
     uint16_t Memory::read16(uint32_t addr, InstructionExecutionInfo &execInfo, bool seq) const
     {
+        const Page &page = pages[pageIndex(addr)];
         execInfo.memReg = extractMemoryRegion(addr);
-        execInfo.cycleCount += memCycles16(execInfo.memReg, seq);
+        execInfo.cycleCount += page.cycles16[bmap<uint8_t>(seq)];
 
         uint16_t currValue;
 
-        switch (execInfo.memReg) {
-            case memory::WRAM:
-                // Trivial mirroring
-                currValue = le(*reinterpret_cast<uint16_t *>(wram + (addr & memory::WRAM_LIMIT & ~1) - memory::WRAM_OFFSET));
-                break;
-            case memory::IWRAM:
-                // Trivial mirroring
-                currValue = le(*reinterpret_cast<uint16_t *>(iwram + (addr & memory::IWRAM_LIMIT & ~1) - memory::IWRAM_OFFSET));
-                break;
-            case memory::IO_REGS:
-                currValue = ioHandler.externalRead16(addr & ~1);
-                break;
-            case memory::BG_OBJ_RAM:
-                // Trivial mirroring
-                currValue = le(*reinterpret_cast<uint16_t *>(bg_obj_ram + (addr & memory::BG_OBJ_RAM_LIMIT & ~1) - memory::BG_OBJ_RAM_OFFSET));
-                break;
-            case memory::VRAM:
-                currValue = vram.read16(addr);
-                break;
-            case memory::OAM:
-                // Trivial mirroring
-                currValue = le(*reinterpret_cast<uint16_t *>(oam.mem + (addr & memory::OAM_LIMIT & ~1) - memory::OAM_OFFSET));
-                break;
+        if (page.read) {
+            currValue = le(*reinterpret_cast<const uint16_t *>(page.read + (addr & page.mask & ~1)));
+        } else if (page.watched) {
+            currValue = readWatched<uint16_t>(addr);
+        } else {
+            switch (execInfo.memReg) {
+                case memory::IO_REGS:
+                    currValue = ioHandler.externalRead16(addr & ~1);
+                    break;
 
-            case memory::EXT_ROM1:
-            case memory::EXT_ROM1_:
-            case memory::EXT_ROM2:
-            case memory::EXT_ROM2_:
-            case memory::EXT_ROM3:
-                currValue = rom.read16(addr);
-                break;
-            case memory::EXT_ROM3_:
-                currValue = rom.read16ROM3_(addr);
-                break;
-            case memory::EXT_SRAM:
-            case memory::EXT_SRAM_:
-                currValue = rom.read16SRAM(addr);
-                break;
+                case memory::EXT_ROM1:
+                case memory::EXT_ROM1_:
+                case memory::EXT_ROM2:
+                case memory::EXT_ROM2_:
+                case memory::EXT_ROM3:
+                    currValue = rom.read16(addr);
+                    break;
+                case memory::EXT_ROM3_:
+                    currValue = rom.read16ROM3_(addr);
+                    break;
+                case memory::EXT_SRAM:
+                case memory::EXT_SRAM_:
+                    currValue = rom.read16SRAM(addr);
+                    break;
 
-            case memory::BIOS:
-                if (addr < memory::BIOS_LIMIT) {
-                    currValue = bios.read16(addr);
+                case memory::BIOS:
+                    if (addr < memory::BIOS_LIMIT) {
+                        currValue = bios.read16(addr);
+                        break;
+                    }
+                    // Fall through if not in bios area, as this is unused memory!
+                default:
+                    // Unused Memory
+                    currValue = readUnusedHandle();
+                    // get the selected HW
+                    currValue >>= ((addr & 2) << 3);
                     break;
-                }
-                // Fall through if not in bios area, as this is unused memory!
-            default:
-                // Unused Memory
-                currValue = readUnusedHandle();
-                // get the selected HW
-                currValue >>= ((addr & 2) << 3);
-                break;
+            }
         }
 
-#ifdef DEBUG_CLI
-        if (memWatch.isAddressWatched(addr))
-            memWatch.addressCheckTrigger(addr, currValue);
-#endif
-
         return currValue;
     }
 
     // TODO i dont like this copy & paste variant... but at least it allows const correctness :/
     uint32_t Memory::readInst32(uint32_t addr, InstructionExecutionInfo &execInfo)
     {
+        const Page &page = pages[pageIndex(addr)];
         execInfo.memReg = extractMemoryRegion(addr);
-        execInfo.cycleCount += memCycles32(execInfo.memReg, true);
+        execInfo.cycleCount += page.cycles32[1];
 
         uint32_t currValue;
 
-        switch (execInfo.memReg) {
-            case memory::WRAM:
-                // Trivial mirroring
-                currValue = le(*reinterpret_cast<uint32_t *>(wram + (addr & memory::WRAM_LIMIT & ~3) - memory::WRAM_OFFSET));
-                break;
-            case memory::IWRAM:
-                // Trivial mirroring
-                currValue = le(*reinterpret_cast<uint32_t *>(iwram + (addr & memory::IWRAM_LIMIT & ~3) - memory::IWRAM_OFFSET));
-                break;
-            case memory::IO_REGS:
-                currValue = ioHandler.externalRead32(addr & ~3);
-                break;
-            case memory::BG_OBJ_RAM:
-                // Trivial mirroring
-                currValue = le(*reinterpret_cast<uint32_t *>(bg_obj_ram + (addr & memory::BG_OBJ_RAM_LIMIT & ~3) - memory::BG_OBJ_RAM_OFFSET));
-                break;
-            case memory::VRAM:
-                currValue = vram.read32(addr);
-                break;
-            case memory::OAM:
-                // Trivial mirroring
-                currValue = le(*reinterpret_cast<uint32_t *>(oam.mem + (addr & memory::OAM_LIMIT & ~3) - memory::OAM_OFFSET));
-                break;
+        if (page.read) {
+            currValue = le(*reinterpret_cast<const uint32_t *>(page.read + (addr & page.mask & ~3)));
+        } else if (page.watched) {
+            currValue = readWatched<uint32_t>(addr);
+        } else {
+            switch (execInfo.memReg) {
+                case memory::IO_REGS:
+                    currValue = ioHandler.externalRead32(addr & ~3);
+                    break;
 
-            case memory::EXT_ROM1:
-            case memory::EXT_ROM1_:
-            case memory::EXT_ROM2:
-            case memory::EXT_ROM2_:
-            case memory::EXT_ROM3:
-                currValue = rom.read32(addr);
-                break;
-            case memory::EXT_ROM3_:
-                currValue = rom.read32ROM3_(addr);
-                break;
-            case memory::EXT_SRAM:
-            case memory::EXT_SRAM_:
-                currValue = rom.read32SRAM(addr);
-                break;
+                case memory::EXT_ROM1:
+                case memory::EXT_ROM1_:
+                case memory::EXT_ROM2:
+                case memory::EXT_ROM2_:
+                case memory::EXT_ROM3:
+                    currValue = rom.read32(addr);
+                    break;
+                case memory::EXT_ROM3_:
+                    currValue = rom.read32ROM3_(addr);
+                    break;
+                case memory::EXT_SRAM:
+                case memory::EXT_SRAM_:
+                    currValue = rom.read32SRAM(addr);
+                    break;
 
-            case memory::BIOS:
-                if (addr < memory::BIOS_LIMIT) {
-                    currValue = bios.read32Inst(addr);
+                case memory::BIOS:
+                    if (addr < memory::BIOS_LIMIT) {
+                        currValue = bios.read32Inst(addr);
+                        break;
+                    }
+                    // Fall through if not in bios area, as this is unused memory!
+                default:
+                    // Unused Memory
+                    currValue = readUnusedHandle();
                     break;
-                }
-                // Fall through if not in bios area, as this is unused memory!
-            default:
-                // Unused Memory
-                currValue = readUnusedHandle();
-                break;
+            }
         }
 
-#ifdef DEBUG_CLI
-        if (memWatch.isAddressWatched(addr))
-            memWatch.addressCheckTrigger(addr, currValue);
-#endif
-
         return currValue;
     }
     uint32_t Memory::readDMA32(uint32_t addr, InstructionExecutionInfo &execInfo, bool seq) const
     {
+        const Page &page = pages[pageIndex(addr)];
         execInfo.memReg = extractMemoryRegion(addr);
-        execInfo.cycleCount += memCycles32(execInfo.memReg, seq);
+        execInfo.cycleCount += page.cycles32[bmap<uint8_t>(seq)];
 
         uint32_t currValue;
 
-        switch (execInfo.memReg) {
-            case memory::WRAM:
-                // Trivial mirroring
-                currValue = le(*reinterpret_cast<uint32_t *>(wram + (addr & memory::WRAM_LIMIT & ~3) - memory::WRAM_OFFSET));
-                break;
-            case memory::IWRAM:
-                // Trivial mirroring
-                currValue = le(*reinterpret_cast<uint32_t *>(iwram + (addr & memory::IWRAM_LIMIT & ~3) - memory::IWRAM_OFFSET));
-                break;
-            case memory::IO_REGS:
-                currValue = ioHandler.externalRead32(addr & ~3);
-                break;
-            case memory::BG_OBJ_RAM:
-                // Trivial mirroring
-                currValue = le(*reinterpret_cast<uint32_t *>(bg_obj_ram + (addr & memory::BG_OBJ_RAM_LIMIT & ~3) - memory::BG_OBJ_RAM_OFFSET));
-                break;
-            case memory::VRAM:
-                currValue = vram.read32(addr);
-                break;
-            case memory::OAM:
-                // Trivial mirroring
-                currValue = le(*reinterpret_cast<uint32_t *>(oam.mem + (addr & memory::OAM_LIMIT & ~3) - memory::OAM_OFFSET));
-                break;
+        if (page.read) {
+            currValue = le(*reinterpret_cast<const uint32_t *>(page.read + (addr & page.mask & ~3)));
+        } else if (page.watched) {
+            currValue = readWatched<uint32_t>(addr);
+        } else {
+            switch (execInfo.memReg) {
+                case memory::IO_REGS:
+                    currValue = ioHandler.externalRead32(addr & ~3);
+                    break;
 
-            case memory::EXT_ROM1:
-            case memory::EXT_ROM1_:
-            case memory::EXT_ROM2:
-            case memory::EXT_ROM2_:
-            case memory::EXT_ROM3:
-                currValue = rom.read32(addr);
-                break;
-            case memory::EXT_ROM3_:
-                currValue = rom.read32ROM3_DMA(addr);
-                break;
-            case memory::EXT_SRAM:
-            case memory::EXT_SRAM_:
-                currValue = rom.read32SRAM(addr);
-                break;
+                case memory::EXT_ROM1:
+                case memory::EXT_ROM1_:
+                case memory::EXT_ROM2:
+                case memory::EXT_ROM2_:
+                case memory::EXT_ROM3:
+                    currValue = rom.read32(addr);
+                    break;
+                case memory::EXT_ROM3_:
+                    currValue = rom.read32ROM3_DMA(addr);
+                    break;
+                case memory::EXT_SRAM:
+                case memory::EXT_SRAM_:
+                    currValue = rom.read32SRAM(addr);
+                    break;
 
-            case memory::BIOS:
-                if (addr < memory::BIOS_LIMIT) {
-                    currValue = bios.read32(addr);
+                case memory::BIOS:
+                    if (addr < memory::BIOS_LIMIT) {
+                        currValue = bios.read32(addr);
+                        break;
+                    }
+                    // Fall through if not in bios area, as this is unused memory!
+                default:
+                    // Unused Memory
+                    currValue = readUnusedHandle();
                     break;
-                }
-                // Fall through if not in bios area, as this is unused memory!
-            default:
-                // Unused Memory
-                currValue = readUnusedHandle();
-                break;
+            }
         }
 
-#ifdef DEBUG_CLI
-        if (memWatch.isAddressWatched(addr))
-            memWatch.addressCheckTrigger(addr, currValue);
-#endif
-
         return currValue;
     }
     uint32_t Memory::read32(uint32_t addr, InstructionExecutionInfo &execInfo, bool seq) const
     {
+        const Page &page = pages[pageIndex(addr)];
         execInfo.memReg = extractMemoryRegion(addr);
-        execInfo.cycleCount += memCycles32(execInfo.memReg, seq);
+        execInfo.cycleCount += page.cycles32[bmap<uint8_t>(seq)];
 
         uint32_t currValue;
 
-        switch (execInfo.memReg) {
-            case memory::WRAM:
-                // Trivial mirroring
-                currValue = le(*reinterpret_cast<uint32_t *>(wram + (addr & memory::WRAM_LIMIT & ~3) - memory::WRAM_OFFSET));
-                break;
-            case memory::IWRAM:
-                // Trivial mirroring
-                currValue = le(*reinterpret_cast<uint32_t *>(iwram + (addr & memory::IWRAM_LIMIT & ~3) - memory::IWRAM_OFFSET));
-                break;
-            case memory::IO_REGS:
-                currValue = ioHandler.externalRead32(addr & ~3);
-                break;
-            case memory::BG_OBJ_RAM:
-                // Trivial mirroring
-                currValue = le(*reinterpret_cast<uint32_t *>(bg_obj_ram + (addr & memory::BG_OBJ_RAM_LIMIT & ~3) - memory::BG_OBJ_RAM_OFFSET));
-                break;
-            case memory::VRAM:
-                currValue = vram.read32(addr);
-                break;
-            case memory::OAM:
-                // Trivial mirroring
-                currValue = le(*reinterpret_cast<uint32_t *>(oam.mem + (addr & memory::OAM_LIMIT & ~3) - memory::OAM_OFFSET));
-                break;
+        if (page.read) {
+            currValue = le(*reinterpret_cast<const uint32_t *>(page.read + (addr & page.mask & ~3)));
+        } else if (page.watched) {
+            currValue = readWatched<uint32_t>(addr);
+        } else {
+            switch (execInfo.memReg) {
+                case memory::IO_REGS:
+                    currValue = ioHandler.externalRead32(addr & ~3);
+                    break;
 
-            case memory::EXT_ROM1:
-            case memory::EXT_ROM1_:
-            case memory::EXT_ROM2:
-            case memory::EXT_ROM2_:
-            case memory::EXT_ROM3:
-                currValue = rom.read32(addr);
-                break;
-            case memory::EXT_ROM3_:
-                currValue = rom.read32ROM3_(addr);
-                break;
-            case memory::EXT_SRAM:
-            case memory::EXT_SRAM_:
-                currValue = rom.read32SRAM(addr);
-                break;
+                case memory::EXT_ROM1:
+                case memory::EXT_ROM1_:
+                case memory::EXT_ROM2:
+                case memory::EXT_ROM2_:
+                case memory::EXT_ROM3:
+                    currValue = rom.read32(addr);
+                    break;
+                case memory::EXT_ROM3_:
+                    currValue = rom.read32ROM3_(addr);
+                    break;
+                case memory::EXT_SRAM:
+                case memory::EXT_SRAM_:
+                    currValue = rom.read32SRAM(addr);
+                    break;
 
-            case memory::BIOS:
-                if (addr < memory::BIOS_LIMIT) {
-                    currValue = bios.read32(addr);
+                case memory::BIOS:
+                    if (addr < memory::BIOS_LIMIT) {
+                        currValue = bios.read32(addr);
+                        break;
+                    }
+                    // Fall through if not in bios area, as this is unused memory!
+                default:
+                    // Unused Memory
+                    currValue = readUnusedHandle();
                     break;
-                }
-                // Fall through if not in bios area, as this is unused memory!
-            default:
-                // Unused Memory
-                currValue = readUnusedHandle();
-                break;
+            }
         }
 
-#ifdef DEBUG_CLI
-        if (memWatch.isAddressWatched(addr))
-            memWatch.addressCheckTrigger(addr, currValue);
-#endif
-
         return currValue;
     }
 
     void Memory::write8(uint32_t addr, uint8_t value, InstructionExecutionInfo &execInfo, bool seq)
     {
+        const Page &page = pages[pageIndex(addr)];
         execInfo.memReg = extractMemoryRegion(addr);
-        execInfo.cycleCount += memCycles16(execInfo.memReg, seq);
+        execInfo.cycleCount += page.cycles16[bmap<uint8_t>(seq)];
+        ++writeCounter;
+
+        if (page.byteWrites) {
+            page.write[addr & page.mask] = value;
+            if (page.code && blockCache)
+                blockCache->invalidate(addr);
+            return;
+        }
+
+        if (page.watched && writeWatched<uint8_t>(addr, value))
+            return;
 
         switch (execInfo.memReg) {
-            case memory::WRAM:
-                // Trivial mirroring
-                wram[(addr & memory::WRAM_LIMIT) - memory::WRAM_OFFSET] = value;
-                break;
-            case memory::IWRAM:
-                // Trivial mirroring
-                iwram[(addr & memory::IWRAM_LIMIT) - memory::IWRAM_OFFSET] = value;
-                break;
             case memory::IO_REGS:
                 ioHandler.externalWrite8(addr, value);
                 break;
@@ -672,108 +703,120 @@ namespace gbaemu
 
     void Memory::write16(uint32_t addr, uint16_t value, InstructionExecutionInfo &execInfo, bool seq)
     {
+        const Page &page = pages[pageIndex(addr)];
         execInfo.memReg = extractMemoryRegion(addr);
-        execInfo.cycleCount += memCycles16(execInfo.memReg, seq);
-
-        switch (execInfo.memReg) {
-            case memory::WRAM:
-                // Trivial mirroring
-                *reinterpret_cast<uint16_t *>(wram + (addr & memory::WRAM_LIMIT & ~1) - memory::WRAM_OFFSET) = le(value);
-                break;
-            case memory::IWRAM:
-                // Trivial mirroring
-                *reinterpret_cast<uint16_t *>(iwram + (addr & memory::IWRAM_LIMIT & ~1) - memory::IWRAM_OFFSET) = le(value);
-                break;
-            case memory::IO_REGS:
-                ioHandler.externalWrite16(addr, value);
-                break;
-            case memory::BG_OBJ_RAM:
-                // Trivial mirroring
-                *reinterpret_cast<uint16_t *>(bg_obj_ram + (addr & memory::BG_OBJ_RAM_LIMIT & ~1) - memory::BG_OBJ_RAM_OFFSET) = le(value);
-                break;
-            case memory::VRAM:
-                vram.write16(addr, value);
-                break;
-            case memory::OAM:
-                // Trivial mirroring
-                oam.write16((addr & memory::OAM_LIMIT & ~1) - memory::OAM_OFFSET, value);
-                break;
+        execInfo.cycleCount += page.cycles16[bmap<uint8_t>(seq)];
+        ++writeCounter;
+
+        if (page.write) {
+            *reinterpret_cast<uint16_t *>(page.write + (addr & page.mask & ~1)) = le(value);
+            if (page.code && blockCache)
+                blockCache->invalidate(addr);
+            else if (page.tiles)
+                markTilesDirty(page.write + (addr & page.mask & ~1), 2);
+        } else if (!page.watched || !writeWatched<uint16_t>(addr, value)) {
+            switch (execInfo.memReg) {
+                case memory::IO_REGS:
+                    ioHandler.externalWrite16(addr, value);
+                    break;
+                case memory::OAM:
+                    // Trivial mirroring
+                    oam.write16((addr & memory::OAM_LIMIT & ~1) - memory::OAM_OFFSET, value);
+                    break;
 
-            case memory::EXT_ROM3_:
-                rom.writeROM3_(addr, value);
-                break;
-            case memory::EXT_SRAM:
-            case memory::EXT_SRAM_:
-                rom.write16SRAM(addr, value);
-                break;
+                case memory::EXT_ROM3_:
+                    rom.writeROM3_(addr, value);
+                    break;
+                case memory::EXT_SRAM:
+                case memory::EXT_SRAM_:
+                    rom.write16SRAM(addr, value);
+                    break;
 
-            default:
-                // Ignore writes
-                break;
+                default:
+                    // Ignore writes
+                    break;
+            }
         }
+    }
 
-#ifdef DEBUG_CLI
-            //TODO re-implement memWatch?
-            /*
-        if (memWatch.isAddressWatched(addr)) {
-            uint32_t currValue = le<uint16_t>(*reinterpret_cast<const uint16_t *>(dst));
-            memWatch.addressCheckTrigger(addr, currValue, value);
+    void Memory::write32(uint32_t addr, uint32_t value, InstructionExecutionInfo &execInfo, bool seq)
+    {
+        const Page &page = pages[pageIndex(addr)];
+        execInfo.memReg = extractMemoryRegion(addr);
+        execInfo.cycleCount += page.cycles32[bmap<uint8_t>(seq)];
+        ++writeCounter;
+
+        if (page.write) {
+            *reinterpret_cast<uint32_t *>(page.write + (addr & page.mask & ~3)) = le(value);
+            if (page.code && blockCache)
+                blockCache->invalidate(addr);
+            else if (page.tiles)
+                markTilesDirty(page.write + (addr & page.mask & ~3), 4);
+        } else if (!page.watched || !writeWatched<uint32_t>(addr, value)) {
+            switch (execInfo.memReg) {
+                case memory::IO_REGS:
+                    ioHandler.externalWrite32(addr, value);
+                    break;
+                case memory::OAM:
+                    // Trivial mirroring
+                    oam.write32((addr & memory::OAM_LIMIT & ~3) - memory::OAM_OFFSET, value);
+                    break;
+
+                case memory::EXT_ROM3_:
+                    rom.writeROM3_(addr, value);
+                    break;
+                case memory::EXT_SRAM:
+                case memory::EXT_SRAM_:
+                    rom.write32SRAM(addr, value);
+                    break;
+
+                default:
+                    // Ignore writes
+                    break;
+            }
         }
-        */
-#endif
     }
 
-    void Memory::write32(uint32_t addr, uint32_t value, InstructionExecutionInfo &execInfo, bool seq)
+    const uint32_t *Memory::readBurst32(uint32_t addr, uint32_t count, InstructionExecutionInfo &execInfo) const
     {
+        addr &= ~3;
+        const uint32_t lastAddr = addr + ((count - 1) << 2);
+        const Page &page = pages[pageIndex(addr)];
+        const uint32_t offset = addr & page.mask;
+
+        // the burst must neither leave the page nor wrap around a mirror
+        if (!page.read || pageIndex(lastAddr) != pageIndex(addr) || offset + (count << 2) > page.mask + 1)
+            return nullptr;
+
         execInfo.memReg = extractMemoryRegion(addr);
-        execInfo.cycleCount += memCycles32(execInfo.memReg, seq);
+        execInfo.cycleCount += count * page.cycles32[1];
 
-        switch (execInfo.memReg) {
-            case memory::WRAM:
-                // Trivial mirroring
-                *reinterpret_cast<uint32_t *>(wram + (addr & memory::WRAM_LIMIT & ~3) - memory::WRAM_OFFSET) = le(value);
-                break;
-            case memory::IWRAM:
-                // Trivial mirroring
-                *reinterpret_cast<uint32_t *>(iwram + (addr & memory::IWRAM_LIMIT & ~3) - memory::IWRAM_OFFSET) = le(value);
-                break;
-            case memory::IO_REGS:
-                ioHandler.externalWrite32(addr, value);
-                break;
-            case memory::BG_OBJ_RAM:
-                // Trivial mirroring
-                *reinterpret_cast<uint32_t *>(bg_obj_ram + (addr & memory::BG_OBJ_RAM_LIMIT & ~3) - memory::BG_OBJ_RAM_OFFSET) = le(value);
-                break;
-            case memory::VRAM:
-                vram.write32(addr, value);
-                break;
-            case memory::OAM:
-                // Trivial mirroring
-                oam.write32((addr & memory::OAM_LIMIT & ~3) - memory::OAM_OFFSET, value);
-                break;
+        return reinterpret_cast<const uint32_t *>(page.read + offset);
+    }
 
-            case memory::EXT_ROM3_:
-                rom.writeROM3_(addr, value);
-                break;
-            case memory::EXT_SRAM:
-            case memory::EXT_SRAM_:
-                rom.write32SRAM(addr, value);
-                break;
+    uint32_t *Memory::writeBurst32(uint32_t addr, uint32_t count, InstructionExecutionInfo &execInfo)
+    {
+        addr &= ~3;
+        const uint32_t lastAddr = addr + ((count - 1) << 2);
+        const Page &page = pages[pageIndex(addr)];
+        const uint32_t offset = addr & page.mask;
 
-            default:
-                // Ignore writes
-                break;
-        }
+        if (!page.write || pageIndex(lastAddr) != pageIndex(addr) || offset + (count << 2) > page.mask + 1)
+            return nullptr;
 
-#ifdef DEBUG_CLI
-            //TODO re-implement memWatch?
-            /*
-        if (memWatch.isAddressWatched(addr)) {
-            uint32_t currValue = le<uint32_t>(*reinterpret_cast<const uint32_t *>(dst));
-            memWatch.addressCheckTrigger(addr, currValue, value);
+        execInfo.memReg = extractMemoryRegion(addr);
+        execInfo.cycleCount += count * page.cycles32[1];
+        writeCounter += count;
+
+        // a burst spans at most two block cache pages
+        if (page.code && blockCache) {
+            blockCache->invalidate(addr);
+            blockCache->invalidate(lastAddr);
+        } else if (page.tiles) {
+            markTilesDirty(page.write + offset, count << 2);
         }
-        */
-#endif
+
+        return reinterpret_cast<uint32_t *>(page.write + offset);
     }
 
     memory::MemoryRegion Memory::extractMemoryRegion(uint32_t addr)
@@ -11,19 +11,18 @@
 #include "vram.hpp"
 #include <cstdint>
 #include <functional>
-#ifdef DEBUG_CLI
 #include <map>
 #include <set>
-#endif
 
 namespace gbaemu
 {
     struct InstructionExecutionInfo;
     class ROM;
+    class BlockCache;
+    class JIT;
 
     typedef uint32_t address_t;
 
-#ifdef DEBUG_CLI
     /*
         A pointer to this class can be handed to Memory, which triggers a callback
         if the condition is satisfied.
@@ -61,8 +60,12 @@ namespace gbaemu
         void addressCheckTrigger(address_t addr, uint32_t currValue, uint32_t newValue) const;
 
         std::string getWatchPointInfo() const;
+
+        const std::set<address_t> &getAddresses() const
+        {
+            return addresses;
+        }
     };
-#endif
 
     /*
     General Internal Memory
@@ -93,6 +96,9 @@ namespace gbaemu
 
     class Memory
     {
+        // translated code accesses the page table
+        friend class JIT;
+
       public:
         // the offset within bios code
         static constexpr uint32_t BIOS_IRQ_HANDLER_OFFSET = 0x18;
@@ -115,6 +121,54 @@ namespace gbaemu
         uint8_t *wram;
         uint8_t *iwram;
 
+        /*
+            Page table for the plain memory regions: every 16K page of the 28 bit address space either maps to
+            host memory or is handled by the region switch (IO, BIOS, SRAM / Flash / EEPROM, open bus, ROM pages
+            beyond the end of the ROM). Regions smaller than a page are mirrored with the page mask.
+            The access cycles are stored per page too, so the fast path needs a single table lookup.
+         */
+        static constexpr uint32_t PAGE_SHIFT = 14;
+        static constexpr uint32_t PAGE_COUNT = static_cast<uint32_t>(1) << (28 - PAGE_SHIFT);
+
+        struct Page {
+            // nullptr if reads / 16 & 32 bit writes need the slow path
+            const uint8_t *read;
+            uint8_t *write;
+            uint32_t mask;
+            // [non seq, seq]
+            uint8_t cycles16[2];
+            uint8_t cycles32[2];
+            // 8 bit writes are plain stores (not true for palette, VRAM & OAM)
+            bool byteWrites;
+            // writes have to invalidate decoded code
+            bool code;
+            // writes have to mark the VRAM tiles dirty
+            bool tiles;
+            // contains a watched address, read & write are cleared & the original entry is in watchedPages
+            bool watched;
+        };
+
+        Page *pages;
+        std::map<uint32_t, Page> watchedPages;
+
+        static uint32_t pageIndex(uint32_t addr)
+        {
+            return (addr >> PAGE_SHIFT) & (PAGE_COUNT - 1);
+        }
+
+        void updatePageTable();
+
+        template <class T>
+        T readWatched(uint32_t addr) const;
+        // Returns false if the write needs the region handling (e.g. 8 bit writes to VRAM)
+        template <class T>
+        bool writeWatched(uint32_t addr, T value);
+
+        void markTilesDirty(const uint8_t *host, uint32_t size)
+        {
+            vram.markDirty(static_cast<uint32_t>(host - vram.rawAccess()), size);
+        }
+
       public:
         uint8_t *bg_obj_ram;
 
@@ -127,10 +181,14 @@ namespace gbaemu
         // needed to handle read from unused memory regions
         const std::function<uint32_t()> readUnusedHandle;
 
-#ifdef DEBUG_CLI
-        /* We are going to expose this directly becaus this cannot be in an invalid state and I don't have time. */
+        // decoded code in WRAM & IWRAM needs to be invalidated on writes
+        BlockCache *blockCache = nullptr;
+
+        // Number of write accesses, allows to check code for side effects
+        uint32_t writeCounter = 0;
+
+        /* Watchpoints have to be added & removed with watchAddress / unwatchAddress. */
         MemWatch memWatch;
-#endif
 
         Memory(std::function<uint32_t()> readUnusedHandle);
 
@@ -146,7 +204,9 @@ namespace gbaemu
         bool loadROM(const char *saveFilePath, const uint8_t *rom, size_t romSize)
         {
             reset();
-            return this->rom.loadROM(saveFilePath, rom, romSize);
+            bool loadSuccessful = this->rom.loadROM(saveFilePath, rom, romSize);
+            updatePageTable();
+            return loadSuccessful;
         }
 
         void loadExternalBios(const uint8_t *externalBios, size_t biosSize)
@@ -187,6 +247,35 @@ namespace gbaemu
         void write16(uint32_t addr, uint16_t value, InstructionExecutionInfo &execInfo, bool seq = false);
         void write32(uint32_t addr, uint32_t value, InstructionExecutionInfo &execInfo, bool seq = false);
 
+        /*
+            Resolves a burst of count sequential word accesses starting at addr (LDM / STM) at once: if all words
+            are plain memory within a single page the host memory of the first word is returned and the cycles,
+            memory region & side effects of the whole burst are accounted for. Otherwise nullptr is returned,
+            nothing is accounted for and the words need to be accessed one by one.
+         */
+        const uint32_t *readBurst32(uint32_t addr, uint32_t count, InstructionExecutionInfo &execInfo) const;
+        uint32_t *writeBurst32(uint32_t addr, uint32_t count, InstructionExecutionInfo &execInfo);
+
+        /*
+            Watchpoints: the pages containing watched addresses are removed from the fast paths, accesses to all
+            other pages do not check anything. Only memory mapped by the page table can be watched, returns false
+            otherwise.
+         */
+        bool watchAddress(address_t addr, const MemWatch::Condition &cond);
+        void unwatchAddress(address_t addr);
+
+        /*
+            Returns the host memory backing the page of addr, nullptr if it is not plain memory.
+            The guest range [start, start + size) maps linearly to the returned pointer.
+         */
+        const uint8_t *getHostPage(uint32_t addr, uint32_t &start, uint32_t &size) const
+        {
+            const Page &page = pages[pageIndex(addr)];
+            start = addr & ~page.mask;
+            size = page.read ? page.mask + 1 : 0;
+            return page.read;
+        }
+
         uint8_t memCycles32(memory::MemoryRegion reg, bool seq) const
         {
             return cycles32Bit[bmap<uint8_t>(seq)][reg & 0xF];
@@ -55,6 +55,16 @@ namespace gbaemu
             return romSize;
         }
 
+        const uint8_t *rawAccess() const
+        {
+            return rom;
+        }
+
+        bool hasEEPROM() const
+        {
+            return eeprom != nullptr;
+        }
+
         void reset();
 
         bool loadROM(const char *saveFilePath, const uint8_t *rom, size_t romSize);
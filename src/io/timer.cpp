@@ -11,13 +11,35 @@
 
 namespace gbaemu
 {
+    template <uint8_t id>
+    static constexpr Scheduler::EventType overflowEvent()
+    {
+        return static_cast<Scheduler::EventType>(Scheduler::TIMER_0_OVERFLOW + id);
+    }
 
     template <uint8_t id>
     void TimerGroup::Timer<id>::reset()
     {
         std::fill_n(reinterpret_cast<char *>(&regs), sizeof(regs), 0);
         counter = 0;
+        counterTime = 0;
         active = false;
+        scheduler.cancel(overflowEvent<id>());
+    }
+
+    template <uint8_t id>
+    uint32_t TimerGroup::Timer<id>::currentCounter() const
+    {
+        if (active && !countUpTiming)
+            return counter + static_cast<uint32_t>(scheduler.now() - counterTime);
+
+        return counter;
+    }
+
+    template <uint8_t id>
+    void TimerGroup::Timer<id>::scheduleOverflow()
+    {
+        scheduler.schedule(overflowEvent<id>(), counterTime + (overflowVal - counter));
     }
 
     template <uint8_t id>
@@ -26,7 +48,8 @@ namespace gbaemu
         if (offset >= offsetof(TimerRegs, control))
             return *(offset + reinterpret_cast<uint8_t *>(&regs));
         else {
-            return ((counter >> preShift) >> (offset ? 8 : 0)) & 0x0FF;
+            ++timerGroup.counterReads;
+            return ((currentCounter() >> preShift) >> (offset ? 8 : 0)) & 0x0FF;
         }
     }
 
@@ -37,18 +60,23 @@ namespace gbaemu
 
         if (offset == offsetof(TimerRegs, control)) {
             bool nextActive = isBitSet<uint8_t, TIMER_START_OFFSET>(value);
+
+            if (active && !nextActive) {
+                // the counter stops at its current value
+                counter = currentCounter();
+                counterTime = scheduler.now();
+                scheduler.cancel(overflowEvent<id>());
+            }
+
             // if the active bit is set again this won't have a effect on the active flag
             // else if deactivated active will be set to false as well -> on reenable still false
             active = active && nextActive;
 
-            timerGroup.timEnableBitset = bitSet<uint8_t, 1, id>(timerGroup.timEnableBitset, bmap<uint8_t>(nextActive));
-
             if (!active && nextActive) {
                 // Update active flag
                 active = true;
                 initialize();
             }
-            timerGroup.checkRunCondition();
         }
     }
 
@@ -63,8 +91,36 @@ namespace gbaemu
     }
 
     template <uint8_t id>
-    TimerGroup::Timer<id>::Timer(InterruptHandler &irqHandler, Timer<(id < 3) ? id + 1 : id> *nextTimer, TimerGroup &timerGroup) : irqHandler(irqHandler), nextTimer(nextTimer), timerGroup(timerGroup)
+    TimerGroup::Timer<id>::Timer(InterruptHandler &irqHandler, Timer<(id < 3) ? id + 1 : id> *nextTimer, TimerGroup &timerGroup, Scheduler &scheduler) : irqHandler(irqHandler), nextTimer(nextTimer), timerGroup(timerGroup), scheduler(scheduler)
     {
+        scheduler.setHandler(overflowEvent<id>(), [this](uint64_t timestamp) {
+            onOverflowEvent(timestamp);
+        });
+    }
+
+    template <uint8_t id>
+    void TimerGroup::Timer<id>::onOverflowEvent(uint64_t timestamp)
+    {
+        PerfStats::Scope scope(&timerGroup.cpu->perfStats, PerfStats::TIMERS);
+
+        uint32_t reloadValue = (static_cast<uint32_t>(le(regs.reload)) << preShift);
+        uint32_t neededOverflowVal = overflowVal - reloadValue;
+
+        // The event may be handled a few cycles late, short periods can overflow multiple times in between
+        const uint64_t now = scheduler.now();
+        uint32_t overflowTimes = static_cast<uint32_t>((now - timestamp) / neededOverflowVal) + 1;
+
+        counter = reloadValue;
+        counterTime = timestamp + static_cast<uint64_t>(overflowTimes - 1) * neededOverflowVal;
+        scheduleOverflow();
+
+        if (irq)
+            irqHandler.setInterrupt<static_cast<InterruptHandler::InterruptType>(InterruptHandler::InterruptType::TIMER_0_OVERFLOW + id)>();
+
+        // Also inform next timer about overflow
+        if (id < 3) {
+            nextTimer->receiveOverflowOfPrevTimer(overflowTimes);
+        }
     }
 
     template <uint8_t id>
@@ -103,17 +159,22 @@ namespace gbaemu
         countUpTiming = id != 0 && (controlReg & TIMER_TIMING_MASK);
         if (countUpTiming) {
             preShift = 0;
-            // If we are in count up timing then we can safely remove ourself from the enable bitset as we only count up through other timer overflows
-            timerGroup.timEnableBitset = bitSet<uint8_t, 1, id>(timerGroup.timEnableBitset, bmap<uint8_t, false>());
         } else {
             preShift = preShifts[(controlReg & TIMER_PRESCALE_MASK)];
         }
 
         counter = static_cast<uint32_t>(le(regs.reload)) << preShift;
+        counterTime = scheduler.now();
         overflowVal = (static_cast<uint32_t>(1) << (preShift + 16));
 
         irq = controlReg & TIMER_IRQ_EN_MASK;
 
+        // Count up timers only count through overflows of the previous timer
+        if (countUpTiming)
+            scheduler.cancel(overflowEvent<id>());
+        else
+            scheduleOverflow();
+
         LOG_TIM(
             std::cout << "INFO: Enabled TIMER" << std::dec << static_cast<uint32_t>(id) << std::endl;
             std::cout << "      Prescale: /" << std::dec << (static_cast<uint32_t>(1) << preShift) << std::endl;
@@ -125,29 +186,11 @@ namespace gbaemu
             std::cout << "      Unshifted Overflow Value: 0x" << std::hex << overflowVal << std::endl;);
     }
 
-    template <uint8_t id>
-    void TimerGroup::Timer<id>::step(uint32_t cycles)
-    {
-        // Increment the timer counter and check for overflows
-        counter += cycles;
-
-        checkForOverflow();
-    }
-
-    TimerGroup::TimerGroup(CPU *cpu) : cpu(cpu), tim0(cpu->irqHandler, &tim1, *this), tim1(cpu->irqHandler, &tim2, *this), tim2(cpu->irqHandler, &tim3, *this), tim3(cpu->irqHandler, nullptr, *this)
+    TimerGroup::TimerGroup(CPU *cpu) : cpu(cpu), tim0(cpu->irqHandler, &tim1, *this, cpu->scheduler), tim1(cpu->irqHandler, &tim2, *this, cpu->scheduler), tim2(cpu->irqHandler, &tim3, *this, cpu->scheduler), tim3(cpu->irqHandler, nullptr, *this, cpu->scheduler)
     {
         reset();
     }
 
-    void TimerGroup::checkRunCondition() const
-    {
-        if (timEnableBitset) {
-            cpu->state.execState |= CPUState::EXEC_TIMER;
-        } else {
-            cpu->state.execState &= ~CPUState::EXEC_TIMER;
-        }
-    }
-
     template class TimerGroup::Timer<0>;
     template class TimerGroup::Timer<1>;
     template class TimerGroup::Timer<2>;
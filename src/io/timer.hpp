@@ -6,11 +6,14 @@
 #include "packed.h"
 #include "util.hpp"
 
+#include <cstdint>
+
 namespace gbaemu
 {
 
     class CPU;
     class InterruptHandler;
+    class Scheduler;
     struct InstructionExecutionInfo;
 
     class TimerGroup
@@ -52,8 +55,14 @@ namespace gbaemu
             Timer<(id < 3) ? id + 1 : id> *const nextTimer;
 
             TimerGroup &timerGroup;
+            Scheduler &scheduler;
 
+            /*
+                Unshifted counter value at counterTime. Timers counting cycles are not stepped: their current value
+                is derived from the elapsed cycles and their next overflow is a scheduled event.
+             */
             uint32_t counter;
+            uint64_t counterTime;
             uint32_t overflowVal;
             uint8_t preShift;
             bool active;
@@ -61,15 +70,19 @@ namespace gbaemu
             bool irq;
 
           public:
-            void step(uint32_t cycles);
-
-            Timer(InterruptHandler &irqHandler, Timer<(id < 3) ? id + 1 : id> *nextTimer, TimerGroup &timerGroup);
+            Timer(InterruptHandler &irqHandler, Timer<(id < 3) ? id + 1 : id> *nextTimer, TimerGroup &timerGroup, Scheduler &scheduler);
 
             void reset();
 
+            void onOverflowEvent(uint64_t timestamp);
+
           private:
             void initialize();
 
+            uint32_t currentCounter() const;
+
+            void scheduleOverflow();
+
             uint8_t read8FromReg(uint32_t offset);
             void write8ToReg(uint32_t offset, uint8_t value);
 
@@ -88,25 +101,13 @@ namespace gbaemu
         Timer<2> tim2;
         Timer<3> tim3;
 
-        uint8_t timEnableBitset;
+        // Reads of the counter registers, their value changes with every cycle
+        uint32_t counterReads;
 
       public:
-        void step(uint32_t cycles)
+        uint32_t getCounterReads() const
         {
-            if (cycles) {
-                /* Same optimization as in DMAGroup::step() */
-                if (timEnableBitset & 1)
-                    tim0.step(cycles);
-
-                if (timEnableBitset & 2)
-                    tim1.step(cycles);
-
-                if (timEnableBitset & 4)
-                    tim2.step(cycles);
-
-                if (timEnableBitset & 8)
-                    tim3.step(cycles);
-            }
+            return counterReads;
         }
 
         void reset()
@@ -115,13 +116,11 @@ namespace gbaemu
             tim1.reset();
             tim2.reset();
             tim3.reset();
-            timEnableBitset = 0;
+            counterReads = 0;
         }
 
         TimerGroup(CPU *cpu);
 
-        void checkRunCondition() const;
-
         friend class IO_Handler;
     };
 
@@ -9,7 +9,8 @@ namespace gbaemu
 {
     VRAM::VRAM()
     {
-        vram = new uint8_t[memory::VRAM_LIMIT - memory::VRAM_OFFSET + 1];
+        vram = new uint8_t[SIZE];
+        markAllDirty();
     }
 
     VRAM::~VRAM()
@@ -20,7 +21,13 @@ namespace gbaemu
 
     void VRAM::reset()
     {
-        std::fill_n(vram, memory::VRAM_LIMIT - memory::VRAM_OFFSET + 1, 0);
+        std::fill_n(vram, SIZE, 0);
+        markAllDirty();
+    }
+
+    void VRAM::markAllDirty()
+    {
+        std::fill_n(dirty, DIRTY_BLOCK_COUNT / 64, ~static_cast<uint64_t>(0));
     }
 
     uint32_t VRAM::handleMirroring(uint32_t addr)
@@ -77,6 +84,7 @@ namespace gbaemu
             addr -= memory::VRAM_OFFSET;
             // As both bytes are the same we do not need an le() call
             *reinterpret_cast<uint16_t *>(vram + addr) = (static_cast<uint16_t>(value) << 8) | value;
+            markDirty(addr);
         }
         // Else ignored
     }
@@ -85,10 +93,12 @@ namespace gbaemu
     {
         addr = (handleMirroring(addr) & ~1) - memory::VRAM_OFFSET;
         *reinterpret_cast<uint16_t *>(vram + addr) = le(value);
+        markDirty(addr);
     }
     void VRAM::write32(uint32_t addr, uint32_t value)
     {
         addr = (handleMirroring(addr) & ~3) - memory::VRAM_OFFSET;
         *reinterpret_cast<uint32_t *>(vram + addr) = le(value);
+        markDirty(addr);
     }
 } // namespace gbaemu
@@ -1,14 +1,27 @@
 #ifndef VRAM_HPP
 #define VRAM_HPP
 
+#include "memory_defs.hpp"
+
 #include <cstdint>
 
 namespace gbaemu
 {
     class VRAM
     {
+      public:
+        static constexpr uint32_t SIZE = memory::VRAM_LIMIT - memory::VRAM_OFFSET + 1;
+        /*
+            Every write marks the 32 byte block (one 4 bit tile, half of an 8 bit tile) it hits as dirty, so decoded
+            copies of the tiles (lcd::TileCache) only need to be rebuilt after changes. Writes through the page table
+            of Memory bypass write8/16/32 & have to call markDirty themselves.
+         */
+        static constexpr uint32_t DIRTY_BLOCK_SHIFT = 5;
+        static constexpr uint32_t DIRTY_BLOCK_COUNT = SIZE >> DIRTY_BLOCK_SHIFT;
+
       private:
         uint8_t *vram;
+        uint64_t dirty[DIRTY_BLOCK_COUNT / 64];
 
       public:
         VRAM();
@@ -28,8 +41,31 @@ namespace gbaemu
         void write16(uint32_t addr, uint16_t value);
         void write32(uint32_t addr, uint32_t value);
 
-        private:
-          static uint32_t handleMirroring(uint32_t addr);
+        static uint32_t handleMirroring(uint32_t addr);
+
+        // offset is relative to the start of VRAM
+        void markDirty(uint32_t offset)
+        {
+            const uint32_t block = offset >> DIRTY_BLOCK_SHIFT;
+            dirty[block >> 6] |= static_cast<uint64_t>(1) << (block & 63);
+        }
+
+        void markDirty(uint32_t offset, uint32_t size)
+        {
+            for (uint32_t block = offset >> DIRTY_BLOCK_SHIFT; block <= (offset + size - 1) >> DIRTY_BLOCK_SHIFT; ++block)
+                dirty[block >> 6] |= static_cast<uint64_t>(1) << (block & 63);
+        }
+
+        void markAllDirty();
+
+        // Returns whether the block was written since the last call
+        bool testAndClearDirty(uint32_t block)
+        {
+            const uint64_t bit = static_cast<uint64_t>(1) << (block & 63);
+            const bool wasDirty = dirty[block >> 6] & bit;
+            dirty[block >> 6] &= ~bit;
+            return wasDirty;
+        }
     };
 } // namespace gbaemu
 
@@ -1,6 +1,7 @@
 #include "bglayer.hpp"
 
 #include "logging.hpp"
+#include <algorithm>
 #include <sstream>
 
 namespace gbaemu::lcd
@@ -13,7 +14,7 @@ namespace gbaemu::lcd
         vFlip = isBitSet<uint16_t, 11>(entry);
     }
 
-    BGLayer::BGLayer(LCDColorPalette &plt, Memory &mem, BGIndex idx) : Layer(static_cast<LayerID>(idx), true), index(idx), palette(plt), memory(mem)
+    BGLayer::BGLayer(LCDColorPalette &plt, Memory &mem, TileCache &cache, BGIndex idx) : Layer(static_cast<LayerID>(idx), true), index(idx), palette(plt), memory(mem), tileCache(cache)
     {
     }
 
@@ -40,7 +41,7 @@ namespace gbaemu::lcd
             /* text mode */
             height = (size <= 1) ? 256 : 512;
             width = (size % 2 == 0) ? 256 : 512;
-        } else if (bgMode == 2 || (bgMode == 1 && index == BG2)) {
+        } else if (bgMode == 2 || (bgMode == 1 && index >= BG2)) {
             switch (size) {
                 case 0:
                     width = 128;
@@ -114,40 +115,40 @@ namespace gbaemu::lcd
 
             const auto rotScalParams = index == BG2 ? regs.BG2P : regs.BG3P;
 
-            affineTransform.d[0] = fixedToFloat<uint16_t, 8, 7>(le(rotScalParams[0]));
-            affineTransform.dm[0] = fixedToFloat<uint16_t, 8, 7>(le(rotScalParams[1]));
-            affineTransform.d[1] = fixedToFloat<uint16_t, 8, 7>(le(rotScalParams[2]));
-            affineTransform.dm[1] = fixedToFloat<uint16_t, 8, 7>(le(rotScalParams[3]));
+            affineTransform.d[0] = signExt<int32_t, uint16_t, 16>(le(rotScalParams[0]));
+            affineTransform.dm[0] = signExt<int32_t, uint16_t, 16>(le(rotScalParams[1]));
+            affineTransform.d[1] = signExt<int32_t, uint16_t, 16>(le(rotScalParams[2]));
+            affineTransform.dm[1] = signExt<int32_t, uint16_t, 16>(le(rotScalParams[3]));
 
             if (index == BG2) {
-                affineTransform.origin[0] = fixedToFloat<uint32_t, 8, 19>(le(regs.BG2X));
-                affineTransform.origin[1] = fixedToFloat<uint32_t, 8, 19>(le(regs.BG2Y));
+                affineTransform.origin[0] = signExt<int32_t, uint32_t, 28>(le(regs.BG2X));
+                affineTransform.origin[1] = signExt<int32_t, uint32_t, 28>(le(regs.BG2Y));
             } else {
-                affineTransform.origin[0] = fixedToFloat<uint32_t, 8, 19>(le(regs.BG3X));
-                affineTransform.origin[1] = fixedToFloat<uint32_t, 8, 19>(le(regs.BG3Y));
+                affineTransform.origin[0] = signExt<int32_t, uint32_t, 28>(le(regs.BG3X));
+                affineTransform.origin[1] = signExt<int32_t, uint32_t, 28>(le(regs.BG3Y));
             }
 
             if (affineTransform.d[0] == 0 && affineTransform.d[1] == 0) {
-                affineTransform.d[0] = 1;
+                affineTransform.d[0] = 0x100;
                 affineTransform.d[1] = 0;
             }
 
             if (affineTransform.dm[0] == 0 && affineTransform.dm[1] == 0) {
                 affineTransform.dm[0] = 0;
-                affineTransform.dm[1] = 1;
+                affineTransform.dm[1] = 0x100;
             }
         } else {
             useTrans = false;
             wrap = true;
 
             /* use scrolling parameters */
-            affineTransform.origin[0] = static_cast<common::math::real_t>(le(regs.BGOFS[index].h) & 0x1FF);
-            affineTransform.origin[1] = static_cast<common::math::real_t>(le(regs.BGOFS[index].v) & 0x1FF);
+            affineTransform.origin[0] = static_cast<int32_t>(le(regs.BGOFS[index].h) & 0x1FF) << 8;
+            affineTransform.origin[1] = static_cast<int32_t>(le(regs.BGOFS[index].v) & 0x1FF) << 8;
 
-            affineTransform.d[0] = 1;
+            affineTransform.d[0] = 0x100;
             affineTransform.d[1] = 0;
             affineTransform.dm[0] = 0;
-            affineTransform.dm[1] = 1;
+            affineTransform.dm[1] = 0x100;
         }
 
         /* 32x32 tiles, arrangement depends on resolution */
@@ -300,14 +301,146 @@ namespace gbaemu::lcd
         return std::function<color_t(int32_t, int32_t)>();
     }
 
+    template <bool colorPalette256, bool hFlip>
+    void BGLayer::drawTileRow(Fragment *out, const uint8_t *row, uint32_t paletteNumber, int32_t first, int32_t count) const
+    {
+        for (int32_t i = 0; i < count; ++i) {
+            const int32_t tx = hFlip ? (7 - (first + i)) : (first + i);
+            const color_t color = colorPalette256 ? palette.getBgColor(row[tx]) : palette.getBgColor(paletteNumber, row[tx]);
+
+            out[i] = Fragment(color, asFirstTarget, asSecondTarget, false);
+        }
+    }
+
+    template <bool colorPalette256, bool mosaic>
+    void BGLayer::drawTextScanline(int32_t y)
+    {
+        /* text backgrounds are only scrolled, width & height are 256 or 512 */
+        const int32_t sy = fastMod<int32_t>((affineTransform.origin[1] >> 8) + y, height);
+        const int32_t msy = mosaic ? (sy - (sy % mosaicHeight)) : sy;
+        const int32_t tileRowOffset = ((msy & 255) >> 3) << 5;
+        const int32_t rowInTile = msy & 7;
+        const int32_t xMask = static_cast<int32_t>(width) - 1;
+
+        /* 8 bit tiles are read from VRAM, 4 bit tiles from the tile cache, both have 8 indices per row */
+        constexpr uint32_t tileShift = colorPalette256 ? 6 : 5;
+        const uint32_t tilesOffset = static_cast<uint32_t>(tiles - memory.vram.rawAccess());
+        const auto tileRow = [this, tilesOffset](uint32_t tileNumber, int32_t ty) -> const uint8_t * {
+            if (colorPalette256)
+                return tiles + (tileNumber << tileShift) + (ty << 3);
+            else
+                return tileCache.tile4bpp(tilesOffset + (tileNumber << tileShift)) + (ty << 3);
+        };
+
+        Fragment *out = scanline.data();
+        int32_t sx = (affineTransform.origin[0] >> 8) & xMask;
+
+        if (!mosaic) {
+            for (int32_t x = 0; x < static_cast<int32_t>(SCREEN_WIDTH);) {
+                const BGMode0Entry *bgMap = reinterpret_cast<const BGMode0Entry *>(getBGMap(sx, sy));
+                const BGMode0EntryAttributes attrs(le(bgMap[tileRowOffset + ((sx & 255) >> 3)]));
+
+                const int32_t first = sx & 7;
+                const int32_t count = std::min<int32_t>(8 - first, static_cast<int32_t>(SCREEN_WIDTH) - x);
+                const int32_t ty = attrs.vFlip ? (7 - rowInTile) : rowInTile;
+                const uint8_t *row = tileRow(attrs.tileNumber, ty);
+
+                if (attrs.hFlip)
+                    drawTileRow<colorPalette256, true>(out + x, row, attrs.paletteNumber, first, count);
+                else
+                    drawTileRow<colorPalette256, false>(out + x, row, attrs.paletteNumber, first, count);
+
+                x += count;
+                sx = (sx + count) & xMask;
+            }
+        } else {
+            /* the block of pixels a mosaic repeats may start in the previous tile, so decode only when the tile changes */
+            const BGMode0Entry *lastEntry = nullptr;
+            const uint8_t *row = nullptr;
+            bool hFlip = false;
+            uint32_t paletteNumber = 0;
+
+            for (int32_t x = 0; x < static_cast<int32_t>(SCREEN_WIDTH); ++x, sx = (sx + 1) & xMask) {
+                const int32_t msx = sx - (sx % mosaicWidth);
+                const BGMode0Entry *entry = reinterpret_cast<const BGMode0Entry *>(getBGMap(sx, sy)) + tileRowOffset + ((msx & 255) >> 3);
+
+                if (entry != lastEntry) {
+                    const BGMode0EntryAttributes attrs(le(*entry));
+                    const int32_t ty = attrs.vFlip ? (7 - rowInTile) : rowInTile;
+
+                    row = tileRow(attrs.tileNumber, ty);
+                    hFlip = attrs.hFlip;
+                    paletteNumber = attrs.paletteNumber;
+                    lastEntry = entry;
+                }
+
+                if (hFlip)
+                    drawTileRow<colorPalette256, true>(out + x, row, paletteNumber, msx & 7, 1);
+                else
+                    drawTileRow<colorPalette256, false>(out + x, row, paletteNumber, msx & 7, 1);
+            }
+        }
+    }
+
+    template <bool wrap>
+    void BGLayer::drawAffineScanline()
+    {
+        const uint8_t *bgMap = bgMapBase;
+        const int32_t tilesPerRow = static_cast<int32_t>(width) >> 3;
+        const int32_t xMask = static_cast<int32_t>(width) - 1;
+        const int32_t yMask = static_cast<int32_t>(height) - 1;
+        const int32_t dx = affineTransform.d[0];
+        const int32_t dy = affineTransform.d[1];
+        int32_t refX = affineTransform.origin[0];
+        int32_t refY = affineTransform.origin[1];
+
+        for (int32_t x = 0; x < static_cast<int32_t>(SCREEN_WIDTH); ++x, refX += dx, refY += dy) {
+            /* arithmetic shifts round towards -inf like the hardware */
+            int32_t sx = refX >> 8;
+            int32_t sy = refY >> 8;
+
+            if (wrap) {
+                sx &= xMask;
+                sy &= yMask;
+            } else if (static_cast<uint32_t>(sx) >= width || static_cast<uint32_t>(sy) >= height) {
+                scanline[x] = Fragment(TRANSPARENT, asFirstTarget, asSecondTarget, false);
+                continue;
+            }
+
+            if (mosaicEnabled) {
+                sx -= sx % mosaicWidth;
+                sy -= sy % mosaicHeight;
+            }
+
+            const uint32_t tileNumber = bgMap[(sy >> 3) * tilesPerRow + (sx >> 3)];
+            const uint32_t paletteIndex = tiles[(tileNumber << 6) + ((sy & 7) << 3) + (sx & 7)];
+
+            scanline[x] = Fragment(palette.getBgColor(paletteIndex), asFirstTarget, asSecondTarget, false);
+        }
+    }
+
     void BGLayer::drawScanline(int32_t y)
     {
+        if (mode == Mode0) {
+            if (colorPalette256)
+                mosaicEnabled ? drawTextScanline<true, true>(y) : drawTextScanline<true, false>(y);
+            else
+                mosaicEnabled ? drawTextScanline<false, true>(y) : drawTextScanline<false, false>(y);
+            return;
+        }
+
+        if (mode == Mode2) {
+            wrap ? drawAffineScanline<true>() : drawAffineScanline<false>();
+            return;
+        }
+
+        /* bitmap modes */
         auto pixelColor = getPixelColorFunction();
-        vec2 s = affineTransform.origin + (useTrans ? vec2{0, 0} : affineTransform.dm * y);
+        ivec2 s = affineTransform.origin + (useTrans ? ivec2{0, 0} : affineTransform.dm * y);
 
         for (int32_t x = 0; x < static_cast<int32_t>(SCREEN_WIDTH); ++x) {
-            int32_t sx = static_cast<int32_t>(s[0]);
-            int32_t sy = static_cast<int32_t>(s[1]);
+            int32_t sx = s[0] >> 8;
+            int32_t sy = s[1] >> 8;
 
             if (wrap || (0 <= sx && sx < static_cast<int32_t>(width) && 0 <= sy && sy < static_cast<int32_t>(height))) {
                 if (wrap) {
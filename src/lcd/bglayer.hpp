@@ -3,6 +3,7 @@
 
 #include <io/memory.hpp>
 #include <lcd/palette.hpp>
+#include <lcd/tile-cache.hpp>
 
 #include <memory>
 
@@ -15,10 +16,14 @@ namespace gbaemu::lcd
         BG3
     };
 
+    /*
+        Everything in the signed fixed point formats of the hardware: d (PA, PC) & dm (PB, PD) are 8.8, origin is the
+        20.8 internal reference point of the current scanline. The texel of a pixel is its coordinate >> 8.
+     */
     struct BGAffineTransform {
-        vec2 d;
-        vec2 dm;
-        vec2 origin;
+        ivec2 d;
+        ivec2 dm;
+        ivec2 origin;
     };
 
     typedef uint16_t BGMode0Entry;
@@ -33,6 +38,26 @@ namespace gbaemu::lcd
 
     class BGLayer : public Layer
     {
+      private:
+        /*
+            Text mode backgrounds are drawn one tile at a time: the map entry is decoded once per tile & the pixels of
+            the tile row are written by drawTileRow, which exists for every color depth & horizontal flip. The rows are
+            palette indices, 4 bit tiles come decoded from the tile cache.
+            Text backgrounds always wrap, the coordinates are simply masked.
+         */
+        template <bool colorPalette256, bool mosaic>
+        void drawTextScanline(int32_t y);
+
+        template <bool colorPalette256, bool hFlip>
+        void drawTileRow(Fragment *out, const uint8_t *row, uint32_t paletteNumber, int32_t first, int32_t count) const;
+
+        /*
+            Affine tile backgrounds step the reference point by (PA, PC) per pixel like the hardware does, the map &
+            the tiles are read directly. Their size is a power of 2, wrapping masks the coordinates.
+         */
+        template <bool wrap>
+        void drawAffineScanline();
+
       public:
         const BGIndex index;
         /* settings */
@@ -53,10 +78,11 @@ namespace gbaemu::lcd
         BGMode mode;
         LCDColorPalette &palette;
         Memory &memory;
+        TileCache &tileCache;
         uint16_t size;
         BGAffineTransform affineTransform;
 
-        BGLayer(LCDColorPalette &plt, Memory &mem, BGIndex idx);
+        BGLayer(LCDColorPalette &plt, Memory &mem, TileCache &cache, BGIndex idx);
         ~BGLayer() {}
         void loadSettings(BGMode bgMode, const LCDIORegs &regs);
         std::string toString() const;
@@ -78,6 +78,7 @@ namespace gbaemu::lcd
     typedef uint16_t color16_t;
     typedef common::math::real_t real_t;
     typedef common::math::vec<2> vec2;
+    typedef common::math::vect<2, int32_t> ivec2;
     typedef common::math::vec<3> vec3;
     typedef common::math::mat<3, 3> mat3x3;
 
@@ -137,10 +137,48 @@ namespace gbaemu::lcd
         scanline.vblanking = false;
         scanline.hblanking = false;
     }
+
+    void LCDController::onHDrawEnd(uint64_t timestamp)
+    {
+        drawScanline();
+        onHBlank();
+        dmaGroup.triggerCondition(DMAGroup::StartCondition::WAIT_HBLANK);
+
+        scheduler.schedule(Scheduler::LCD_SCANLINE_END, timestamp + HBLANK_CYCLES);
+    }
+
+    void LCDController::onScanlineEnd(uint64_t timestamp)
+    {
+        /*
+            [ 960 cycles for 240 dots ][ 272 cycles for hblank ]
+            ...
+            [ 960 cycles for 240 dots ][ 272 cycles for hblank ]
+            [ 68 * 1232 cycles for vblank (no hblank) ]
+         */
+        onVCount();
+
+        if (scanline.vCount == SCREEN_HEIGHT) {
+            onVBlank();
+            dmaGroup.triggerCondition(DMAGroup::StartCondition::WAIT_VBLANK);
+            scheduler.schedule(Scheduler::LCD_SCANLINE_END, timestamp + SCANLINE_CYCLES);
+        } else if (scanline.vCount == 0) {
+            // frame is complete
+            clearBlankFlags();
+            present();
+            scheduler.requestStop();
+            scheduler.schedule(Scheduler::LCD_HDRAW_END, timestamp + HDRAW_CYCLES);
+        } else if (scanline.vCount > SCREEN_HEIGHT) {
+            scheduler.schedule(Scheduler::LCD_SCANLINE_END, timestamp + SCANLINE_CYCLES);
+        } else {
+            scheduler.schedule(Scheduler::LCD_HDRAW_END, timestamp + HDRAW_CYCLES);
+        }
+    }
 #endif
 
     void LCDController::drawScanline()
     {
+        PerfStats::Scope scope(&perfStats, PerfStats::RENDER);
+
         /* If this bit is set, white lines are displayed. */
         if (le(regs.DISPCNT) & DISPCTL::FORCED_BLANK_MASK) {
             color_t *outBuf = frameBuffer.pixels() + scanline.y * frameBuffer.getWidth();
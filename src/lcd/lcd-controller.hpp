@@ -53,9 +53,11 @@ namespace gbaemu::lcd
         Canvas<color_t> &frameBuffer;
         Memory &memory;
         InterruptHandler &irqHandler;
-#ifdef LEGACY_RENDERING
         DMAGroup &dmaGroup;
+#ifndef LEGACY_RENDERING
+        Scheduler &scheduler;
 #endif
+        PerfStats &perfStats;
 
         Renderer renderer;
 
@@ -116,6 +118,14 @@ namespace gbaemu::lcd
 
 #ifndef LEGACY_RENDERING
         void clearBlankFlags();
+
+        static constexpr uint32_t HDRAW_CYCLES = 960;
+        static constexpr uint32_t HBLANK_CYCLES = 272;
+        static constexpr uint32_t SCANLINE_CYCLES = HDRAW_CYCLES + HBLANK_CYCLES;
+
+        /* scheduler events */
+        void onHDrawEnd(uint64_t timestamp);
+        void onScanlineEnd(uint64_t timestamp);
 #else
         void renderTick();
 #endif
@@ -133,12 +143,20 @@ namespace gbaemu::lcd
       public:
         LCDController(Canvas<color_t> &disp, CPU *cpu) : frameBuffer(disp),
                                                          memory(cpu->state.memory), irqHandler(cpu->irqHandler),
-#ifdef LEGACY_RENDERING
                                                          dmaGroup(cpu->dmaGroup),
+#ifndef LEGACY_RENDERING
+                                                         scheduler(cpu->scheduler),
 #endif
-                                                         renderer(cpu->state.memory, cpu->irqHandler, internalRegs, frameBuffer)
+                                                         perfStats(cpu->perfStats),
+                                                         renderer(cpu->state.memory, cpu->irqHandler, internalRegs, frameBuffer, cpu->perfStats)
         {
             scanline.buf.resize(SCREEN_WIDTH);
+
+#ifndef LEGACY_RENDERING
+            scheduler.setHandler(Scheduler::LCD_HDRAW_END, [this](uint64_t timestamp) { onHDrawEnd(timestamp); });
+            scheduler.setHandler(Scheduler::LCD_SCANLINE_END, [this](uint64_t timestamp) { onScanlineEnd(timestamp); });
+            scheduler.schedule(Scheduler::LCD_HDRAW_END, scheduler.now() + HDRAW_CYCLES);
+#endif
         }
 
         bool canAccessPPUMemory(bool isOAMRegion = false) const;
@@ -13,7 +13,7 @@ namespace gbaemu::lcd {
         return OBJAttribute{le(uints[0]), le(uints[1]), le(uints[2])};
     }
 
-    std::tuple<common::math::vec<2>, common::math::vec<2>> OBJ::getRotScaleParameters(const uint8_t *attributes, uint32_t index)
+    std::tuple<ivec2, ivec2> OBJ::getRotScaleParameters(const uint8_t *attributes, uint32_t index)
     {
         const uint16_t *uints = reinterpret_cast<const uint16_t *>(attributes);
         uint32_t group = index * 4 * 4;
@@ -23,30 +23,11 @@ namespace gbaemu::lcd {
         uint16_t b = le(uints[group + 4 + 3]);
         uint16_t d = le(uints[group + 12 + 3]);
 
-        return std::make_tuple<common::math::vec<2>, common::math::vec<2>>(
-            common::math::vec<2>{
-                fixedToFloat<uint16_t, 8, 7, common::math::real_t>(a),
-                fixedToFloat<uint16_t, 8, 7, common::math::real_t>(c)},
-            common::math::vec<2>{
-                fixedToFloat<uint16_t, 8, 7, common::math::real_t>(b),
-                fixedToFloat<uint16_t, 8, 7, common::math::real_t>(d)});
-    }
-
-    std::tuple<common::math::vect<2, int32_t>, common::math::vect<2, int32_t>> OBJ::getRotScaleParametersI(const uint8_t *attributes, uint32_t index)
-    {
-        const uint16_t *uints = reinterpret_cast<const uint16_t *>(attributes);
-        uint32_t group = index * 4 * 4;
-
-        uint16_t a = le(uints[group + 3]);
-        uint16_t c = le(uints[group + 8 + 3]);
-        uint16_t b = le(uints[group + 4 + 3]);
-        uint16_t d = le(uints[group + 12 + 3]);
-
-        return std::make_tuple<common::math::vect<2, int32_t>, common::math::vect<2, int32_t>>(
-            common::math::vect<2, int32_t>{
+        return std::make_tuple<ivec2, ivec2>(
+            ivec2{
                 signExt<int32_t, uint16_t, 16>(a),
                 signExt<int32_t, uint16_t, 16>(c)},
-            common::math::vect<2, int32_t>{
+            ivec2{
                 signExt<int32_t, uint16_t, 16>(b),
                 signExt<int32_t, uint16_t, 16>(d)});
     }
@@ -171,10 +152,10 @@ namespace gbaemu::lcd {
             affineTransform.d = std::get<0>(result);
             affineTransform.dm = std::get<1>(result);
         } else {
-            affineTransform.d[0] = 1;
+            affineTransform.d[0] = 0x100;
             affineTransform.d[1] = 0;
             affineTransform.dm[0] = 0;
-            affineTransform.dm[1] = 1;
+            affineTransform.dm[1] = 0x100;
         }
 
         //assert(affineTransform.d[0] != 0 || affineTransform.d[1] != 0);
@@ -191,18 +172,18 @@ namespace gbaemu::lcd {
         }
          */
 
-        affineTransform.origin[0] = static_cast<common::math::real_t>(width) / 2;
-        affineTransform.origin[1] = static_cast<common::math::real_t>(height) / 2;
+        affineTransform.origin[0] = static_cast<int32_t>(width / 2) << 8;
+        affineTransform.origin[1] = static_cast<int32_t>(height / 2) << 8;
 
         if (yOff + height * (doubleSized ? 2 : 1) > 256)
             yOff -= 256;
 
         if (doubleSized) {
-            affineTransform.screenRef[0] = static_cast<common::math::real_t>(xOff + static_cast<int32_t>(width));
-            affineTransform.screenRef[1] = static_cast<common::math::real_t>(yOff + static_cast<int32_t>(height));
+            affineTransform.screenRef[0] = xOff + static_cast<int32_t>(width);
+            affineTransform.screenRef[1] = yOff + static_cast<int32_t>(height);
         } else {
-            affineTransform.screenRef[0] = static_cast<common::math::real_t>(xOff + static_cast<int32_t>(width) / 2);
-            affineTransform.screenRef[1] = static_cast<common::math::real_t>(yOff + static_cast<int32_t>(height) / 2);
+            affineTransform.screenRef[0] = xOff + static_cast<int32_t>(width) / 2;
+            affineTransform.screenRef[1] = yOff + static_cast<int32_t>(height) / 2;
         }
 
         visible = true;
@@ -231,7 +212,7 @@ namespace gbaemu::lcd {
         return ss.str();
     }
 
-    color_t OBJ::pixelColor(int32_t sx, int32_t sy, const uint8_t *objTiles, const LCDColorPalette &palette, bool use2dMapping) const
+    color_t OBJ::pixelColor(int32_t sx, int32_t sy, const uint8_t *objTiles, uint32_t objTilesOffset, TileCache &tileCache, const LCDColorPalette &palette, bool use2dMapping) const
     {
         /* calculating index */
         const int32_t tileX = sx / 8;
@@ -242,51 +223,47 @@ namespace gbaemu::lcd {
 
         const uint32_t tileIndex = use2dMapping ? (tileNumber + flippedTileX + flippedTileY * tilesPerRow) : (tileNumber + flippedTileX + flippedTileY * (width / 8));
 
-        /* finding the actual tile */
-        const uint8_t *tile = objTiles + tileIndex * bytesPerTile;
         const int32_t tx = hFlip ? (7 - (sx % 8)) : (sx % 8);
         const int32_t ty = vFlip ? (7 - (sy % 8)) : (sy % 8);
 
         if (useColor256) {
+            const uint8_t *tile = objTiles + tileIndex * bytesPerTile;
             uint32_t paletteIndex = tile[ty * 8 + tx];
             return (mode == OBJ_WINDOW) ? (paletteIndex == 0 ? TRANSPARENT : BLACK) : palette.getObjColor(paletteIndex);
         } else {
-            uint32_t row = reinterpret_cast<const uint32_t *>(tile)[ty];
-            uint32_t paletteIndex = (row >> (tx * 4)) & 0xF;
+            const uint8_t *tile = tileCache.tile4bpp(objTilesOffset + tileIndex * bytesPerTile);
+            uint32_t paletteIndex = tile[ty * 8 + tx];
             return (mode == OBJ_WINDOW) ? (paletteIndex == 0 ? TRANSPARENT : BLACK) : palette.getObjColor(paletteNumber, paletteIndex);
         }
     }
 
-    bool OBJ::intersectsWithScanline(real_t fy) const
+    bool OBJ::intersectsWithScanline(int32_t y) const
     {
         /* check for screen rect */
-        if (fy < rect.top || fy >= rect.bottom)
+        if (y < rect.top || y >= rect.bottom)
             return false;
 
-        const vec2 temp = affineTransform.dm * (fy - affineTransform.screenRef[1]) + affineTransform.origin;
-
-        //const vec2 s0 = affineTransform.d * (0 - affineTransform.screenRef[0]) + temp;
-        //const vec2 s1 = affineTransform.d * (SCREEN_WIDTH - 1 - affineTransform.screenRef[0]) + temp;
-
-        const vec2 s0 = affineTransform.d * (0 - affineTransform.screenRef[0]) +
-                        affineTransform.dm * (fy - affineTransform.screenRef[1]) +
-                        affineTransform.origin;
-        const vec2 s1 = affineTransform.d * (SCREEN_WIDTH - 1 - affineTransform.screenRef[0]) +
-                        affineTransform.dm * (fy - affineTransform.screenRef[1]) +
-                        affineTransform.origin;
-
-        const vec2 d = s1 - s0;
-        const vec2 ortho{d[1], -d[0]};
-
-        /* we give a single pixel margin */
-        const real_t dots[] = {
-            (vec2{-1, -1} - s0).dot(ortho),
-            (vec2{static_cast<real_t>(width), -1} - s0).dot(ortho),
-            (vec2{-1, static_cast<real_t>(height)} - s0).dot(ortho),
-            (vec2{static_cast<real_t>(width), static_cast<real_t>(height)} - s0).dot(ortho)};
-
-        const bool negDot = std::any_of(dots, dots + 4, [](real_t r) { return r <= 0; });
-        const bool posDot = std::any_of(dots, dots + 4, [](real_t r) { return r >= 0; });
+        /* texture coordinates (8.8) of the first & the last pixel of the scanline */
+        const ivec2 s0 = affineTransform.d * (0 - affineTransform.screenRef[0]) +
+                         affineTransform.dm * (y - affineTransform.screenRef[1]) +
+                         affineTransform.origin;
+        const ivec2 d = affineTransform.d * static_cast<int32_t>(SCREEN_WIDTH - 1);
+
+        /* we give a single pixel margin, the products need 64 bits */
+        const int64_t ortho[] = {d[1], -static_cast<int64_t>(d[0])};
+        const int32_t corners[][2] = {
+            {-0x100, -0x100},
+            {static_cast<int32_t>(width) << 8, -0x100},
+            {-0x100, static_cast<int32_t>(height) << 8},
+            {static_cast<int32_t>(width) << 8, static_cast<int32_t>(height) << 8}};
+
+        bool negDot = false;
+        bool posDot = false;
+        for (const auto &corner : corners) {
+            const int64_t dot = (corner[0] - s0[0]) * ortho[0] + (corner[1] - s0[1]) * ortho[1];
+            negDot |= dot <= 0;
+            posDot |= dot >= 0;
+        }
 
         return negDot && posDot;
     }
@@ -5,6 +5,7 @@
 
 #include "defs.hpp"
 #include "palette.hpp"
+#include "tile-cache.hpp"
 
 namespace gbaemu::lcd
 {
@@ -20,15 +21,15 @@ namespace gbaemu::lcd
         OBJ_WINDOW
     };
 
+    /*
+        d (PA, PC), dm (PB, PD) & origin (the sprite center) are 8.8 signed fixed point like on the hardware, screenRef
+        is the screen pixel the origin is mapped to. The texel of a pixel is (d * dx + dm * dy + origin) >> 8.
+     */
     struct OBJAffineTransform {
-        vec2 origin{0, 0};
-        vec2 d{1, 0};
-        vec2 dm{0, 1};
-        vec2 screenRef{0, 0};
-    };
-
-    struct IOBJAffineTransform {
-        common::math::vect<2, int32_t> origin{0, 0}, d{0x80, 0}, dm{0, 0x80}, screenRef{0, 0};
+        ivec2 origin{0, 0};
+        ivec2 d{0x100, 0};
+        ivec2 dm{0, 0x100};
+        ivec2 screenRef{0, 0};
     };
 
     PACK_STRUCT_DEF(OBJAttribute,
@@ -67,15 +68,14 @@ namespace gbaemu::lcd
 
       private:
         static OBJAttribute getAttribute(const uint8_t *attributes, uint32_t index);
-        static std::tuple<common::math::vec<2>, common::math::vec<2>> getRotScaleParameters(const uint8_t *attributes, uint32_t index);
-        static std::tuple<common::math::vect<2, int32_t>, common::math::vect<2, int32_t>> getRotScaleParametersI(const uint8_t *attributes, uint32_t index);
+        static std::tuple<ivec2, ivec2> getRotScaleParameters(const uint8_t *attributes, uint32_t index);
 
       public:
         OBJ(){};
         OBJ(const uint8_t *attributes, int32_t index, BGMode bgMode);
         std::string toString() const;
-        color_t pixelColor(int32_t sx, int32_t sy, const uint8_t *objTiles, const LCDColorPalette &palette, bool use2dMapping) const;
-        bool intersectsWithScanline(real_t fy) const;
+        color_t pixelColor(int32_t sx, int32_t sy, const uint8_t *objTiles, uint32_t objTilesOffset, TileCache &tileCache, const LCDColorPalette &palette, bool use2dMapping) const;
+        bool intersectsWithScanline(int32_t y) const;
 
         void writeAndDecode16(uint8_t offset, uint16_t value);
     };
@@ -1,5 +1,6 @@
 #include "objlayer.hpp"
 
+#include <algorithm>
 #include <array>
 #include <sstream>
 
@@ -32,9 +33,9 @@ namespace gbaemu::lcd
         return it;
     }
 
-    OBJLayer::OBJLayer(Memory &mem, LCDColorPalette &plt, const LCDIORegs &ioRegs, uint16_t prio, const std::shared_ptr<OBJManager>& manager) :
+    OBJLayer::OBJLayer(Memory &mem, TileCache &cache, LCDColorPalette &plt, const LCDIORegs &ioRegs, uint16_t prio, const std::shared_ptr<OBJManager>& manager) :
         Layer(static_cast<LayerID>(prio + 4), false),
-        memory(mem), palette(plt), regs(ioRegs), objects(128), objManager(manager)
+        memory(mem), tileCache(cache), palette(plt), regs(ioRegs), objects(128), objManager(manager)
     {
         /* OBJ layers are always enabled */
         enabled = true;
@@ -68,13 +69,12 @@ namespace gbaemu::lcd
         mosaicHeight = bitGet(le(regs.MOSAIC), MOSAIC::OBJ_MOSAIC_VSIZE_MASK, MOSAIC::OBJ_MOSAIC_VSIZE_OFFSET) + 1;
     }
 
-    void OBJLayer::loadOBJs(int32_t y, const std::function<bool(const OBJ&, real_t, uint16_t)>& filter)
+    void OBJLayer::loadOBJs(int32_t y, const std::function<bool(const OBJ&, int32_t, uint16_t)>& filter)
     {
-        real_t fy = static_cast<real_t>(y);
         objects.resize(0);
 
         for (const auto& obj : objManager->objects) {
-            if (!filter(obj, fy, priority))
+            if (!filter(obj, y, priority))
                 continue;
 
             if (obj.visible)
@@ -87,48 +87,44 @@ namespace gbaemu::lcd
 
     void OBJLayer::drawScanline(int32_t y)
     {
-        const real_t fy = static_cast<real_t>(y);
-        real_t fx = 0;
-
-        for (int32_t x = 0; x < static_cast<int32_t>(SCREEN_WIDTH); ++x) {
-            /* clear */
+        /* clear */
+        for (int32_t x = 0; x < static_cast<int32_t>(SCREEN_WIDTH); ++x)
             scanline[x] = Fragment(TRANSPARENT, asFirstTarget, asSecondTarget, false);
 
-            /* iterate over the objects beginning with OBJ0 (on top) */
-            for (auto obj = objects.cbegin(); obj != objects.cend(); ++obj) {
-                /* only the screen rectangle of that sprite is scanned */
-                if (x < obj->rect.left || x >= obj->rect.right)
-                    continue;
+        /*
+            OBJ0 is on top: every object only fills the pixels that are still transparent. Only the screen rectangle
+            of the object is scanned, the texture coordinates are stepped by (PA, PC) in 8.8 fixed point.
+         */
+        const uint32_t objTilesOffset = static_cast<uint32_t>(objTiles - memory.vram.rawAccess());
 
-                //const auto obj = *pObj;
-                const vec2 s = obj->affineTransform.d * (fx - obj->affineTransform.screenRef[0]) +
-                               obj->affineTransform.dm * (fy - obj->affineTransform.screenRef[1]) +
-                               obj->affineTransform.origin;
+        for (const OBJ &obj : objects) {
+            const OBJAffineTransform &transform = obj.affineTransform;
+            const int32_t left = std::max<int32_t>(obj.rect.left, 0);
+            const int32_t right = std::min<int32_t>(obj.rect.right, SCREEN_WIDTH);
 
-                //const common::math::vect<2, int32_t> s = obj->affineTransform.d * (x - obj->affineTransform.screenRef[0]) +
-                //    obj->affineTransform.dm * (y - obj->affineTransform.screenRef[1]) +
-                //    obj->affineTransform.origin;
+            ivec2 s = transform.d * (left - transform.screenRef[0]) +
+                      transform.dm * (y - transform.screenRef[1]) +
+                      transform.origin;
 
-                const int32_t sx = static_cast<int32_t>(s[0]);
-                const int32_t sy = static_cast<int32_t>(s[1]);
+            for (int32_t x = left; x < right; ++x, s += transform.d) {
+                if (scanline[x].color != TRANSPARENT)
+                    continue;
 
-                if (0 <= sx && sx < static_cast<int32_t>(obj->width) && 0 <= sy && sy < static_cast<int32_t>(obj->height)) {
-                    const int32_t msx = obj->mosaicEnabled ? (sx - (sx % mosaicWidth)) : sx;
-                    const int32_t msy = obj->mosaicEnabled ? (sy - (sy % mosaicHeight)) : sy;
-                    const color_t color = obj->pixelColor(msx, msy, objTiles, palette, use2dMapping);
-                    //obj->pixelColor(msx, msy, objTiles, palette, use2dMapping);
+                const int32_t sx = s[0] >> 8;
+                const int32_t sy = s[1] >> 8;
+
+                if (0 <= sx && sx < static_cast<int32_t>(obj.width) && 0 <= sy && sy < static_cast<int32_t>(obj.height)) {
+                    const int32_t msx = obj.mosaicEnabled ? (sx - (sx % mosaicWidth)) : sx;
+                    const int32_t msy = obj.mosaicEnabled ? (sy - (sy % mosaicHeight)) : sy;
+                    const color_t color = obj.pixelColor(msx, msy, objTiles, objTilesOffset, tileCache, palette, use2dMapping);
 
                     if (color == TRANSPARENT)
                         continue;
 
-                    /* if the color is not transparent it's the final color */
                     scanline[x].color = color;
-                    scanline[x].props |= (obj->mode == SEMI_TRANSPARENT) ? 4 : 0;
-                    break;
+                    scanline[x].props |= (obj.mode == SEMI_TRANSPARENT) ? 4 : 0;
                 }
             }
-
-            fx += 1.0;
         }
     }
 
@@ -4,6 +4,7 @@
 #include "obj.hpp"
 #include "packed.h"
 #include "palette.hpp"
+#include "tile-cache.hpp"
 
 #include <array>
 #include <io/memory.hpp>
@@ -40,6 +41,7 @@ namespace gbaemu::lcd
         int32_t mosaicHeight;
 
         Memory &memory;
+        TileCache &tileCache;
         LCDColorPalette &palette;
         const LCDIORegs &regs;
 
@@ -48,9 +50,9 @@ namespace gbaemu::lcd
         std::vector<OBJ>::const_iterator getLastRenderedOBJ(int32_t cycleBudget) const;
 
       public:
-        OBJLayer(Memory &mem, LCDColorPalette &plt, const LCDIORegs &ioRegs, uint16_t prio, const std::shared_ptr<OBJManager> &manager);
+        OBJLayer(Memory &mem, TileCache &cache, LCDColorPalette &plt, const LCDIORegs &ioRegs, uint16_t prio, const std::shared_ptr<OBJManager> &manager);
         void setMode(BGMode bgMode, bool mapping2d);
-        void loadOBJs(int32_t y, const std::function<bool(const OBJ &, real_t, uint16_t)> &filter);
+        void loadOBJs(int32_t y, const std::function<bool(const OBJ &, int32_t, uint16_t)> &filter);
         void drawScanline(int32_t y) override;
         std::string toString() const;
     };
@@ -1,20 +1,21 @@
 #include "renderer.hpp"
 
+#include <algorithm>
 #include <sstream>
 
 namespace gbaemu::lcd
 {
     void Renderer::setupLayers()
     {
-        backgroundLayers[0] = std::make_shared<BGLayer>(palette, memory, BGIndex::BG0);
-        backgroundLayers[1] = std::make_shared<BGLayer>(palette, memory, BGIndex::BG1);
-        backgroundLayers[2] = std::make_shared<BGLayer>(palette, memory, BGIndex::BG2);
-        backgroundLayers[3] = std::make_shared<BGLayer>(palette, memory, BGIndex::BG3);
+        backgroundLayers[0] = std::make_shared<BGLayer>(palette, memory, tileCache, BGIndex::BG0);
+        backgroundLayers[1] = std::make_shared<BGLayer>(palette, memory, tileCache, BGIndex::BG1);
+        backgroundLayers[2] = std::make_shared<BGLayer>(palette, memory, tileCache, BGIndex::BG2);
+        backgroundLayers[3] = std::make_shared<BGLayer>(palette, memory, tileCache, BGIndex::BG3);
 
-        objLayers[0] = std::make_shared<OBJLayer>(memory, palette, regs, 0, objManager);
-        objLayers[1] = std::make_shared<OBJLayer>(memory, palette, regs, 1, objManager);
-        objLayers[2] = std::make_shared<OBJLayer>(memory, palette, regs, 2, objManager);
-        objLayers[3] = std::make_shared<OBJLayer>(memory, palette, regs, 3, objManager);
+        objLayers[0] = std::make_shared<OBJLayer>(memory, tileCache, palette, regs, 0, objManager);
+        objLayers[1] = std::make_shared<OBJLayer>(memory, tileCache, palette, regs, 1, objManager);
+        objLayers[2] = std::make_shared<OBJLayer>(memory, tileCache, palette, regs, 2, objManager);
+        objLayers[3] = std::make_shared<OBJLayer>(memory, tileCache, palette, regs, 3, objManager);
 
         for (uint32_t i = 0; i < 8; ++i) {
             if (i <= 3)
@@ -23,7 +24,7 @@ namespace gbaemu::lcd
                 layers[i] = backgroundLayers[i - 4];
         }
 
-        windowOBJLayer = std::make_shared<OBJLayer>(memory, palette, regs, 0, objManager);
+        windowOBJLayer = std::make_shared<OBJLayer>(memory, tileCache, palette, regs, 0, objManager);
         windowFeature.objWindow.objLayer = windowOBJLayer;
     }
 
@@ -34,6 +35,46 @@ namespace gbaemu::lcd
         });
     }
 
+    void Renderer::updateLayerOrder()
+    {
+        /* the order only depends on the BG priorities, OBJ layers have fixed ones */
+        uint32_t key = le(regs.DISPCNT) & DISPCTL::SCREEN_DISPLAY_OBJ_MASK;
+
+        for (uint32_t i = 0; i < 4; ++i) {
+            key |= le(regs.DISPCNT) & DISPCTL::SCREEN_DISPLAY_BGN_MASK(i);
+            key |= static_cast<uint32_t>(le(regs.BGCNT[i]) & BGCNT::BG_PRIORITY_MASK) << (16 + i * 2);
+        }
+
+        if (key == layerOrderKey)
+            return;
+
+        layerOrderKey = key;
+        sortLayers();
+
+        activeLayerCount = 0;
+        for (const auto &l : layers)
+            if (l->enabled)
+                activeLayers[activeLayerCount++] = l.get();
+    }
+
+    void Renderer::buildOpacityMasks(int32_t xTo)
+    {
+        const uint8_t *windowMask = windowFeature.enabledMask.mask.data();
+
+        std::fill_n(opaqueLayers.begin(), xTo, 0);
+
+        for (uint32_t i = 0; i < activeLayerCount; ++i) {
+            const Fragment *fragments = activeLayers[i]->scanline.data();
+            /* same bit as flagLayerEnabled */
+            const uint32_t windowBit = std::min<uint32_t>(activeLayers[i]->layerID, LAYER_OBJ0);
+
+            for (int32_t x = 0; x < xTo; ++x) {
+                const uint32_t visible = (windowMask[x] >> windowBit) & (fragments[x].color != TRANSPARENT ? 1 : 0);
+                opaqueLayers[x] |= static_cast<uint8_t>(visible << i);
+            }
+        }
+    }
+
     void Renderer::loadSettings(int32_t y)
     {
         /* copy registers, they cannot be modified when rendering */
@@ -60,146 +101,99 @@ namespace gbaemu::lcd
         /* load objects for each layer */
         for (auto &l : objLayers) {
             l->setMode(bgMode, use2dMapping);
-            l->loadOBJs(y, [](const OBJ &obj, real_t fy, uint16_t priority) -> bool { return obj.priority == priority &&
+            l->loadOBJs(y, [](const OBJ &obj, int32_t y, uint16_t priority) -> bool { return obj.priority == priority &&
                                                                                              obj.visible &&
                                                                                              obj.mode != OBJ_WINDOW &&
-                                                                                             obj.intersectsWithScanline(fy); });
+                                                                                             obj.intersectsWithScanline(y); });
         }
 
         /* window objects */
         windowOBJLayer->setMode(bgMode, use2dMapping);
-        windowOBJLayer->loadOBJs(y, [](const OBJ &obj, real_t fy, uint16_t priority) -> bool { return obj.visible &&
+        windowOBJLayer->loadOBJs(y, [](const OBJ &obj, int32_t y, uint16_t priority) -> bool { return obj.visible &&
                                                                                                       obj.mode == OBJ_WINDOW &&
-                                                                                                      obj.intersectsWithScanline(fy); });
+                                                                                                      obj.intersectsWithScanline(y); });
 
         palette.loadPalette(memory);
         windowFeature.load(regs, y, palette.getBackdropColor());
         colorEffects.load(regs);
 
-        sortLayers();
+        updateLayerOrder();
     }
 
     void Renderer::blendDefault(int32_t y, int32_t xTo)
     {
         color_t *outBuf = target.pixels() + y * target.getWidth();
+        const color_t backdrop = palette.getBackdropColor();
 
-        for (int32_t x = 0; x < xTo; ++x) {
-            color_t finalColor = palette.getBackdropColor();
-
-            for (const auto &l : layers) {
-                if (!l->enabled || !flagLayerEnabled(windowFeature.enabledMask.mask[x], l->layerID))
-                    continue;
+        buildOpacityMasks(xTo);
 
-                color_t color = l->scanline[x].color;
-
-                if (color == TRANSPARENT)
-                    continue;
-
-                finalColor = color;
-                break;
-            }
-
-            outBuf[x] = finalColor;
+        for (int32_t x = 0; x < xTo; ++x) {
+            const uint32_t opaque = opaqueLayers[x];
+            outBuf[x] = opaque ? activeLayers[ctz(opaque)]->scanline[x].color : backdrop;
         }
     }
 
     void Renderer::blendBrightness(int32_t y, int32_t xTo)
     {
         color_t *outBuf = target.pixels() + y * target.getWidth();
-        std::function<color_t(color_t, color_t)> applyColorEffect = colorEffects.getBlendingFunction();
+        const color_t backdrop = palette.getBackdropColor();
 
-        for (int32_t x = 0; x < xTo; ++x) {
-            color_t finalColor = palette.getBackdropColor();
-            uint8_t windowMask = windowFeature.enabledMask.mask[x];
-
-            for (const auto &l : layers) {
-                if (!l->enabled || !flagLayerEnabled(windowMask, l->layerID))
-                    continue;
-
-                color_t color = l->scanline[x].color;
+        buildOpacityMasks(xTo);
 
-                if (color == TRANSPARENT)
-                    continue;
-
-                if (l->scanline[x].asFirstColor() && flagCFXEnabled(windowMask)) {
-                    finalColor = applyColorEffect(color, TRANSPARENT);
-                } else
-                    finalColor = color;
-
-                break;
+        /* resolve the top color of every pixel, the effect is applied to the whole line at once */
+        for (int32_t x = 0; x < xTo; ++x) {
+            const uint32_t opaque = opaqueLayers[x];
+
+            if (opaque) {
+                const Fragment &frag = activeLayers[ctz(opaque)]->scanline[x];
+                firstColors[x] = frag.color;
+                blendMask[x] = (frag.asFirstColor() && flagCFXEnabled(windowFeature.enabledMask.mask[x])) ? 0xFFFFFFFF : 0;
+            } else {
+                firstColors[x] = backdrop;
+                blendMask[x] = 0;
             }
-
-            outBuf[x] = finalColor;
         }
+
+        blender.brightness(outBuf, firstColors.data(), blendMask.data(), xTo, colorEffects.evy,
+                           colorEffects.getEffect() == BLDCNT::ColorSpecialEffect::BrightnessIncrease);
     }
 
     void Renderer::blendAlpha(int32_t y, int32_t xTo)
     {
         color_t *outBuf = target.pixels() + y * target.getWidth();
-        std::function<color_t(color_t, color_t)> applyColorEffect = colorEffects.getBlendingFunction();
+        const color_t backdrop = palette.getBackdropColor();
+
+        buildOpacityMasks(xTo);
 
+        /* resolve the top two colors of every pixel, the blending is done for the whole line at once */
         for (int32_t x = 0; x < xTo; ++x) {
-            auto it = layers.cbegin();
+            const uint32_t opaque = opaqueLayers[x];
             bool asFirst = false;
             bool asSecond = false;
-            color_t firstColor = palette.getBackdropColor();
-            color_t secondColor = palette.getBackdropColor();
-            color_t finalColor = palette.getBackdropColor();
 
-            for (; it != layers.cend(); it++) {
-                const auto &l = *it;
+            firstColors[x] = backdrop;
+            secondColors[x] = backdrop;
 
-                if (!l->enabled || !flagLayerEnabled(windowFeature.enabledMask.mask[x], l->layerID))
-                    continue;
+            if (opaque) {
+                const Fragment &first = activeLayers[ctz(opaque)]->scanline[x];
+                firstColors[x] = first.color;
+                asFirst = first.asFirstAlpha() || first.asFirstColor();
 
-                Fragment frag = l->scanline[x];
-
-                if (frag.color == TRANSPARENT)
-                    continue;
-
-                if (!frag.asFirstAlpha() && !frag.asFirstColor()) {
-                    asFirst = false;
-                } else {
-                    asFirst = true;
-                }
-
-                firstColor = frag.color;
-                break;
-            }
-
-            /* early abort, no blending */
-            if (!asFirst) {
-                outBuf[x] = firstColor;
-                continue;
-            }
-
-            /* find second color */
-            if (it != layers.cend()) {
-                for (it++; it != layers.cend(); it++) {
-                    const auto &l = *it;
-
-                    if (!l->enabled || !flagLayerEnabled(windowFeature.enabledMask.mask[x], l->layerID))
-                        continue;
-
-                    Fragment frag = l->scanline[x];
-
-                    if (frag.color == TRANSPARENT)
-                        continue;
-
-                    secondColor = frag.color;
-                    asSecond = frag.asSecondColor();
-                    break;
+                /* the second color is not needed if there is no blending */
+                const uint32_t below = opaque & (opaque - 1);
+                if (asFirst && below) {
+                    const Fragment &second = activeLayers[ctz(below)]->scanline[x];
+                    secondColors[x] = second.color;
+                    asSecond = second.asSecondColor();
                 }
             }
 
             /* Who thought of this crap?! */
 
-            /* blend */
-            if (asSecond)
-                outBuf[x] = applyColorEffect(firstColor, secondColor);
-            else
-                outBuf[x] = firstColor;
+            blendMask[x] = (asFirst && asSecond) ? 0xFFFFFFFF : 0;
         }
+
+        blender.alpha(outBuf, firstColors.data(), secondColors.data(), blendMask.data(), xTo, colorEffects.eva, colorEffects.evb);
     }
 
     void Renderer::blendDecomposed(int32_t y)
@@ -237,7 +231,7 @@ namespace gbaemu::lcd
         }
     }
 
-    Renderer::Renderer(Memory &mem, InterruptHandler &irq, const LCDIORegs &registers, Canvas<color_t> &targetCanvas) : memory(mem), irqHandler(irq), regs(registers), target(targetCanvas), objManager(std::make_shared<OBJManager>())
+    Renderer::Renderer(Memory &mem, InterruptHandler &irq, const LCDIORegs &registers, Canvas<color_t> &targetCanvas, PerfStats &stats) : memory(mem), irqHandler(irq), regs(registers), tileCache(mem.vram), objManager(std::make_shared<OBJManager>()), target(targetCanvas), perfStats(stats)
     {
         setupLayers();
     }
@@ -254,12 +248,13 @@ namespace gbaemu::lcd
 
         loadSettings(y);
 
-        for (const auto &l : layers)
-            if (l->enabled)
-                l->drawScanline(y);
+        for (uint32_t i = 0; i < activeLayerCount; ++i)
+            activeLayers[i]->drawScanline(y);
 
         windowOBJLayer->drawScanline(y);
 
+        PerfStats::Scope scope(&perfStats, PerfStats::BLEND);
+
 #if (RENDERER_DECOMPOSE_LAYERS == 1)
         blendDecomposed(y);
 #else
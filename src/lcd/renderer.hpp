@@ -8,7 +8,10 @@
 #include <lcd/defs.hpp>
 #include <lcd/objlayer.hpp>
 #include <lcd/palette.hpp>
+#include <lcd/scanline-blender.hpp>
+#include <lcd/tile-cache.hpp>
 #include <lcd/window-regions.hpp>
+#include <perf_stats.hpp>
 
 namespace gbaemu::lcd
 {
@@ -31,24 +34,44 @@ namespace gbaemu::lcd
         const LCDIORegs &regs;
 
         LCDColorPalette palette;
+        TileCache tileCache;
         WindowFeature windowFeature;
         ColorEffects colorEffects;
+        ScanlineBlender blender;
         std::shared_ptr<OBJManager> objManager;
 
         /* backdrop layer, BG0-BG4, OBJ0-OBJ4 */
         std::array<std::shared_ptr<BGLayer>, 4> backgroundLayers;
         /* each priority (0-3) gets its own layer */
         std::array<std::shared_ptr<OBJLayer>, 4> objLayers;
-        /* all layers */
+        /* all layers, sorted by priority */
         std::array<std::shared_ptr<Layer>, 8> layers;
+        /*
+            The enabled layers in priority order (top first) & the DISPCNT/BGCNT bits the order was built from, it is
+            only rebuilt when they change. Bit i of opaqueLayers[x] is set if activeLayers[i] has a visible fragment at
+            pixel x (enabled by the window & not transparent), so the top two fragments are the two lowest set bits.
+         */
+        std::array<Layer *, 8> activeLayers;
+        uint32_t activeLayerCount = 0;
+        uint32_t layerOrderKey = 0xFFFFFFFF;
+        std::array<uint8_t, SCREEN_WIDTH> opaqueLayers;
         std::shared_ptr<OBJLayer> windowOBJLayer;
 
         Canvas<color_t>& target;
 
+        PerfStats &perfStats;
+
         bool drawOdd = true;
 
+        /* resolved top two colors of the current scanline & which pixels the color effect applies to */
+        std::array<color_t, SCREEN_WIDTH> firstColors;
+        std::array<color_t, SCREEN_WIDTH> secondColors;
+        std::array<uint32_t, SCREEN_WIDTH> blendMask;
+
         void setupLayers();
         void sortLayers();
+        void updateLayerOrder();
+        void buildOpacityMasks(int32_t xTo);
         void loadSettings(int32_t y);
 
         void blendDefault(int32_t y, int32_t xTo = SCREEN_WIDTH);
@@ -57,7 +80,7 @@ namespace gbaemu::lcd
         void blendDecomposed(int32_t y);
 
       public:
-        Renderer(Memory &mem, InterruptHandler &irq, const LCDIORegs &registers, Canvas<color_t>& targetCanvas);
+        Renderer(Memory &mem, InterruptHandler &irq, const LCDIORegs &registers, Canvas<color_t>& targetCanvas, PerfStats &stats);
         void drawScanline(int32_t y);
         std::string getLayerStatusString() const;
     };
@@ -0,0 +1,206 @@
+#include "scanline-blender.hpp"
+
+#include <algorithm>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SCANLINE_BLENDER_X86
+#include <immintrin.h>
+#endif
+
+namespace gbaemu::lcd
+{
+    namespace
+    {
+        void alphaScalar(color_t *out, const color_t *first, const color_t *second, const uint32_t *mask, uint32_t count, uint32_t eva, uint32_t evb)
+        {
+            for (uint32_t x = 0; x < count; ++x) {
+                color_t blended = 0;
+
+                for (uint32_t i = 0; i < 32; i += 8) {
+                    const uint32_t top = (first[x] >> i) & 0xFF;
+                    const uint32_t bot = (second[x] >> i) & 0xFF;
+                    blended |= std::min(255u, ((top * eva) >> 4) + ((bot * evb) >> 4)) << i;
+                }
+
+                out[x] = (blended & mask[x]) | (first[x] & ~mask[x]);
+            }
+        }
+
+        void brightnessScalar(color_t *out, const color_t *first, const uint32_t *mask, uint32_t count, uint32_t evy, bool increase)
+        {
+            for (uint32_t x = 0; x < count; ++x) {
+                color_t blended = 0;
+
+                for (uint32_t i = 0; i < 32; i += 8) {
+                    const uint32_t chan = (first[x] >> i) & 0xFF;
+                    blended |= (increase ? (chan + (((255 - chan) * evy) >> 4)) : (chan - ((chan * evy) >> 4))) << i;
+                }
+
+                out[x] = (blended & mask[x]) | (first[x] & ~mask[x]);
+            }
+        }
+
+#ifdef SCANLINE_BLENDER_X86
+        /*
+            Both SIMD variants widen the channels to 16 bits (unpack with zero), multiply & shift, and narrow them
+            again with unsigned saturation, which is the min(255, ...) of the alpha blending. The unpacks & packs
+            work per 128 bit lane in AVX2, so the pixel order is preserved.
+         */
+        __attribute__((target("sse4.1"))) void alphaSSE41(color_t *out, const color_t *first, const color_t *second, const uint32_t *mask, uint32_t count, uint32_t eva, uint32_t evb)
+        {
+            const __m128i zero = _mm_setzero_si128();
+            const __m128i va = _mm_set1_epi16(static_cast<int16_t>(eva));
+            const __m128i vb = _mm_set1_epi16(static_cast<int16_t>(evb));
+
+            uint32_t x = 0;
+            for (; x + 4 <= count; x += 4) {
+                const __m128i top = _mm_loadu_si128(reinterpret_cast<const __m128i *>(first + x));
+                const __m128i bot = _mm_loadu_si128(reinterpret_cast<const __m128i *>(second + x));
+                const __m128i m = _mm_loadu_si128(reinterpret_cast<const __m128i *>(mask + x));
+
+                const __m128i lo = _mm_add_epi16(_mm_srli_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(top, zero), va), 4),
+                                                 _mm_srli_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(bot, zero), vb), 4));
+                const __m128i hi = _mm_add_epi16(_mm_srli_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(top, zero), va), 4),
+                                                 _mm_srli_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(bot, zero), vb), 4));
+
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(out + x), _mm_blendv_epi8(top, _mm_packus_epi16(lo, hi), m));
+            }
+
+            alphaScalar(out + x, first + x, second + x, mask + x, count - x, eva, evb);
+        }
+
+        __attribute__((target("sse4.1"))) void brightnessSSE41(color_t *out, const color_t *first, const uint32_t *mask, uint32_t count, uint32_t evy, bool increase)
+        {
+            const __m128i zero = _mm_setzero_si128();
+            const __m128i ones = _mm_set1_epi8(-1);
+            const __m128i vy = _mm_set1_epi16(static_cast<int16_t>(evy));
+
+            uint32_t x = 0;
+            for (; x + 4 <= count; x += 4) {
+                const __m128i col = _mm_loadu_si128(reinterpret_cast<const __m128i *>(first + x));
+                const __m128i m = _mm_loadu_si128(reinterpret_cast<const __m128i *>(mask + x));
+                /* 255 - chan for brightening */
+                const __m128i src = increase ? _mm_xor_si128(col, ones) : col;
+
+                const __m128i lo = _mm_srli_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(src, zero), vy), 4);
+                const __m128i hi = _mm_srli_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(src, zero), vy), 4);
+                const __m128i delta = _mm_packus_epi16(lo, hi);
+                const __m128i blended = increase ? _mm_add_epi8(col, delta) : _mm_sub_epi8(col, delta);
+
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(out + x), _mm_blendv_epi8(col, blended, m));
+            }
+
+            brightnessScalar(out + x, first + x, mask + x, count - x, evy, increase);
+        }
+
+        __attribute__((target("avx2"))) void alphaAVX2(color_t *out, const color_t *first, const color_t *second, const uint32_t *mask, uint32_t count, uint32_t eva, uint32_t evb)
+        {
+            const __m256i zero = _mm256_setzero_si256();
+            const __m256i va = _mm256_set1_epi16(static_cast<int16_t>(eva));
+            const __m256i vb = _mm256_set1_epi16(static_cast<int16_t>(evb));
+
+            uint32_t x = 0;
+            for (; x + 8 <= count; x += 8) {
+                const __m256i top = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(first + x));
+                const __m256i bot = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(second + x));
+                const __m256i m = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(mask + x));
+
+                const __m256i lo = _mm256_add_epi16(_mm256_srli_epi16(_mm256_mullo_epi16(_mm256_unpacklo_epi8(top, zero), va), 4),
+                                                    _mm256_srli_epi16(_mm256_mullo_epi16(_mm256_unpacklo_epi8(bot, zero), vb), 4));
+                const __m256i hi = _mm256_add_epi16(_mm256_srli_epi16(_mm256_mullo_epi16(_mm256_unpackhi_epi8(top, zero), va), 4),
+                                                    _mm256_srli_epi16(_mm256_mullo_epi16(_mm256_unpackhi_epi8(bot, zero), vb), 4));
+
+                _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + x), _mm256_blendv_epi8(top, _mm256_packus_epi16(lo, hi), m));
+            }
+
+            alphaScalar(out + x, first + x, second + x, mask + x, count - x, eva, evb);
+        }
+
+        __attribute__((target("avx2"))) void brightnessAVX2(color_t *out, const color_t *first, const uint32_t *mask, uint32_t count, uint32_t evy, bool increase)
+        {
+            const __m256i zero = _mm256_setzero_si256();
+            const __m256i ones = _mm256_set1_epi8(-1);
+            const __m256i vy = _mm256_set1_epi16(static_cast<int16_t>(evy));
+
+            uint32_t x = 0;
+            for (; x + 8 <= count; x += 8) {
+                const __m256i col = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(first + x));
+                const __m256i m = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(mask + x));
+                const __m256i src = increase ? _mm256_xor_si256(col, ones) : col;
+
+                const __m256i lo = _mm256_srli_epi16(_mm256_mullo_epi16(_mm256_unpacklo_epi8(src, zero), vy), 4);
+                const __m256i hi = _mm256_srli_epi16(_mm256_mullo_epi16(_mm256_unpackhi_epi8(src, zero), vy), 4);
+                const __m256i delta = _mm256_packus_epi16(lo, hi);
+                const __m256i blended = increase ? _mm256_add_epi8(col, delta) : _mm256_sub_epi8(col, delta);
+
+                _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + x), _mm256_blendv_epi8(col, blended, m));
+            }
+
+            brightnessScalar(out + x, first + x, mask + x, count - x, evy, increase);
+        }
+#endif
+    } // namespace
+
+    ScanlineBlender::ScanlineBlender() : implementation(SCALAR), alphaFunction(alphaScalar), brightnessFunction(brightnessScalar)
+    {
+        if (!select(AVX2))
+            select(SSE41);
+    }
+
+    bool ScanlineBlender::isSupported(Implementation impl)
+    {
+        switch (impl) {
+            case SCALAR:
+                return true;
+#ifdef SCANLINE_BLENDER_X86
+            case SSE41:
+                return __builtin_cpu_supports("sse4.1");
+            case AVX2:
+                return __builtin_cpu_supports("avx2");
+#endif
+            default:
+                return false;
+        }
+    }
+
+    const char *ScanlineBlender::implementationToString(Implementation impl)
+    {
+        switch (impl) {
+            case SCALAR:
+                return "scalar";
+            case SSE41:
+                return "SSE4.1";
+            case AVX2:
+                return "AVX2";
+            default:
+                return "unknown";
+        }
+    }
+
+    bool ScanlineBlender::select(Implementation impl)
+    {
+        if (!isSupported(impl))
+            return false;
+
+        implementation = impl;
+
+        switch (impl) {
+#ifdef SCANLINE_BLENDER_X86
+            case SSE41:
+                alphaFunction = alphaSSE41;
+                brightnessFunction = brightnessSSE41;
+                break;
+            case AVX2:
+                alphaFunction = alphaAVX2;
+                brightnessFunction = brightnessAVX2;
+                break;
+#endif
+            default:
+                alphaFunction = alphaScalar;
+                brightnessFunction = brightnessScalar;
+                break;
+        }
+
+        return true;
+    }
+} // namespace gbaemu::lcd
@@ -0,0 +1,67 @@
+#ifndef SCANLINE_BLENDER_HPP
+#define SCANLINE_BLENDER_HPP
+
+#include "defs.hpp"
+
+#include <cstdint>
+
+namespace gbaemu::lcd
+{
+    /*
+        Applies the color special effects to a whole scanline at once. The renderer first resolves the top two
+        visible colors of every pixel & whether the effect applies to it (mask is 0 or 0xFFFFFFFF), the blender then
+        computes the effect for all pixels & selects by the mask.
+
+        Every channel of the 8-8-8-8 colors is computed like ColorEffects does it:
+            alpha:    min(255, first * eva / 16 + second * evb / 16)
+            brighten: first + (255 - first) * evy / 16
+            darken:   first - first * evy / 16
+
+        The implementation is chosen at runtime: AVX2 (8 pixels per step), SSE4.1 (4 pixels per step) or a scalar
+        fallback. SIMD is only available for x86 builds with GCC or clang.
+     */
+    class ScanlineBlender
+    {
+      public:
+        enum Implementation {
+            SCALAR = 0,
+            SSE41,
+            AVX2
+        };
+
+        typedef void (*AlphaFunction)(color_t *out, const color_t *first, const color_t *second, const uint32_t *mask, uint32_t count, uint32_t eva, uint32_t evb);
+        typedef void (*BrightnessFunction)(color_t *out, const color_t *first, const uint32_t *mask, uint32_t count, uint32_t evy, bool increase);
+
+      private:
+        Implementation implementation;
+        AlphaFunction alphaFunction;
+        BrightnessFunction brightnessFunction;
+
+      public:
+        // Selects the best implementation the host supports
+        ScanlineBlender();
+
+        static bool isSupported(Implementation impl);
+        static const char *implementationToString(Implementation impl);
+
+        // Returns false & keeps the current implementation if impl is not supported
+        bool select(Implementation impl);
+
+        Implementation getImplementation() const
+        {
+            return implementation;
+        }
+
+        void alpha(color_t *out, const color_t *first, const color_t *second, const uint32_t *mask, uint32_t count, uint32_t eva, uint32_t evb) const
+        {
+            alphaFunction(out, first, second, mask, count, eva, evb);
+        }
+
+        void brightness(color_t *out, const color_t *first, const uint32_t *mask, uint32_t count, uint32_t evy, bool increase) const
+        {
+            brightnessFunction(out, first, mask, count, evy, increase);
+        }
+    };
+} // namespace gbaemu::lcd
+
+#endif /* SCANLINE_BLENDER_HPP */
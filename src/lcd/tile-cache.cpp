@@ -0,0 +1,22 @@
+#include "tile-cache.hpp"
+
+namespace gbaemu::lcd
+{
+    TileCache::TileCache(VRAM &vram) : vram(vram), indices(TILE_COUNT * 64, 0)
+    {
+        /* everything is decoded on the first access */
+        vram.markAllDirty();
+    }
+
+    void TileCache::decode(uint32_t tile)
+    {
+        const uint8_t *src = vram.rawAccess() + tile * TILE_SIZE_4BPP;
+        uint8_t *dst = indices.data() + tile * 64;
+
+        /* the first pixel of a pair is in the lower nibble */
+        for (uint32_t i = 0; i < TILE_SIZE_4BPP; ++i) {
+            dst[i * 2] = src[i] & 0xF;
+            dst[i * 2 + 1] = src[i] >> 4;
+        }
+    }
+} // namespace gbaemu::lcd
@@ -0,0 +1,57 @@
+#ifndef TILE_CACHE_HPP
+#define TILE_CACHE_HPP
+
+#include <io/vram.hpp>
+
+#include <cstdint>
+#include <vector>
+
+namespace gbaemu::lcd
+{
+    /*
+        Decoded copies of the 4 bit tiles in VRAM: every 8x8 tile is stored as 64 palette indices (one byte per pixel,
+        row by row), so BG & OBJ rendering reads rows of indices instead of extracting nibbles. A tile is decoded
+        when it is read the first time after a write, the writes are tracked by the dirty bits of VRAM.
+
+        8 bit tiles already are one palette index per byte & are read from VRAM directly.
+     */
+    class TileCache
+    {
+      public:
+        static constexpr uint32_t TILE_SIZE_4BPP = 32;
+        static constexpr uint32_t TILE_COUNT = VRAM::SIZE / TILE_SIZE_4BPP;
+
+      private:
+        VRAM &vram;
+        std::vector<uint8_t> indices;
+
+        void decode(uint32_t tile);
+
+      public:
+        TileCache(VRAM &vram);
+
+        TileCache(const TileCache &) = delete;
+        TileCache &operator=(const TileCache &) = delete;
+
+        /*
+            offset: of the 4 bit tile relative to the start of VRAM. Offsets beyond the 96K are mirrored like on the
+            bus (the last 32K mirror the OBJ tiles). Returns the 64 palette indices of the tile.
+         */
+        const uint8_t *tile4bpp(uint32_t offset)
+        {
+            static_assert(TILE_SIZE_4BPP == 1 << VRAM::DIRTY_BLOCK_SHIFT, "a tile has to be a dirty block");
+
+            offset &= 0x1FFFF;
+            if (offset >= VRAM::SIZE)
+                offset -= 0x8000;
+
+            const uint32_t tile = offset / TILE_SIZE_4BPP;
+            if (vram.testAndClearDirty(tile))
+                decode(tile);
+
+            return indices.data() + tile * 64;
+        }
+    };
+} // namespace gbaemu::lcd
+
+#endif /* TILE_CACHE_HPP */
@@ -1,14 +1,17 @@
 #ifndef LOGGING_HPP
 #define LOGGING_HPP
 
-//#define DEBUG_CLI
-#ifdef DEBUG_CLI
+// prints the CPU state after every instruction while the debugger (--debug) is enabled
 //#define DUMP_CPU_STATE
-#endif
 // #define DEBUG_ALL
 
 // #define LEGACY_RENDERING
 
+// #define THREADED_DISPATCH
+
+// counts the executed instructions & cycles per handler, the report is printed on exit & by the debugger (handlers)
+// #define PROFILE_HANDLERS
+
 #ifdef DEBUG_ALL
 #define DEBUG_DMA
 #define DEBUG_IRQ
@@ -18,6 +21,8 @@
 #define DEBUG_IO
 #define DEBUG_SAVE
 #define DEBUG_SWI
+#define DEBUG_JIT
+#define DEBUG_CPU
 #endif
 
 #ifdef DEBUG_DMA
@@ -108,4 +113,15 @@
     } while (0)
 #endif
 
+#ifdef DEBUG_JIT
+#define LOG_JIT(body) \
+    do {              \
+        body          \
+    } while (0)
+#else
+#define LOG_JIT(body) \
+    do {              \
+    } while (0)
+#endif
+
 #endif
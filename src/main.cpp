@@ -1,7 +1,11 @@
 #include <chrono>
+#include <cmath>
 #include <csignal>
+#include <cstdlib>
+#include <cstring>
 #include <fstream>
 #include <iostream>
+#include <memory>
 #include <thread>
 #include <vector>
 
@@ -33,108 +37,46 @@ static void handleSignal(int signum)
     }
 }
 
+/* debugCLI is nullptr if the debugger is not enabled */
 #ifndef LEGACY_RENDERING
-static bool frame(gbaemu::CPU &cpu, gbaemu::lcd::LCDController &lcdController
-#ifdef DEBUG_CLI
-                  ,
-                  gbaemu::debugger::DebugCLI &debugCLI
-#endif
-)
+static bool frame(gbaemu::CPU &cpu, gbaemu::lcd::LCDController &lcdController, gbaemu::debugger::DebugCLI *debugCLI)
 {
-
-    for (int i = 0; i < 160; ++i) {
-#ifndef DEBUG_CLI
-        gbaemu::CPUExecutionInfoType executionInfo = cpu.step(960);
-        if (executionInfo != gbaemu::CPUExecutionInfoType::NORMAL) {
-            std::cout << "CPU error occurred: " << std::endl;
-            std::cout << cpu.state.executionInfo.message.str() << std::endl;
-            return true;
-        }
-#else
-        for (int j = 0; j < 960; ++j) {
-            if (debugCLI.step()) {
-                return true;
-            }
-        }
-#endif
-
-        lcdController.drawScanline();
-        lcdController.onHBlank();
-        cpu.dmaGroup.triggerCondition(gbaemu::DMAGroup::StartCondition::WAIT_HBLANK);
-
-#ifndef DEBUG_CLI
-        executionInfo = cpu.step(272);
-        if (executionInfo != gbaemu::CPUExecutionInfoType::NORMAL) {
-            std::cout << "CPU error occurred: " << std::endl;
-            std::cout << cpu.state.executionInfo.message.str() << std::endl;
-            return true;
-        }
-#else
-        for (int j = 0; j < 272; ++j) {
-            if (debugCLI.step()) {
-                return true;
-            }
-        }
-#endif
-
-        lcdController.onVCount();
+    // The LCD schedules its scanline events & stops the CPU at the end of the frame (or the debugger stops it early)
+    if (debugCLI) {
+        return debugCLI->step();
     }
 
-    lcdController.onVBlank();
-    cpu.dmaGroup.triggerCondition(gbaemu::DMAGroup::StartCondition::WAIT_VBLANK);
-
-    for (int i = 0; i < 68; ++i) {
-#ifndef DEBUG_CLI
-        gbaemu::CPUExecutionInfoType executionInfo = cpu.step(1232);
-        if (executionInfo != gbaemu::CPUExecutionInfoType::NORMAL) {
-            std::cout << "CPU error occurred: " << std::endl;
-            std::cout << cpu.state.executionInfo.message.str() << std::endl;
-            return true;
-        }
-#else
-        for (int j = 0; j < 1232; ++j) {
-            if (debugCLI.step()) {
-                return true;
-            }
-        }
-#endif
-
-        lcdController.onVCount();
+    gbaemu::CPUExecutionInfoType executionInfo = cpu.run();
+    if (executionInfo != gbaemu::CPUExecutionInfoType::NORMAL) {
+        std::cout << "CPU error occurred: " << std::endl;
+        std::cout << cpu.state.executionInfo->message.str() << std::endl;
+        return true;
     }
 
-    lcdController.clearBlankFlags();
-    lcdController.present();
-
     return false;
 }
 #else
-static bool frame(gbaemu::CPU &cpu, gbaemu::lcd::LCDController &lcdController
-#ifdef DEBUG_CLI
-                  ,
-                  gbaemu::debugger::DebugCLI &debugCLI
-#endif
-)
+static bool frame(gbaemu::CPU &cpu, gbaemu::lcd::LCDController &lcdController, gbaemu::debugger::DebugCLI *debugCLI)
 {
     for (int i = 0; i < 280896; ++i) {
-#ifdef DEBUG_CLI
-        if (debugCLI.step()) {
-            return true;
-        }
-#else
-        gbaemu::CPUExecutionInfoType executionInfo = cpu.step(1);
-        if (executionInfo != gbaemu::CPUExecutionInfoType::NORMAL) {
-            std::cout << "CPU error occurred: " << std::endl;
-            std::cout << cpu.state.executionInfo.message.str() << std::endl;
-            return true;
+        if (debugCLI) {
+            if (debugCLI->step(1)) {
+                return true;
+            }
+        } else {
+            gbaemu::CPUExecutionInfoType executionInfo = cpu.step(1);
+            if (executionInfo != gbaemu::CPUExecutionInfoType::NORMAL) {
+                std::cout << "CPU error occurred: " << std::endl;
+                std::cout << cpu.state.executionInfo->message.str() << std::endl;
+                return true;
+            }
         }
-#endif
         lcdController.renderTick();
     }
     return false;
 }
 #endif
 
-#ifdef DEBUG_CLI
 static void CLILoop(gbaemu::debugger::DebugCLI &debugCLI)
 {
     while (doRun) {
@@ -150,10 +92,60 @@ static void CLILoop(gbaemu::debugger::DebugCLI &debugCLI)
 
     doRun = false;
 }
-#endif
 
 int main(int argc, char **argv)
 {
+    /* options are removed from the argument list, the remaining arguments are positional */
+    bool useJIT = false;
+    bool useAOT = true;
+    bool skipIdleLoops = true;
+    bool printIdleLoops = false;
+    bool useDebugger = false;
+    bool profileGuest = false;
+    bool printStats = false;
+    // 0: run until the window is closed
+    long benchmarkFrames = 0;
+    // multiplier of the CPU cycles per scanline, LCD, timers & DMAs keep their nominal timing
+    double overclock = 1.0;
+    std::vector<char *> args;
+    for (int i = 0; i < argc; ++i) {
+        if (i == 0 || std::strncmp(argv[i], "--", 2) != 0) {
+            args.push_back(argv[i]);
+        } else if (std::strcmp(argv[i], "--jit") == 0) {
+            useJIT = true;
+        } else if (std::strcmp(argv[i], "--no-aot") == 0) {
+            useAOT = false;
+        } else if (std::strcmp(argv[i], "--no-idle-skip") == 0) {
+            skipIdleLoops = false;
+        } else if (std::strcmp(argv[i], "--idle-stats") == 0) {
+            printIdleLoops = true;
+        } else if (std::strcmp(argv[i], "--debug") == 0) {
+            useDebugger = true;
+        } else if (std::strcmp(argv[i], "--profile") == 0) {
+            profileGuest = true;
+        } else if (std::strcmp(argv[i], "--stats") == 0) {
+            printStats = true;
+        } else if (std::strcmp(argv[i], "--benchmark") == 0 && i + 1 < argc) {
+            benchmarkFrames = std::strtol(argv[++i], nullptr, 10);
+        } else if (std::strcmp(argv[i], "--overclock") == 0 && i + 1 < argc) {
+            const char *factor = argv[++i];
+            char *end;
+            overclock = std::strtod(factor, &end);
+            // checked before the conversion into a clock scale, which only supports the range of the scheduler
+            constexpr double minFactor = static_cast<double>(gbaemu::Scheduler::MIN_CLOCK_SCALE) / gbaemu::Scheduler::CLOCK_SCALE_ONE;
+            constexpr double maxFactor = static_cast<double>(gbaemu::Scheduler::MAX_CLOCK_SCALE) / gbaemu::Scheduler::CLOCK_SCALE_ONE;
+            if (end == factor || *end != '\0' || !std::isfinite(overclock) || overclock < minFactor || overclock > maxFactor) {
+                std::cout << "invalid overclock factor: " << factor << " (has to be in [" << minFactor << ", " << maxFactor << "])\n";
+                return 1;
+            }
+        } else {
+            std::cout << "unknown option: " << argv[i] << '\n';
+            return 1;
+        }
+    }
+    argc = static_cast<int>(args.size());
+    argv = args.data();
+
 #if RENDERER_USE_FB_CANVAS == 1
     if (argc <= 1) {
         std::cout << "please provide a path to a frame buffer!\n";
@@ -183,6 +175,12 @@ int main(int argc, char **argv)
 
     /* intialize CPU and print game info */
     gbaemu::CPU cpu;
+    cpu.jit.setEnabled(useJIT);
+    cpu.idleLoops.setEnabled(skipIdleLoops);
+    cpu.scheduler.setClockScale(static_cast<uint32_t>(overclock * gbaemu::Scheduler::CLOCK_SCALE_ONE + 0.5));
+    if (cpu.scheduler.getClockScale() != gbaemu::Scheduler::CLOCK_SCALE_ONE) {
+        std::cout << "INFO: CPU clock " << (cpu.scheduler.getCPUClock() / 1e6) << " MHz" << std::endl;
+    }
 
     std::string saveFileName(argv[ROM_IDX]);
     saveFileName += ".sav";
@@ -191,6 +189,17 @@ int main(int argc, char **argv)
         return 0;
     }
 
+    // code compiled by gbarecomp is only used for the exact ROM image it was generated from
+    if (useAOT && cpu.aot.load(reinterpret_cast<const uint8_t *>(buf.data()), buf.size())) {
+        std::cout << "INFO: Using ahead of time compiled code of " << cpu.aot.getProgram()->name << std::endl;
+    }
+
+    if (profileGuest) {
+        cpu.profiler.start();
+    }
+    cpu.perfStats.setEnabled(printStats);
+    cpu.perfStats.setCPUClock(cpu.scheduler.getCPUClock());
+
     if (argc > ROM_IDX + 1) {
         std::ifstream biosFile(argv[ROM_IDX + 1], std::ios::binary);
 
@@ -272,25 +281,31 @@ int main(int argc, char **argv)
 
     gbaemu::keyboard::KeyboardController gameController(cpu.keypad);
 
-#ifdef DEBUG_CLI
-    gbaemu::debugger::DebugCLI debugCLI(cpu, lcdController);
-#endif
-
-#ifdef DEBUG_CLI
-    std::cout << "INFO: Launching CLI thread" << std::endl;
-    std::thread cliThread(CLILoop, std::ref(debugCLI));
-#endif
+    // the debugger only hooks into the CPU while breakpoints, traps or single steps are active
+    std::unique_ptr<gbaemu::debugger::DebugCLI> debugCLI;
+    std::thread cliThread;
+    if (useDebugger) {
+        debugCLI = std::make_unique<gbaemu::debugger::DebugCLI>(cpu, lcdController);
+        std::cout << "INFO: Launching CLI thread" << std::endl;
+        cliThread = std::thread(CLILoop, std::ref(*debugCLI));
+    }
 
     using frames = std::chrono::duration<int64_t, std::ratio<1, 60>>; // 60Hz
 #if LIMIT_FPS
     auto nextFrame = std::chrono::system_clock::now() + frames{0};
 #endif
 
-#if !defined(DEBUG_CLI) && PRINT_FPS
+#if PRINT_FPS
     auto lastFrame = std::chrono::system_clock::now() + frames{0};
 #endif
 
+    const auto benchmarkStart = std::chrono::steady_clock::now();
+    long frameCount = 0;
+
     for (; doRun;) {
+        cpu.perfStats.beginFrame();
+        const uint64_t frameStartCycle = cpu.scheduler.now();
+
         SDL_Event event;
 
         while (SDL_PollEvent(&event)) {
@@ -300,26 +315,36 @@ int main(int argc, char **argv)
             gameController.processSDLEvent(event);
         }
 
-        if (frame(cpu, lcdController
-#ifdef DEBUG_CLI
-                  ,
-                  debugCLI
-#endif
-                  )) {
-            break;
+        {
+            gbaemu::PerfStats::Scope scope(&cpu.perfStats, gbaemu::PerfStats::CPU);
+            if (frame(cpu, lcdController, debugCLI.get())) {
+                break;
+            }
         }
 
-        windowCanvas.present();
+        {
+            gbaemu::PerfStats::Scope scope(&cpu.perfStats, gbaemu::PerfStats::PRESENT);
+            windowCanvas.present();
+        }
+
+        cpu.perfStats.endFrame(cpu.scheduler.now() - frameStartCycle);
+
+        if (benchmarkFrames) {
+            // run as fast as possible
+            if (++frameCount == benchmarkFrames)
+                break;
+            continue;
+        }
 
 #if LIMIT_FPS
         std::this_thread::sleep_until(nextFrame);
         nextFrame += frames{1};
 #endif
 
-#if !defined(DEBUG_CLI) && PRINT_FPS
+#if PRINT_FPS
         auto currentTime = std::chrono::system_clock::now();
         auto dt = std::chrono::duration_cast<std::chrono::microseconds>(currentTime - lastFrame);
-        std::cout << "Current FPS: " << (1000000.0 / dt.count()) << std::endl;
+        std::cout << "Current FPS: " << (1000000.0 / dt.count()) << " CPU clock: " << (cpu.scheduler.getCPUClock() / 1e6) << " MHz" << std::endl;
         lastFrame = currentTime;
 #endif
     }
@@ -329,11 +354,41 @@ breakOuterLoop:
 
     std::cout << "window closed" << std::endl;
 
-#ifdef DEBUG_CLI
-    /* When CLI is attached only quit command will exit the program! */
-    cliThread.join();
+    if (benchmarkFrames) {
+        const std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - benchmarkStart;
+        std::cout << std::dec << "Benchmark: " << frameCount << " frames in " << elapsed.count() << " ms ("
+                  << (frameCount ? elapsed.count() / frameCount : 0.0) << " ms/frame, CPU clock "
+                  << (cpu.scheduler.getCPUClock() / 1e6) << " MHz)" << std::endl;
+    }
+
+    if (printIdleLoops) {
+        std::cout << cpu.idleLoops.toString();
+    }
+
+    if (printStats) {
+        std::ofstream statsFile(std::string(argv[ROM_IDX]) + ".stats.json");
+        statsFile << cpu.perfStats.toJSON();
+        std::cout << "INFO: Wrote the frame statistics to " << argv[ROM_IDX] << ".stats.json" << std::endl;
+    }
+
+    if (profileGuest) {
+        if (cpu.profiler.write(argv[ROM_IDX])) {
+            std::cout << std::dec << "INFO: Wrote " << cpu.profiler.getSampleCount() << " profile samples to " << argv[ROM_IDX] << ".profile.txt & "
+                      << argv[ROM_IDX] << ".folded" << std::endl;
+        } else {
+            std::cout << "ERROR: could not write the guest profile" << std::endl;
+        }
+    }
+
+#ifdef PROFILE_HANDLERS
+    std::cout << cpu.handlerProfile.toString(50);
 #endif
 
+    /* When CLI is attached only quit command will exit the program! */
+    if (cliThread.joinable()) {
+        cliThread.join();
+    }
+
     SDL_Quit();
 
     return 0;
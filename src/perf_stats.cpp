@@ -0,0 +1,166 @@
+#include "perf_stats.hpp"
+
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+namespace gbaemu
+{
+    PerfStats::Histogram::Histogram()
+    {
+        reset();
+    }
+
+    void PerfStats::Histogram::reset()
+    {
+        buckets.assign(BUCKETS, 0);
+        count = 0;
+        maxNs = 0;
+    }
+
+    void PerfStats::Histogram::add(uint64_t ns)
+    {
+        ++buckets[std::min<uint64_t>(ns / (BUCKET_US * 1000), BUCKETS - 1)];
+        ++count;
+        maxNs = std::max(maxNs, ns);
+    }
+
+    double PerfStats::Histogram::percentile(double p) const
+    {
+        if (!count)
+            return 0.0;
+
+        // the smallest bucket that contains at least p percent of the frames
+        const uint64_t rank = std::max<uint64_t>(static_cast<uint64_t>(p / 100.0 * count + 0.5), 1);
+        uint64_t seen = 0;
+        for (uint32_t i = 0; i < BUCKETS; ++i) {
+            seen += buckets[i];
+            if (seen >= rank)
+                return std::min((i + 1) * BUCKET_US / 1000.0, max());
+        }
+        return max();
+    }
+
+    void PerfStats::Totals::add(const Totals &other)
+    {
+        frames += other.frames;
+        frameNs += other.frameNs;
+        for (uint32_t i = 0; i < SECTION_COUNT; ++i)
+            sectionNs[i] += other.sectionNs[i];
+        cycles += other.cycles;
+        for (uint32_t i = 0; i < CYCLE_KIND_COUNT; ++i)
+            kindCycles[i] += other.kindCycles[i];
+    }
+
+    PerfStats::PerfStats() : enabled(false), inFrame(false), cpuClockHz(0.0), current(OTHER), depth(0)
+    {
+    }
+
+    const char *PerfStats::sectionToString(Section section)
+    {
+        switch (section) {
+            case OTHER:
+                return "other";
+            case CPU:
+                return "cpu";
+            case DMA:
+                return "dma";
+            case TIMERS:
+                return "timers";
+            case RENDER:
+                return "render";
+            case BLEND:
+                return "blend";
+            case PRESENT:
+                return "present";
+            default:
+                return "unknown";
+        }
+    }
+
+    void PerfStats::beginFrame()
+    {
+        if (!enabled)
+            return;
+
+        frame = Totals();
+        frameStart = last = Clock::now();
+        current = OTHER;
+        depth = 0;
+        inFrame = true;
+    }
+
+    void PerfStats::endFrame(uint64_t cycles)
+    {
+        if (!enabled || !inFrame)
+            return;
+
+        const Clock::time_point now = Clock::now();
+        charge(now);
+        inFrame = false;
+
+        frame.frames = 1;
+        frame.frameNs = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(now - frameStart).count());
+        frame.cycles = cycles;
+
+        interval.add(frame);
+        total.add(frame);
+        intervalHistogram.add(frame.frameNs);
+        totalHistogram.add(frame.frameNs);
+
+        if (interval.frames >= REPORT_FRAMES) {
+            printLine(std::cerr, interval, intervalHistogram);
+            interval = Totals();
+            intervalHistogram.reset();
+        }
+    }
+
+    void PerfStats::printLine(std::ostream &os, const Totals &totals, const Histogram &histogram) const
+    {
+        const double frameNs = totals.frameNs ? static_cast<double>(totals.frameNs) : 1.0;
+        const double cycles = totals.cycles ? static_cast<double>(totals.cycles) : 1.0;
+
+        std::stringstream ss;
+        ss << std::fixed << std::setprecision(2) << "stats: " << totals.frames << " frames, ms/frame avg "
+           << (totals.frameNs / 1e6 / std::max<uint64_t>(totals.frames, 1)) << " p50 " << histogram.percentile(50)
+           << " p95 " << histogram.percentile(95) << " p99 " << histogram.percentile(99) << " max " << histogram.max() << " |";
+        ss << std::setprecision(1);
+        for (uint32_t i = 0; i < SECTION_COUNT; ++i)
+            ss << ' ' << sectionToString(static_cast<Section>(i)) << ' ' << (100.0 * totals.sectionNs[i] / frameNs) << '%';
+        ss << " | cycles dma " << (100.0 * totals.kindCycles[CYCLES_DMA] / cycles) << "% halt "
+           << (100.0 * totals.kindCycles[CYCLES_HALT] / cycles) << "% | cpu clock " << std::setprecision(2) << (cpuClockHz / 1e6) << " MHz";
+
+        os << ss.str() << std::endl;
+    }
+
+    std::string PerfStats::toJSON() const
+    {
+        const double frames = total.frames ? static_cast<double>(total.frames) : 1.0;
+        const double frameNs = total.frameNs ? static_cast<double>(total.frameNs) : 1.0;
+
+        std::stringstream ss;
+        ss << std::fixed << std::setprecision(4);
+        ss << "{\n";
+        ss << "  \"frames\": " << total.frames << ",\n";
+        ss << "  \"cpu_clock_hz\": " << std::setprecision(0) << cpuClockHz << std::setprecision(4) << ",\n";
+        ss << "  \"frame_ms\": {\"avg\": " << (total.frameNs / 1e6 / frames) << ", \"p50\": " << totalHistogram.percentile(50)
+           << ", \"p95\": " << totalHistogram.percentile(95) << ", \"p99\": " << totalHistogram.percentile(99)
+           << ", \"max\": " << totalHistogram.max() << "},\n";
+
+        ss << "  \"sections\": {\n";
+        for (uint32_t i = 0; i < SECTION_COUNT; ++i) {
+            ss << "    \"" << sectionToString(static_cast<Section>(i)) << "\": {\"total_ms\": " << (total.sectionNs[i] / 1e6)
+               << ", \"ms_per_frame\": " << (total.sectionNs[i] / 1e6 / frames) << ", \"share\": " << (total.sectionNs[i] / frameNs) << '}'
+               << (i + 1 < SECTION_COUNT ? ",\n" : "\n");
+        }
+        ss << "  },\n";
+
+        const uint64_t otherCycles = total.cycles - std::min(total.cycles, total.kindCycles[CYCLES_DMA] + total.kindCycles[CYCLES_HALT]);
+        ss << "  \"cycles\": {\"total\": " << total.cycles << ", \"cpu\": " << otherCycles << ", \"dma\": " << total.kindCycles[CYCLES_DMA]
+           << ", \"halt\": " << total.kindCycles[CYCLES_HALT] << "}\n";
+        ss << "}\n";
+
+        return ss.str();
+    }
+} // namespace gbaemu
@@ -0,0 +1,190 @@
+#ifndef PERF_STATS_HPP
+#define PERF_STATS_HPP
+
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace gbaemu
+{
+    /*
+        Attributes the host time of every frame to the emulated subsystems & keeps frame time histograms, enabled
+        at runtime with --stats. Sections nest: entering DMA while the CPU runs stops the CPU clock until the DMA
+        section is left, so every section only gets its exclusive time. While disabled a Scope is a single check.
+
+        The frame time is the time between beginFrame & endFrame, i.e. without the frame limiter. Every
+        REPORT_FRAMES frames a line with the averages & percentiles of these frames is printed on stderr.
+     */
+    class PerfStats
+    {
+      public:
+        enum Section : uint8_t {
+            // everything outside of the other sections, e.g. the SDL event loop
+            OTHER = 0,
+            // CPU::run including the scheduler & the LCD state updates
+            CPU,
+            DMA,
+            TIMERS,
+            // Renderer::drawScanline without blending
+            RENDER,
+            BLEND,
+            // Canvas::present, i.e. SDL texture upload & rendering
+            PRESENT,
+            SECTION_COUNT
+        };
+
+        // Emulated cycles by what the CPU did
+        enum CycleKind : uint8_t {
+            CYCLES_DMA = 0,
+            CYCLES_HALT,
+            CYCLE_KIND_COUNT
+        };
+
+        static constexpr uint32_t REPORT_FRAMES = 60;
+
+        // Frame time histogram with BUCKET_US wide buckets, longer frames are counted in the last one
+        class Histogram
+        {
+          public:
+            static constexpr uint32_t BUCKET_US = 10;
+            static constexpr uint32_t BUCKETS = 10000;
+
+          private:
+            std::vector<uint32_t> buckets;
+            uint64_t count;
+            uint64_t maxNs;
+
+          public:
+            Histogram();
+
+            void reset();
+            void add(uint64_t ns);
+
+            uint64_t getCount() const
+            {
+                return count;
+            }
+
+            // Upper bound of the bucket the percentile falls into, in ms
+            double percentile(double p) const;
+
+            double max() const
+            {
+                return maxNs / 1e6;
+            }
+        };
+
+        class Scope
+        {
+          private:
+            PerfStats *stats;
+
+          public:
+            Scope(PerfStats *perfStats, Section section) : stats(perfStats && perfStats->enabled ? perfStats : nullptr)
+            {
+                if (stats)
+                    stats->enter(section);
+            }
+
+            ~Scope()
+            {
+                if (stats)
+                    stats->leave();
+            }
+
+            Scope(const Scope &) = delete;
+            Scope &operator=(const Scope &) = delete;
+        };
+
+      private:
+        typedef std::chrono::steady_clock Clock;
+
+        struct Totals {
+            uint64_t frames = 0;
+            uint64_t frameNs = 0;
+            uint64_t sectionNs[SECTION_COUNT] = {0};
+            uint64_t cycles = 0;
+            uint64_t kindCycles[CYCLE_KIND_COUNT] = {0};
+
+            void add(const Totals &other);
+        };
+
+        bool enabled;
+        bool inFrame;
+
+        // effective guest CPU clock, i.e. including the overclock factor
+        double cpuClockHz;
+
+        Clock::time_point frameStart;
+        Clock::time_point last;
+        Section current;
+        Section stack[8];
+        uint8_t depth;
+
+        // current frame, the last REPORT_FRAMES frames & the whole run
+        Totals frame;
+        Totals interval;
+        Totals total;
+        Histogram intervalHistogram;
+        Histogram totalHistogram;
+
+        void charge(Clock::time_point now)
+        {
+            frame.sectionNs[current] += static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(now - last).count());
+            last = now;
+        }
+
+        void enter(Section section)
+        {
+            charge(Clock::now());
+            if (depth < sizeof(stack) / sizeof(stack[0]))
+                stack[depth++] = current;
+            current = section;
+        }
+
+        void leave()
+        {
+            charge(Clock::now());
+            current = depth ? stack[--depth] : OTHER;
+        }
+
+        void printLine(std::ostream &os, const Totals &totals, const Histogram &histogram) const;
+
+      public:
+        PerfStats();
+
+        static const char *sectionToString(Section section);
+
+        void setEnabled(bool enable)
+        {
+            enabled = enable;
+        }
+
+        bool isEnabled() const
+        {
+            return enabled;
+        }
+
+        // Reported with the statistics, see Scheduler::getCPUClock
+        void setCPUClock(double hz)
+        {
+            cpuClockHz = hz;
+        }
+
+        void addCycles(CycleKind kind, uint64_t cycles)
+        {
+            frame.kindCycles[kind] += cycles;
+        }
+
+        void beginFrame();
+
+        // cycles: emulated cycles of this frame, the report line is printed every REPORT_FRAMES frames
+        void endFrame(uint64_t cycles);
+
+        std::string toJSON() const;
+    };
+} // namespace gbaemu
+
+#endif /* PERF_STATS_HPP */
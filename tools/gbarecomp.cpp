@@ -0,0 +1,441 @@
+/*
+    gbarecomp: compiles the code of a ROM ahead of time into C++ (see src/cpu/aot.hpp)
+
+    Usage: gbarecomp rom.gba output.cpp
+
+    The reachable code is searched starting at the ROM entry point: direct branches, the return addresses of calls
+    & SWIs and conditional branches are followed. Targets of indirect branches are only known if the register was
+    loaded from a literal pool; literals that get stored to memory (e.g. the IRQ handler address at 0x03007FFC,
+    which the BIOS IRQ vector jumps to) are treated as code addresses as well.
+    Every run of consecutive instructions becomes a function that can be entered at each of its instructions,
+    code that was not found (or lives in RAM) is left to the interpreter. Instructions decoded by the shared decoder
+    of the JIT (see src/cpu/native_decode.hpp) are emitted as C++, all others call their handler.
+ */
+#include "cpu/aot.hpp"
+#include "cpu/cpu.hpp"
+#include "cpu/native_decode.hpp"
+#include "decode/inst.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace
+{
+    using namespace gbaemu;
+
+    // Long runs are split up to keep the generated functions at a reasonable size
+    constexpr uint32_t MAX_BLOCK_LENGTH = 128;
+
+    class Recompiler
+    {
+      private:
+        const std::vector<uint8_t> &rom;
+
+        // [ARM, THUMB], set for every halfword an instruction of the instruction set starts at
+        std::vector<bool> code[2];
+        std::vector<std::pair<uint32_t, bool>> worklist;
+
+        // values loaded from literal pools by the instructions walked so far
+        uint32_t literals[16];
+        bool literalKnown[16];
+
+        uint32_t read16(uint32_t offset) const
+        {
+            return rom[offset] | (rom[offset + 1] << 8);
+        }
+
+        uint32_t read32(uint32_t offset) const
+        {
+            return read16(offset) | (read16(offset + 2) << 16);
+        }
+
+        // The instruction & its prefetched word have to be inside the ROM & the same memory region
+        bool fetchable(uint32_t offset, bool thumb) const
+        {
+            const uint32_t last = offset + 3 * (thumb ? 2 : 4) - 1;
+            return last < rom.size() && (last & ~0x00FFFFFF) == (offset & ~0x00FFFFFF);
+        }
+
+        void addTarget(uint32_t offset, bool thumb)
+        {
+            if (offset < rom.size())
+                worklist.emplace_back(offset, thumb);
+        }
+
+        // addr is an absolute address with bit 0 selecting the instruction set, like for BX
+        void addCodePointer(uint32_t addr)
+        {
+            const uint32_t region = (addr >> 24) & 0xF;
+            if (region < memory::EXT_ROM1 || region > memory::EXT_ROM3)
+                return;
+
+            if (addr & 1)
+                addTarget(addr & AOT::ROM_MASK & ~1, true);
+            else if ((addr & 3) == 0)
+                addTarget(addr & AOT::ROM_MASK, false);
+        }
+
+        void loadLiteral(uint8_t reg, uint32_t addr)
+        {
+            if (addr + 3 < rom.size() && (addr & 3) == 0) {
+                literals[reg] = read32(addr);
+                literalKnown[reg] = true;
+            }
+        }
+
+        // ADR style PC relative address calculation
+        void setAddress(uint8_t reg, uint32_t offset)
+        {
+            literals[reg] = memory::EXT_ROM_OFFSET + offset;
+            literalKnown[reg] = true;
+        }
+
+        void useLiteral(uint8_t reg)
+        {
+            if (literalKnown[reg])
+                addCodePointer(literals[reg]);
+        }
+
+        // Adds the targets of the instruction, returns true if execution may continue with the next one
+        bool followArm(uint32_t offset, uint32_t inst)
+        {
+            const bool always = (inst >> 28) == AL;
+            const uint8_t rd = (inst >> 12) & 0xF;
+
+            if ((inst & 0x0E000000) == 0x0A000000) {
+                // B, BL
+                addTarget(offset + 8 + (static_cast<int32_t>(inst << 8) >> 6), false);
+                return !always || (inst & 0x01000000);
+            }
+            if ((inst & 0x0FFFFFF0) == 0x012FFF10) {
+                // BX
+                useLiteral(inst & 0xF);
+                return !always;
+            }
+            if ((inst & 0x0F000000) == 0x0F000000) {
+                // SWI, the BIOS returns behind it
+                return true;
+            }
+            if ((inst & 0x0F7F0000) == 0x051F0000) {
+                // LDR Rd,[PC,#+-imm]
+                const uint32_t imm = inst & 0xFFF;
+                loadLiteral(rd, offset + 8 + ((inst & 0x00800000) ? imm : -imm));
+            } else if ((inst & 0x0FEF0000) == 0x028F0000 || (inst & 0x0FEF0000) == 0x024F0000) {
+                // ADD / SUB Rd,PC,#imm
+                const uint32_t rotate = (inst >> 7) & 0x1E;
+                const uint32_t imm = rotate ? ((inst & 0xFF) >> rotate) | ((inst & 0xFF) << (32 - rotate)) : (inst & 0xFF);
+                setAddress(rd, offset + 8 + ((inst & 0x00800000) ? imm : -imm));
+            } else if ((inst & 0x0C100000) == 0x04000000) {
+                // STR
+                useLiteral(rd);
+            }
+
+            const bool writesPC = (inst & 0x0E108000) == 0x08108000 ||                                   // LDM {..., PC}
+                                  (inst & 0x0C10F000) == 0x0410F000 ||                                   // LDR PC, ...
+                                  ((inst & 0x0C00F000) == 0x0000F000 && ((inst >> 23) & 3) != 2); // ALU op with Rd = PC
+            return !always || !writesPC;
+        }
+
+        bool followThumb(uint32_t offset, uint32_t inst)
+        {
+            if ((inst & 0xFF00) == 0xDF00) {
+                // SWI, the BIOS returns behind it
+                return true;
+            }
+            if ((inst & 0xF000) == 0xD000) {
+                // conditional branch
+                addTarget(offset + 4 + (static_cast<int32_t>(static_cast<int8_t>(inst & 0xFF)) << 1), true);
+                return true;
+            }
+            if ((inst & 0xF800) == 0xE000) {
+                // B
+                addTarget(offset + 4 + (static_cast<int32_t>(inst << 21) >> 20), true);
+                return false;
+            }
+            if ((inst & 0xF800) == 0xF000) {
+                // BL prefix, the target is known together with the suffix
+                const uint32_t suffix = offset + 2 < rom.size() ? read16(offset + 2) : 0;
+                if ((suffix & 0xF800) == 0xF800)
+                    addTarget(offset + 4 + (static_cast<int32_t>(inst << 21) >> 9) + ((suffix & 0x7FF) << 1), true);
+                return true;
+            }
+            if ((inst & 0xFF80) == 0x4700) {
+                // BX
+                useLiteral((inst >> 3) & 0xF);
+                return false;
+            }
+            if ((inst & 0xF800) == 0x4800) {
+                // LDR Rd,[PC,#imm]
+                loadLiteral((inst >> 8) & 0x7, ((offset + 4) & ~3) + ((inst & 0xFF) << 2));
+            } else if ((inst & 0xF800) == 0xA000) {
+                // ADD Rd,PC,#imm
+                setAddress((inst >> 8) & 0x7, ((offset + 4) & ~3) + ((inst & 0xFF) << 2));
+            } else if ((inst & 0xF800) == 0x6000 || (inst & 0xFE00) == 0x5000) {
+                // STR Rd,[Rb,#imm] / STR Rd,[Rb,Ro]
+                useLiteral(inst & 0x7);
+            } else if ((inst & 0xF800) == 0x9000) {
+                // STR Rd,[SP,#imm]
+                useLiteral((inst >> 8) & 0x7);
+            }
+
+            return (inst & 0xFF00) != 0xBD00 &&  // POP {..., PC}
+                   (inst & 0xFD87) != 0x4487;    // ADD / MOV PC,Rs
+        }
+
+        void walk(uint32_t offset, bool thumb)
+        {
+            const uint32_t instSize = thumb ? 2 : 4;
+
+            std::fill_n(literalKnown, 16, false);
+
+            for (; fetchable(offset, thumb) && !code[thumb][offset >> 1]; offset += instSize) {
+                const uint32_t inst = thumb ? read16(offset) : read32(offset);
+                const CPU::InstExecutor handler = thumb ? CPU::thumbHandler(hashThumb(inst)) : CPU::armHandler(hashArm(inst));
+
+                if (handler == &CPU::handleInvalid)
+                    break;
+
+                code[thumb][offset >> 1] = true;
+
+                if (!(thumb ? followThumb(offset, inst) : followArm(offset, inst)))
+                    break;
+            }
+        }
+
+        std::string blockName(uint32_t offset, bool thumb) const
+        {
+            std::stringstream ss;
+            ss << (thumb ? "thumb_" : "arm_") << std::hex << std::setw(8) << std::setfill('0') << offset;
+            return ss.str();
+        }
+
+        // C++ expression of an operand, registers are read through the AOTBlock
+        static std::string operand(const native::Operand &op)
+        {
+            std::stringstream ss;
+            if (op.isConst)
+                ss << "0x" << std::hex << op.value << "u";
+            else
+                ss << "block.reg(" << std::dec << op.value << ")";
+            return ss.str();
+        }
+
+        // C++ expression of a shifted operand, the shifter carry is bit 32 (see AOTBlock::shift)
+        static std::string shiftedOperand(const native::ShiftedOperand &op)
+        {
+            static const char *const types[] = {"LSL", "LSR", "ASR", "ROR"};
+
+            std::stringstream ss;
+            if (op.immCarry >= 0)
+                ss << "0x" << std::hex << ((static_cast<uint64_t>(op.immCarry) << 32) | op.base.value) << "ull";
+            else if (op.type == shifts::LSL && op.amount == 0)
+                ss << operand(op.base);
+            else
+                ss << "block.shift<shifts::" << types[op.type] << ", " << std::dec << static_cast<uint32_t>(op.amount) << ">(" << operand(op.base) << ")";
+            return ss.str();
+        }
+
+        // Statement executing the semantics of a decoded instruction with the AOTBlock helpers
+        static std::string nativeStatement(const native::Inst &decoded)
+        {
+            static const char *const dataProcOps[] = {"DP_AND", "DP_EOR", "DP_SUB", "DP_RSB", "DP_ADD", "DP_ADC", "DP_SBC", "DP_RSC", "DP_TST",
+                                                      "DP_TEQ", "DP_CMP", "DP_CMN", "DP_ORR", "DP_MOV", "DP_BIC", "DP_MVN", "DP_NEG"};
+            static const char *const memOps[] = {"MEM_LDR", "MEM_LDRB", "MEM_LDRH", "MEM_LDRSB", "MEM_LDRSH", "MEM_STR", "MEM_STRB", "MEM_STRH"};
+
+            const auto boolean = [](bool value) { return value ? "true" : "false"; };
+
+            std::stringstream ss;
+            ss << std::dec;
+            switch (decoded.kind) {
+                case native::Inst::DATA_PROC: {
+                    const native::DataProc &dp = decoded.dataProc;
+                    const bool shifterCarry = dp.s && dp.logical() && dp.op2.updatesShifterCarry();
+                    // MOV & MVN do not use their first operand
+                    const bool usesOp1 = dp.op != native::DP_MOV && dp.op != native::DP_MVN;
+                    ss << "block.dataProc<native::" << dataProcOps[dp.op] << ", " << boolean(dp.s) << ", " << static_cast<uint32_t>(dp.rd) << ", "
+                       << boolean(dp.write) << ", " << boolean(shifterCarry) << ">(" << (usesOp1 ? operand(dp.op1) : "0") << ", " << shiftedOperand(dp.op2) << ");";
+                    break;
+                }
+                case native::Inst::THUMB_SHIFT:
+                    ss << "block.thumbShift<" << static_cast<uint32_t>(decoded.dataProc.rd) << ">(" << shiftedOperand(decoded.dataProc.op2) << ");";
+                    break;
+                case native::Inst::MEMORY: {
+                    const native::MemAccess &access = decoded.memAccess;
+                    ss << "block.memory<native::" << memOps[access.op] << ", " << static_cast<uint32_t>(access.rd) << ", " << static_cast<uint32_t>(access.rn) << ", "
+                       << boolean(access.pre) << ", " << boolean(access.up) << ", " << boolean(access.writeback) << ">(" << operand(access.base) << ", ";
+                    if (access.offset.type == shifts::LSL && access.offset.amount == 0)
+                        ss << operand(access.offset.base) << ");";
+                    else
+                        ss << "static_cast<uint32_t>(" << shiftedOperand(access.offset) << "));";
+                    break;
+                }
+                case native::Inst::BRANCH:
+                    ss << "block.branch<" << boolean(decoded.link) << ">(0x" << std::hex << decoded.target << "u);";
+                    break;
+                default:
+                    break;
+            }
+            return ss.str();
+        }
+
+      public:
+        Recompiler(const std::vector<uint8_t> &rom) : rom(rom)
+        {
+            code[0].resize(rom.size() / 2 + 1);
+            code[1].resize(rom.size() / 2 + 1);
+        }
+
+        // Finds the reachable code, returns the number of instructions
+        uint32_t analyze()
+        {
+            // the ROM header starts with a branch to the actual entry point
+            addTarget(0, false);
+
+            while (!worklist.empty()) {
+                auto target = worklist.back();
+                worklist.pop_back();
+                walk(target.first, target.second);
+            }
+
+            uint32_t count = 0;
+            for (bool thumb : {false, true}) {
+                for (bool isCode : code[thumb])
+                    count += isCode;
+            }
+            return count;
+        }
+
+        // Returns the number of instructions that were translated into C++, the others call their handlers
+        uint32_t emit(std::ostream &os, const std::string &name) const
+        {
+            std::stringstream entries;
+            uint32_t translated = 0;
+
+            os << "/*\n"
+               << "    Generated by gbarecomp from " << name << ", do not edit.\n"
+               << "    The code is only used for the exact same ROM image, see src/cpu/aot.hpp.\n"
+               << " */\n"
+               << "#include \"cpu/aot_block.hpp\"\n\n"
+               << "namespace\n"
+               << "{\n"
+               << "    using gbaemu::AOTBlock;\n"
+               << "    using gbaemu::CPU;\n"
+               << "    namespace native = gbaemu::native;\n"
+               << "    namespace shifts = gbaemu::shifts;\n";
+
+            for (bool thumb : {false, true}) {
+                const uint32_t instSize = thumb ? 2 : 4;
+                Instruction disas;
+                disas.isArm = !thumb;
+
+                for (uint32_t offset = 0; offset < rom.size(); offset += instSize) {
+                    if (!code[thumb][offset >> 1])
+                        continue;
+
+                    const std::string function = blockName(offset, thumb);
+                    uint32_t length = 0;
+                    while (length < MAX_BLOCK_LENGTH && (offset + length * instSize) < rom.size() && code[thumb][(offset + length * instSize) >> 1] &&
+                           (length == 0 || ((offset + length * instSize) & 0x00FFFFFF) != 0)) {
+                        ++length;
+                    }
+
+                    os << "\n    void " << function << "(CPU &cpu, uint32_t index, uint32_t pc)\n"
+                       << "    {\n"
+                       << "        AOTBlock<" << (thumb ? "true" : "false") << "> block(cpu, pc);\n\n"
+                       << "        switch (index) {\n";
+
+                    for (uint32_t i = 0; i < length; ++i, offset += instSize) {
+                        const uint32_t inst = thumb ? read16(offset) : read32(offset);
+                        const uint32_t prefetch = thumb ? read16(offset + 2 * instSize) : read32(offset + 2 * instSize);
+                        const uint32_t pc = memory::EXT_ROM_OFFSET + offset;
+                        const native::Inst decoded = thumb ? native::decodeThumb(inst, pc) : native::decodeARM(inst, pc);
+                        const bool last = i + 1 == length;
+                        disas.inst = inst;
+
+                        os << std::hex << std::setfill('0')
+                           << "            case 0x" << i << ": // 0x" << std::setw(8) << pc << ": " << disas.toString() << "\n";
+
+                        if (decoded.kind != native::Inst::HANDLER) {
+                            os << "                block.begin(0x" << std::setw(thumb ? 4 : 8) << prefetch << ");\n";
+                            if (decoded.cond != AL)
+                                os << "                if (block.condition(gbaemu::" << conditionCodeToString(static_cast<ConditionOPCode>(decoded.cond)) << "))\n    ";
+                            os << "                " << nativeStatement(decoded) << "\n"
+                               << (last ? "                block.end();\n" : "                if (!block.end())\n");
+                            ++translated;
+                        } else {
+                            const bool conditional = !thumb && (inst >> 28) != AL;
+                            os << "                " << (last ? "" : "if (!") << "block.step<" << (conditional ? "true" : "false") << ">(0x" << std::setw(thumb ? 4 : 8) << inst
+                               << ", 0x" << std::setw(thumb ? 4 : 8) << prefetch << ", 0x" << std::setw(3) << (thumb ? hashThumb(inst) : hashArm(inst)) << ")"
+                               << (last ? ";\n" : ")\n");
+                        }
+                        if (!last)
+                            os << "                    return;\n                [[fallthrough]];\n";
+
+                        entries << std::hex << std::setfill('0') << "        {0x" << std::setw(8) << (offset | static_cast<uint32_t>(thumb)) << ", 0x" << i
+                                << ", 0x" << std::setw(thumb ? 4 : 8) << inst << ", " << function << "},\n";
+                    }
+                    // the loop increment moves to the next instruction
+                    offset -= instSize;
+
+                    os << "        }\n"
+                       << "    }\n";
+                }
+            }
+
+            os << "\n    const gbaemu::AOT::Entry entries[] = {\n"
+               << entries.str()
+               << "    };\n\n"
+               << "    const gbaemu::AOT::Program program = {\"" << name << "\", 0x" << std::hex << rom.size() << ", 0x"
+               << AOT::checksum(rom.data(), rom.size()) << ", entries, sizeof(entries) / sizeof(entries[0])};\n\n"
+               << "    const bool registered = gbaemu::AOT::registerProgram(program);\n"
+               << "} // namespace\n";
+
+            return translated;
+        }
+    };
+} // namespace
+
+int main(int argc, char **argv)
+{
+    if (argc != 3) {
+        std::cout << "usage: " << argv[0] << " rom.gba output.cpp\n";
+        return 1;
+    }
+
+    std::ifstream file(argv[1], std::ios::binary);
+    if (!file.is_open()) {
+        std::cout << "could not open ROM file\n";
+        return 1;
+    }
+    std::vector<uint8_t> rom(std::istreambuf_iterator<char>(file), {});
+    file.close();
+
+    // the name ends up in a string literal
+    std::string name(argv[1]);
+    name = name.substr(name.find_last_of("/\\") + 1);
+    for (char &c : name) {
+        if (c == '"' || c == '\\' || c < ' ')
+            c = '_';
+    }
+
+    Recompiler recompiler(rom);
+    const uint32_t count = recompiler.analyze();
+
+    std::ofstream out(argv[2]);
+    if (!out.is_open()) {
+        std::cout << "could not open output file\n";
+        return 1;
+    }
+    const uint32_t translated = recompiler.emit(out, name);
+
+    std::cout << "INFO: compiled " << std::dec << count << " instructions of " << name << " into " << argv[2] << ", " << translated
+              << " of them translated into C++" << std::endl;
+
+    return 0;
+}